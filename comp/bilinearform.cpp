@@ -102,6 +102,9 @@ namespace ngcomp
     geom_free = flags.GetDefineFlag("geom_free");    
     if (spd) symmetric = true;
     SetCheckUnused (!flags.GetDefineFlagX("check_unused").IsFalse());
+    SetAssemblyPlan (flags.GetDefineFlag ("assembly_plan"));
+    SetAtomicAssembly (flags.GetDefineFlag ("atomic_assembly"));
+    SetBatchAssembly (flags.GetDefineFlag ("batch_assembly"));
   }
 
 
@@ -158,6 +161,9 @@ namespace ngcomp
     precompute = flags.GetDefineFlag ("precompute");
     checksum = flags.GetDefineFlag ("checksum");
     SetCheckUnused (!flags.GetDefineFlagX("check_unused").IsFalse());    
+    SetAssemblyPlan (flags.GetDefineFlag ("assembly_plan"));
+    SetAtomicAssembly (flags.GetDefineFlag ("atomic_assembly"));
+    SetBatchAssembly (flags.GetDefineFlag ("batch_assembly"));
   }
 
 
@@ -203,6 +209,8 @@ namespace ngcomp
                        string ("bfi is ")+bfi->Name());
 
     parts.Append (bfi);
+    // integrators are checked again when the plan is rebuilt
+    plan.timestamp = 0;
 
     if ((bfi->geom_free && nonassemble) || geom_free)
       {
@@ -303,6 +311,136 @@ namespace ngcomp
       low_order_bilinear_form -> SetCheckUnused (b);
   }
 
+  void BilinearForm :: SetAssemblyPlan (bool b)
+  {
+    assembly_plan = b;
+    if (!b)
+      plan = AssemblyPlan();
+  }
+
+  void BilinearForm :: SetAtomicAssembly (bool b)
+  {
+    atomic_assembly = b;
+    if (low_order_bilinear_form)
+      low_order_bilinear_form -> SetAtomicAssembly (b);
+  }
+
+  void BilinearForm :: SetBatchAssembly (bool b)
+  {
+    batch_assembly = b;
+    if (low_order_bilinear_form)
+      low_order_bilinear_form -> SetBatchAssembly (b);
+  }
+
+  bool BilinearForm :: UseAtomicAssembly () const
+  {
+    // preconditioners and the condensed rhs rely on exclusive access per color
+    return atomic_assembly && !preconditioners.Size() &&
+      !(linearform && (eliminate_internal || eliminate_hidden));
+  }
+
+  void BilinearForm :: IterateAssemblyElements (VorB vb, LocalHeap & clh,
+                                                const function<void(FESpace::Element,LocalHeap&)> & func) const
+  {
+    if (UseAtomicAssembly())
+      IterateElementsUncolored (*fespace, vb, clh, func);
+    else
+      IterateElements (*fespace, vb, clh, func);
+  }
+
+  void BilinearForm :: IterateAssemblyElementBatches (VorB vb, size_t batchsize, LocalHeap & clh,
+                                                      const function<void(FlatArray<ElementId>,LocalHeap&)> & func) const
+  {
+    static mutex copyex_mutex;
+    Exception * ex = nullptr;
+
+    // batches of consecutive elements of one color, or of all elements for atomic assembly
+    auto iterate_batches = [&] (size_t n, auto elnr)
+      {
+        SharedLoop2 sl((n+batchsize-1) / batchsize);
+        ParallelJob
+          ( [&] (const TaskInfo & ti)
+            {
+              LocalHeap lh = clh.Split(ti.thread_nr, ti.nthreads);
+              for (size_t b : sl)
+                {
+                  HeapReset hr(lh);
+                  Array<ElementId> batch(batchsize, lh);
+                  batch.SetSize0();
+                  for (size_t i = b*batchsize; i < min((b+1)*batchsize, n); i++)
+                    {
+                      ElementId ei(vb, elnr(i));
+                      if (fespace->DefinedOn(ei))
+                        batch.AppendHaveMem (ei);
+                    }
+                  if (!batch.Size()) continue;
+                  try
+                    {
+                      func (batch, lh);
+                    }
+                  catch (const Exception & e)
+                    {
+                      lock_guard<mutex> guard(copyex_mutex);
+                      if (!ex)
+                        ex = new Exception (e);
+                    }
+                }
+              ProgressOutput::SumUpLocal();
+            } );
+      };
+
+    if (UseAtomicAssembly())
+      iterate_batches (ma->GetNE(vb), [] (size_t i) { return i; });
+    else
+      for (FlatArray<int> els_of_col : fespace->ElementColoring(vb))
+        iterate_batches (els_of_col.Size(), [els_of_col] (size_t i) { return els_of_col[i]; });
+
+    if (ex)
+      {
+        Exception hex(*ex);
+        delete ex;
+        throw hex;
+      }
+  }
+
+  void BilinearForm :: CheckElementDofs (const FiniteElement & fel, FlatArray<DofId> dnums, VorB vb) const
+  {
+    if (fel.GetNDof() == dnums.Size()) return;
+    
+    *testout << "Info from finite element: " << endl;
+    fel.Print (*testout);
+    (*testout) << "fel::GetNDof() = " << fel.GetNDof() << endl;
+    (*testout) << "dnums.Size() = " << dnums.Size() << endl;
+    (*testout) << "dnums = " << dnums << endl;
+    throw Exception ( string("Inconsistent number of degrees of freedom, vb="+ToString(vb)+" fel::GetNDof() = ") + ToString(fel.GetNDof()) + string(" != dnums.Size() = ") + ToString(dnums.Size()) + string("!") );
+  }
+
+  const Table<int> & BilinearForm :: AssemblyFacetColoring ()
+  {
+    if (!UseAtomicAssembly())
+      return fespace->FacetColoring();
+
+    size_t nf = ma->GetNFacets();
+    if (uncolored_facets.Size() != 1 || uncolored_facets[0].Size() != nf)
+      {
+        Array<int> cnt(1);
+        cnt[0] = nf;
+        uncolored_facets = Table<int> (cnt);
+        for (size_t i = 0; i < nf; i++)
+          uncolored_facets[0][i] = i;
+      }
+    return uncolored_facets;
+  }
+
+  bool BilinearForm :: AssemblyPlanValid () const
+  {
+    return assembly_plan && plan.timestamp &&
+      plan.timestamp > graph_timestamp &&
+      plan.timestamp > specialelements_timestamp &&
+      plan.timestamp > fespace->GetTimeStamp() &&
+      plan.timestamp > ma->GetTimeStamp();
+  }
+
   void BilinearForm :: AddSpecialElement (unique_ptr<SpecialElement> spel)
   {
     specialelements.Append (std::move(spel));
@@ -892,6 +1030,12 @@ namespace ngcomp
     for (int i = 0; i < mats.Size(); i++)
       if (mats[i]) mu += mats[i]->GetMemoryUsage ();
 
+    size_t nplan = 0;
+    for (auto & pos : plan.positions)
+      nplan += pos.AsArray().Size();
+    if (nplan)
+      mu.Append (MemoryUsage ("AssemblyPlan", nplan*sizeof(size_t), 1));
+
     for (int i = olds; i < mu.Size(); i++)
       mu[i].AddName (string(" bf ")+GetName());
     return mu;
@@ -902,6 +1046,150 @@ namespace ngcomp
   S_BilinearForm<SCAL> :: ~S_BilinearForm () { ; }
 
   
+  template <class SCAL>
+  void S_BilinearForm<SCAL> :: PrepareAssemblyPlan (LocalHeap & clh)
+  {
+    static Timer t("BilinearForm::PrepareAssemblyPlan");
+    RegionTimer reg(t);
+
+    plan = AssemblyPlan();
+    for (VorB vb : { VOL, BND, BBND })
+      {
+        if (!VB_parts[vb].Size()) continue;
+        size_t ne = ma->GetNE(vb);
+        Array<int> cnt(ne);
+        cnt = 0;
+        ParallelFor (ne, [&] (size_t i)
+                     {
+                       ElementId ei(vb, i);
+                       if (!fespace->DefinedOn (vb, ma->GetElIndex (ei))) return;
+                       ArrayMem<DofId,100> dnums;
+                       fespace->GetDofNrs (ei, dnums);
+                       cnt[i] = sqr(dnums.Size());
+                     });
+        plan.positions[vb] = Table<size_t> (cnt);
+        plan.filled[vb].SetSize (ne);
+        plan.filled[vb] = false;
+      }
+    plan.timestamp = GetNextTimeStamp();
+  }
+  
+  template <class SCAL>
+  bool S_BilinearForm<SCAL> :: BatchAssemblyPossible (VorB vb) const
+  {
+    if (!batch_assembly || !is_same<SCAL,double>::value) return false;
+    if (printelmat || elmat_ev) return false;
+    if (eliminate_internal || eliminate_hidden) return false;
+    if (preconditioners.Size()) return false;
+    for (auto & bfi : VB_parts[vb])
+      if (bfi->GetDefinedOnElements() || bfi->GetDeformation())
+        return false;
+    return true;
+  }
+
+  
+  template <class SCAL>
+  void S_BilinearForm<SCAL> :: AssembleElementBatches (VorB vb, Array<bool> & useddof, LocalHeap & clh)
+  {
+    static Timer t("Matrix assembling batched");
+    RegionTimer reg(t);
+    constexpr size_t batchsize = 16;
+    
+    if constexpr (is_same<SCAL,double>::value)
+      {
+        IterateAssemblyElementBatches
+          (vb, batchsize, clh, [&] (FlatArray<ElementId> eis, LocalHeap & lh)
+           {
+             size_t n = eis.Size();
+             ArrayMem<DofId,100> temp_dnums;
+             FlatArray<const FiniteElement*> fels(n, lh);
+             FlatArray<const ElementTransformation*> trafos(n, lh);
+             FlatArray<FlatArray<DofId>> dnums(n, lh);
+             FlatArray<FlatMatrix<double>> elmats(n, lh);
+             FlatArray<bool> grouped(n, lh);
+             grouped = false;
+             
+             for (size_t i = 0; i < n; i++)
+               {
+                 fels[i] = &fespace->GetFE (eis[i], lh);
+                 trafos[i] = &ma->GetTrafo (eis[i], lh);
+                 fespace->GetDofNrs (eis[i], temp_dnums);
+                 CheckElementDofs (*fels[i], temp_dnums, vb);
+                 new (&dnums[i]) FlatArray<DofId> (temp_dnums.Size(), lh);
+                 for (size_t k = 0; k < temp_dnums.Size(); k++)
+                   dnums[i][k] = temp_dnums[k];
+                 size_t elmat_size = temp_dnums.Size()*fespace->GetDimension();
+                 new (&elmats[i]) FlatMatrix<double> (elmat_size, elmat_size, lh);
+               }
+             
+             for (size_t i = 0; i < n; i++)
+               {
+                 if (grouped[i]) continue;
+                 
+                 // elements of same type, order and material as element i
+                 ArrayMem<size_t,batchsize> group;
+                 for (size_t j = i; j < n; j++)
+                   if (!grouped[j] &&
+                       typeid(*fels[j]) == typeid(*fels[i]) &&
+                       fels[j]->ElementType() == fels[i]->ElementType() &&
+                       fels[j]->GetNDof() == fels[i]->GetNDof() &&
+                       trafos[j]->GetElementIndex() == trafos[i]->GetElementIndex())
+                     {
+                       group.Append (j);
+                       grouped[j] = true;
+                     }
+                 
+                 FlatArray<const FiniteElement*> gfels(group.Size(), lh);
+                 FlatArray<const ElementTransformation*> gtrafos(group.Size(), lh);
+                 FlatArray<FlatMatrix<double>> gelmats(group.Size(), lh);
+                 for (size_t k = 0; k < group.Size(); k++)
+                   {
+                     gfels[k] = fels[group[k]];
+                     gtrafos[k] = trafos[group[k]];
+                     new (&gelmats[k]) FlatMatrix<double> (elmats[group[k]]);
+                   }
+                 
+                 int index = trafos[i]->GetElementIndex();
+                 bool elem_has_integrator = false;
+                 bool done = false;
+                 while (!done)
+                   {
+                     done = true;
+                     for (auto & elmat : gelmats)
+                       elmat = 0.0;
+                     bool symmetric_so_far = true;
+                     for (auto & bfi : VB_parts[vb])
+                       {
+                         if (!bfi->DefinedOn (index)) continue;
+                         elem_has_integrator = true;
+                         try
+                           {
+                             bfi->CalcElementMatricesAdd (gfels, gtrafos, gelmats, symmetric_so_far, lh);
+                           }
+                         catch (ExceptionNOSIMD & e)
+                           {
+                             done = false;
+                           }
+                       }
+                   }
+                 if (!elem_has_integrator) continue;
+                 
+                 for (size_t j : group)
+                   {
+                     fespace->TransformMat (eis[j], elmats[j], TRANSFORM_MAT_LEFT_RIGHT);
+                     AddElementMatrixPlanned (dnums[j], elmats[j], eis[j], lh);
+                     if (check_unused)
+                       for (auto d : dnums[j])
+                         if (IsRegularDof(d)) useddof[d] = true;
+                   }
+               }
+           });
+      }
+    else
+      throw Exception ("batched assembly only for real forms");
+  }
+
+  
   template <class SCAL>
   void S_BilinearForm<SCAL> :: AllocateInternalMatrices ()
   {
@@ -991,9 +1279,13 @@ namespace ngcomp
     RegionTimer reg (mattimer);
 
     timestamp = ++global_timestamp;
+
+    // integrators were checked when the assembly plan was built
+    bool plan_valid = AssemblyPlanValid();
     
     mattimer_checkintegrators.Start();
     // check if integrators fit to space
+    if (!plan_valid)
     for(VorB vb : {VOL,BND,BBND})
       {
 	for(auto bfi : VB_parts[vb])
@@ -1058,6 +1350,9 @@ namespace ngcomp
             for (auto pre : preconditioners)
               pre -> InitLevel(fespace->GetFreeDofs());
 
+            if (assembly_plan && !diagonal && !plan_valid)
+              PrepareAssemblyPlan (clh);
+            
 	    mattimer1a.Stop();
 
 	    for (VorB vb : { VOL, BND, BBND })
@@ -1142,6 +1437,11 @@ namespace ngcomp
                       }
                     cout << IM(3) << "\rassemble element " << ne << "/" << ne << endl;
                   }
+                else if (BatchAssemblyPossible(vb))
+                  {
+                    AssembleElementBatches (vb, useddof, clh);
+                    gcnt += ne;
+                  }
                 else // not diagonal
                   {
                     ProgressOutput progress(ma,string("assemble ") + ToString(vb) + string(" element"), ma->GetNE(vb));
@@ -1158,8 +1458,8 @@ namespace ngcomp
                           innermatrix = make_shared<ElementByElementMatrix<SCAL>>(ndof, ne);
                       }
                     */
-                    IterateElements
-                      (*fespace, vb, clh,  [&] (FESpace::Element el, LocalHeap & lh)
+                    IterateAssemblyElements
+                      (vb, clh,  [&] (FESpace::Element el, LocalHeap & lh)
                        {
                          if (elmat_ev && vb == VOL) 
                            *testout << " Assemble Element " << el.Nr() << endl;  
@@ -1170,15 +1470,7 @@ namespace ngcomp
                          const ElementTransformation & eltrans = ma->GetTrafo (el, lh);
                          FlatArray<int> dnums = el.GetDofs();
                          
-                         if (fel.GetNDof() != dnums.Size())
-                           {
-                             *testout << "Info from finite element: " << endl;
-                             fel.Print (*testout);
-                             (*testout) << "fel::GetNDof() = " << fel.GetNDof() << endl;
-                             (*testout) << "dnums.Size() = " << dnums.Size() << endl;
-                             (*testout) << "dnums = " << dnums << endl;
-                             throw Exception ( string("Inconsistent number of degrees of freedom, vb="+ToString(vb)+" fel::GetNDof() = ") + ToString(fel.GetNDof()) + string(" != dnums.Size() = ") + ToString(dnums.Size()) + string("!") );
-                           }
+                         CheckElementDofs (fel, dnums, vb);
                          
                          int elmat_size = dnums.Size()*fespace->GetDimension();
                          FlatMatrix<SCAL> sum_elmat(elmat_size, lh);
@@ -1605,7 +1897,7 @@ namespace ngcomp
                              *testout<< "elem " << el << ", elmat = " << endl << sum_elmat << endl;
                            }
                          
-                         AddElementMatrix (dnums, dnums, sum_elmat, el, lh);
+                         AddElementMatrixPlanned (dnums, sum_elmat, el, lh);
 			 
                          for (auto pre : preconditioners)
                            pre -> AddElementMatrix (dnums, sum_elmat, el, lh);
@@ -1674,7 +1966,7 @@ namespace ngcomp
                   }
                 
                 ProgressOutput progress(ma,string("assemble inner facet"), nf);
-                for (auto colfacets : fespace->FacetColoring())
+                for (auto colfacets : AssemblyFacetColoring())
                 {
                   SharedLoop2 sl(colfacets.Size());
                   ParallelJob
@@ -3069,6 +3361,9 @@ namespace ngcomp
         for (auto pre : preconditioners)
           pre -> InitLevel(fespace->GetFreeDofs());
 
+        if (assembly_plan && !AssemblyPlanValid())
+          PrepareAssemblyPlan (clh);
+
         for (VorB vb : { VOL, BND, BBND, BBBND })
           if (VB_parts[vb].Size())
           {
@@ -3091,8 +3386,8 @@ namespace ngcomp
               }
             */
             
-            IterateElements 
-              (*fespace, vb, clh,  [&] (FESpace::Element el, LocalHeap & lh)
+            IterateAssemblyElements
+              (vb, clh,  [&] (FESpace::Element el, LocalHeap & lh)
                {
                  const FiniteElement & fel = fespace->GetFE (el, lh);
                  ElementTransformation & eltrans = ma->GetTrafo (el, lh);
@@ -3384,7 +3679,7 @@ namespace ngcomp
                    }
                  
 
-                 AddElementMatrix (dnums, dnums, sum_elmat, el, lh);
+                 AddElementMatrixPlanned (dnums, sum_elmat, el, lh);
 
                  for (auto pre : preconditioners)
                    pre -> AddElementMatrix (dnums, sum_elmat, el, lh);
@@ -5671,10 +5966,22 @@ namespace ngcomp
                     ElementId id,
                     LocalHeap & lh) 
   {
-    mymatrix -> TMATRIX::AddElementMatrix (dnums1, dnums2, elmat, this->fespace->HasAtomicDofs());
+    mymatrix -> TMATRIX::AddElementMatrix (dnums1, dnums2, elmat,
+                                           this->fespace->HasAtomicDofs() || this->UseAtomicAssembly());
   }
 
 
+  template <class TM, class TV>
+  void T_BilinearForm<TM,TV>::
+  AddElementMatrixPlanned (FlatArray<int> dnums,
+                           BareSliceMatrix<TSCAL> elmat,
+                           ElementId id,
+                           LocalHeap & lh)
+  {
+    if (!this->AddElementMatrixByPlan (*mymatrix, dnums, elmat, id))
+      AddElementMatrix (dnums, dnums, elmat, id, lh);
+  }
+
   template <class TM, class TV>
   void T_BilinearForm<TM,TV>::LapackEigenSystem(FlatMatrix<TSCAL> & elmat, LocalHeap & lh) const 
   {
@@ -5785,7 +6092,8 @@ namespace ngcomp
                     ElementId id, 
                     LocalHeap & lh) 
   {
-    mymatrix -> TMATRIX::AddElementMatrixSymmetric (dnums1, elmat, this->fespace->HasAtomicDofs());
+    mymatrix -> TMATRIX::AddElementMatrixSymmetric (dnums1, elmat,
+                                                    this->fespace->HasAtomicDofs() || this->UseAtomicAssembly());
   }
 
 
@@ -5793,6 +6101,18 @@ namespace ngcomp
 
 
 
+  template <class TM, class TV>
+  void T_BilinearFormSymmetric<TM,TV>::
+  AddElementMatrixPlanned (FlatArray<int> dnums,
+                           BareSliceMatrix<TSCAL> elmat,
+                           ElementId id,
+                           LocalHeap & lh)
+  {
+    if (!this->AddElementMatrixByPlan (*mymatrix, dnums, elmat, id))
+      AddElementMatrix (dnums, dnums, elmat, id, lh);
+  }
+
+
   template <class TM, class TV>
   void T_BilinearFormSymmetric<TM,TV>::LapackEigenSystem(FlatMatrix<TSCAL> & elmat, LocalHeap & lh) const
   {
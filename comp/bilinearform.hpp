@@ -114,6 +114,26 @@ namespace ngcomp
     Array<void*> precomputed_data;
     /// output of norm of matrix entries
     bool checksum;
+
+    /// element matrices computed for batches of similar elements
+    bool batch_assembly = false;
+    /// parallel assembly without coloring, conflicts resolved by atomic adds
+    bool atomic_assembly = false;
+    /// all facets as one color, for atomic assembly of facet integrals
+    Table<int> uncolored_facets;
+    
+    /// cache matrix positions of element matrices for re-assembly
+    bool assembly_plan = false;
+    /// positions of element-matrix entries in the sparse matrix, filled
+    /// at first assembly, reused while mesh, space and graph are unchanged.
+    /// Only the scatter is search-free, dof numbers and mapped integration
+    /// rules are computed at every assembly (in the LocalHeap)
+    struct AssemblyPlan
+    {
+      size_t timestamp = 0;
+      Table<size_t> positions[3];
+      Array<bool> filled[3];
+    } plan;
     
     mutable std::map<size_t, Matrix<>> precomputed;
   public:
@@ -374,6 +394,23 @@ namespace ngcomp
     void SetPrintElmat (bool ap);
     void SetElmatEigenValues (bool ee);
     void SetCheckUnused (bool b);
+    void SetAssemblyPlan (bool b);
+    void SetAtomicAssembly (bool b);
+    void SetBatchAssembly (bool b);
+    /// element and facet loops run uncolored and scatter with atomic adds
+    bool UseAtomicAssembly () const;
+    /// element loop of the assembly, colored or uncolored
+    void IterateAssemblyElements (VorB vb, LocalHeap & clh,
+                                  const function<void(FESpace::Element,LocalHeap&)> & func) const;
+    /// same element loop, for chunks of at most batchsize elements
+    void IterateAssemblyElementBatches (VorB vb, size_t batchsize, LocalHeap & clh,
+                                        const function<void(FlatArray<ElementId>,LocalHeap&)> & func) const;
+    /// throws if finite element and space disagree on the number of dofs
+    void CheckElementDofs (const FiniteElement & fel, FlatArray<DofId> dnums, VorB vb) const;
+    /// facet coloring of the assembly, a single color for atomic assembly
+    const Table<int> & AssemblyFacetColoring ();
+    /// plan is built and still matches matrix graph, space and mesh
+    bool AssemblyPlanValid () const;
     
     /// computes low-order matrices from fines matrix
     void GalerkinProjection ();
@@ -570,6 +607,44 @@ namespace ngcomp
 				   ElementId id, 
 				   LocalHeap & lh) = 0;
 
+    /// element matrix of the element loop, scattered via the assembly plan if enabled
+    virtual void AddElementMatrixPlanned (FlatArray<int> dnums,
+                                          BareSliceMatrix<SCAL> elmat,
+                                          ElementId id,
+                                          LocalHeap & lh)
+    {
+      AddElementMatrix (dnums, dnums, elmat, id, lh);
+    }
+
+    void PrepareAssemblyPlan (LocalHeap & lh);
+
+    /// scatters elmat at the positions of the assembly plan,
+    /// false if the plan does not cover the element
+    template <typename TMAT>
+    bool AddElementMatrixByPlan (TMAT & mat, FlatArray<int> dnums,
+                                 BareSliceMatrix<SCAL> elmat, ElementId id)
+    {
+      VorB vb = id.VB();
+      if (!assembly_plan || vb > BBND || id.Nr() >= plan.filled[vb].Size() ||
+          plan.positions[vb][id.Nr()].Size() != sqr(dnums.Size()))
+        return false;
+
+      FlatArray<size_t> pos = plan.positions[vb][id.Nr()];
+      if (!plan.filled[vb][id.Nr()])
+        {
+          mat.GetElementMatrixPositions (dnums, dnums, pos);
+          plan.filled[vb][id.Nr()] = true;
+        }
+      mat.AddElementMatrixAt (pos, dnums.Size(), elmat,
+                              fespace->HasAtomicDofs() || UseAtomicAssembly());
+      return true;
+    }
+
+    /// batched element matrices are possible for the element loop of vb
+    bool BatchAssemblyPossible (VorB vb) const;
+    /// element loop computing element matrices for batches of similar elements
+    void AssembleElementBatches (VorB vb, Array<bool> & useddof, LocalHeap & clh);
+
     /*
     virtual void ApplyElementMatrix(const BaseVector & x,
 				    BaseVector & y,
@@ -667,6 +742,11 @@ namespace ngcomp
 				   ElementId id, 
 				   LocalHeap & lh);
 
+    virtual void AddElementMatrixPlanned (FlatArray<int> dnums,
+                                          BareSliceMatrix<TSCAL> elmat,
+                                          ElementId id,
+                                          LocalHeap & lh);
+
     virtual void LapackEigenSystem(FlatMatrix<TSCAL> & elmat, LocalHeap & lh) const;
   };
 
@@ -703,6 +783,11 @@ namespace ngcomp
                                    BareSliceMatrix<TSCAL> elmat,
 				   ElementId id, 
 				   LocalHeap & lh);
+
+    virtual void AddElementMatrixPlanned (FlatArray<int> dnums,
+                                          BareSliceMatrix<TSCAL> elmat,
+                                          ElementId id,
+                                          LocalHeap & lh);
     /*
     virtual void ApplyElementMatrix(const BaseVector & x,
 				    BaseVector & y,
@@ -156,38 +156,156 @@ namespace ngcomp
     return L2Norm(pmaster-p);
   }
 
-  template<int DIM>
-  optional<ContactPair<DIM>> T_GapFunction<DIM> :: CreateContactPair(const MappedIntegrationPoint<DIM-1, DIM>& mip1, LocalHeap& lh) const
+  template <int DIM>
+  void ContactSearchTree<DIM> :: Build (FlatArray<int> els,
+                                        FlatArray<Vec<DIM>> pmin, FlatArray<Vec<DIM>> pmax)
   {
-    HeapReset hr(lh);
-    // int intorder2 = 10*displacement->GetFESpace()->GetOrder();
-    auto & ip1 = mip1.IP();
-    auto & trafo1 = mip1.GetTransformation();
-    const auto & el1 = ma->GetElement(trafo1.GetElementId());
-    auto & trafo1_def = trafo1.AddDeformation(displacement.get(), lh);
-    const auto & mip1_def = static_cast<const MappedIntegrationPoint<DIM-1, DIM>&>(trafo1_def(ip1, lh));
+    static Timer t("ContactSearchTree::Build"); RegionTimer reg(t);
+    size_t n = els.Size();
+    perm.SetSize(n);
+    for (auto i : Range(n))
+      perm[i] = i;
+    bmin = pmin;
+    bmax = pmax;
+    nodes.SetSize(2*n);
+    nodes = Node();
+    elnrs.SetSize(n);
+    if (n == 0) return;
+
+    // the upper levels are split serially, the subtrees are built in parallel
+    Array<INT<3>> subtrees;
+    BuildNode (0, 0, n, 6, &subtrees);
+    ParallelFor (subtrees.Size(), [&] (size_t i)
+      {
+        BuildNode (subtrees[i][0], subtrees[i][1], subtrees[i][2], -1, nullptr);
+      });
 
-    const auto & p1 = mip1_def.GetPoint();
+    Array<Vec<DIM>> hmin(n), hmax(n);
+    ParallelFor (n, [&] (size_t i)
+      {
+        elnrs[i] = els[perm[i]];
+        hmin[i] = bmin[perm[i]];
+        hmax[i] = bmax[perm[i]];
+      });
+    bmin = std::move(hmin);
+    bmax = std::move(hmax);
+    FitNodes();
+  }
 
-    // find closest point
+  // the subtree of node nr with m elements uses nodes nr ... nr+2m-2
+  template <int DIM>
+  void ContactSearchTree<DIM> :: BuildNode (int nr, int first, int next,
+                                            int levels, Array<INT<3>> * subtrees)
+  {
+    auto & node = nodes[nr];
+    if (next-first <= LEAFSIZE)
+      {
+        node.first = first;
+        node.size = next-first;
+        return;
+      }
+    if (levels == 0)
+      {
+        subtrees->Append(INT<3>(nr, first, next));
+        return;
+      }
+
+    // split at the median of the box centers, in the direction of largest extent
+    Vec<DIM> cmin = 1e99, cmax = -1e99;
+    for (int i = first; i < next; i++)
+      for (int j = 0; j < DIM; j++)
+        {
+          double c = bmin[perm[i]](j) + bmax[perm[i]](j);
+          cmin(j) = min2(cmin(j), c);
+          cmax(j) = max2(cmax(j), c);
+        }
+    int dir = 0;
+    for (int j = 1; j < DIM; j++)
+      if (cmax(j)-cmin(j) > cmax(dir)-cmin(dir))
+        dir = j;
+
+    int mid = (first+next)/2;
+    std::nth_element (&perm[first], &perm[mid], &perm[0]+next,
+                      [&] (int a, int b)
+                      {
+                        return bmin[a](dir)+bmax[a](dir) < bmin[b](dir)+bmax[b](dir);
+                      });
+    node.left = nr+1;
+    node.right = nr+2*(mid-first);
+    BuildNode (node.left, first, mid, levels-1, subtrees);
+    BuildNode (node.right, mid, next, levels-1, subtrees);
+  }
+
+  // children have larger numbers than their parent
+  template <int DIM>
+  void ContactSearchTree<DIM> :: FitNodes ()
+  {
+    ParallelFor (nodes.Size(), [&] (size_t nr)
+      {
+        auto & node = nodes[nr];
+        if (node.left >= 0 || node.size == 0) return;
+        node.pmin = 1e99;
+        node.pmax = -1e99;
+        for (int i = node.first; i < node.first+node.size; i++)
+          for (int j = 0; j < DIM; j++)
+            {
+              node.pmin(j) = min2(node.pmin(j), bmin[i](j));
+              node.pmax(j) = max2(node.pmax(j), bmax[i](j));
+            }
+      });
+    for (int nr = int(nodes.Size())-1; nr >= 0; nr--)
+      {
+        auto & node = nodes[nr];
+        if (node.left < 0) continue;
+        for (int j = 0; j < DIM; j++)
+          {
+            node.pmin(j) = min2(nodes[node.left].pmin(j), nodes[node.right].pmin(j));
+            node.pmax(j) = max2(nodes[node.left].pmax(j), nodes[node.right].pmax(j));
+          }
+      }
+  }
 
-    double mindist = h;
-    IntegrationPoint ip2_min;
-    bool intersect = false;
-    int el2_min(-1);
+  template <int DIM>
+  void ContactSearchTree<DIM> :: Refit (FlatArray<Vec<DIM>> pmin, FlatArray<Vec<DIM>> pmax)
+  {
+    static Timer t("ContactSearchTree::Refit"); RegionTimer reg(t);
+    if (pmin.Size() != elnrs.Size())
+      throw Exception("ContactSearchTree::Refit: number of boxes changed");
+    ParallelFor (elnrs.Size(), [&] (size_t i)
+      {
+        bmin[i] = pmin[perm[i]];
+        bmax[i] = pmax[perm[i]];
+      });
+    FitNodes();
+  }
 
+  template <int DIM>
+  double ContactSearchTree<DIM> :: Cost () const
+  {
+    double sum = 0;
+    for (auto & node : nodes)
+      if (node.left >= 0 || node.size > 0)
+        for (int j = 0; j < DIM; j++)
+          sum += node.pmax(j) - node.pmin(j);
+    return sum;
+  }
 
-    // find all bound-2 elements closer to p1 then h
+  template class ContactSearchTree<2>;
+  template class ContactSearchTree<3>;
 
-    netgen::Point<DIM> ngp1;
-    for (int j = 0; j < DIM; j++) ngp1(j) = p1(j);
-    netgen::Box<DIM> box(ngp1, ngp1);
-    box.Increase(h);
+  template<int DIM>
+  void T_GapFunction<DIM> :: FindClosestPoints (ElementId el1id, FlatMatrix<> p1, FlatMatrix<> nv,
+                                                FlatVector<> mindist, FlatArray<int> el2_min,
+                                                FlatArray<IntegrationPoint> ip2_min, FlatMatrix<> p2_min,
+                                                LocalHeap & lh) const
+  {
+    const auto & el1 = ma->GetElement(el1id);
+    el2_min = -1;
 
-    Vec<DIM> p2_min;
-    searchtree->GetFirstIntersecting
-      (box.PMin(), box.PMax(),
-       [&] (int elnr2)
+    // find all bound-2 elements closer to the points than h
+    searchtree.GetClose
+      (p1, h,
+       [&] (int elnr2, FlatArray<int> pnums)
        {
          auto el2 = ma->GetElement(ElementId(BND, elnr2));
          HeapReset hr(lh);
@@ -197,99 +315,149 @@ namespace ngcomp
            for (auto v : el2.Vertices() )
              if(s_v==v)
                common_vertex = true;
-         if (common_vertex) return false;
+         if (common_vertex) return;
 
          auto & trafo2 = ma->GetTrafo(el2, lh);
          auto & trafo2_def = trafo2.AddDeformation(displacement.get(), lh);
 
-         IntegrationPoint ip2;
-         Vec<DIM> p2;
-         double dist = FindClosestPoint<DIM-1,DIM>(p1, mip1_def.GetNV(), mindist, trafo2_def, ip2, p2 );
-         if(dist<mindist && dist < h)
-         {
-           mindist = dist;
-           el2_min = el2.Nr();
-           ip2_min = ip2;
-           p2_min = p2;
-           intersect = true;
-         }
-         return false;
+         for (auto i : pnums)
+           {
+             IntegrationPoint ip2;
+             Vec<DIM> p2;
+             double dist = FindClosestPoint<DIM-1,DIM>(p1.Row(i), nv.Row(i), mindist(i), trafo2_def, ip2, p2 );
+             if(dist<mindist(i) && dist < h)
+               {
+                 mindist(i) = dist;
+                 el2_min[i] = el2.Nr();
+                 ip2_min[i] = ip2;
+                 p2_min.Row(i) = p2;
+               }
+           }
        });
+  }
 
-    if(intersect)
-    {
-      return ContactPair<DIM>{el1, ElementId(BND,el2_min),
-          ip1, ip2_min};
-    }
+  template<int DIM>
+  optional<ContactPair<DIM>> T_GapFunction<DIM> :: CreateContactPair(const MappedIntegrationPoint<DIM-1, DIM>& mip1, LocalHeap& lh) const
+  {
+    HeapReset hr(lh);
+    auto & ip1 = mip1.IP();
+    auto & trafo1 = mip1.GetTransformation();
+    auto & trafo1_def = trafo1.AddDeformation(displacement.get(), lh);
+    const auto & mip1_def = static_cast<const MappedIntegrationPoint<DIM-1, DIM>&>(trafo1_def(ip1, lh));
+
+    // find closest point
+    FlatMatrix<> p1(1, DIM, lh), nv(1, DIM, lh), p2(1, DIM, lh);
+    p1.Row(0) = mip1_def.GetPoint();
+    nv.Row(0) = mip1_def.GetNV();
+    Vector<> mindist(1);
+    mindist = h;
+    ArrayMem<int,1> el2(1);
+    ArrayMem<IntegrationPoint,1> ip2(1);
+    FindClosestPoints (trafo1.GetElementId(), p1, nv, mindist, el2, ip2, p2, lh);
+
+    if(el2[0] >= 0)
+      return ContactPair<DIM>{trafo1.GetElementId(), ElementId(BND,el2[0]),
+          ip1, ip2[0]};
     return nullopt;
   }
 
+  template<int DIM>
+  void T_GapFunction<DIM> :: CreateContactPairs(const MappedIntegrationRule<DIM-1, DIM>& mir1, LocalHeap& lh,
+                                                Array<ContactPair<DIM>>& pairs) const
+  {
+    HeapReset hr(lh);
+    auto & trafo1 = mir1.GetTransformation();
+    auto & trafo1_def = trafo1.AddDeformation(displacement.get(), lh);
+    MappedIntegrationRule<DIM-1, DIM> mir1_def(mir1.IR(), trafo1_def, lh);
+
+    size_t np = mir1.Size();
+    FlatMatrix<> p1(np, DIM, lh), nv(np, DIM, lh), p2(np, DIM, lh);
+    for (auto i : Range(np))
+      {
+        p1.Row(i) = mir1_def[i].GetPoint();
+        nv.Row(i) = mir1_def[i].GetNV();
+      }
+    FlatVector<> mindist(np, lh);
+    mindist = h;
+    FlatArray<int> el2(np, lh);
+    FlatArray<IntegrationPoint> ip2(np, lh);
+    FindClosestPoints (trafo1.GetElementId(), p1, nv, mindist, el2, ip2, p2, lh);
+
+    for (auto i : Range(np))
+      if (el2[i] >= 0)
+        pairs.Append (ContactPair<DIM>{trafo1.GetElementId(), ElementId(BND,el2[i]),
+              mir1[i].IP(), ip2[i]});
+  }
+
   template<int DIM>
   void T_GapFunction<DIM> :: Update(shared_ptr<GridFunction> displacement_, int intorder2, double h_)
   {
+    static Timer t("T_GapFunction::Update"); RegionTimer reg(t);
     h = h_;
 
     displacement = displacement_;
     auto fes = displacement->GetFESpace();
     intorder2 = 10*fes->GetOrder();
 
-    LocalHeap lh(1000000, "T_GapFunction::Update");
-    netgen::Box<DIM> bbox{netgen::Box<DIM>::EMPTY_BOX};
-    double maxh = 0;
+    Array<int> els;
+    auto & mask = other.Mask();
     for (Ngs_Element el2 : ma->Elements(BND))
-      {
-        HeapReset hr(lh);
-        auto & mask = other.Mask();
-        if (!mask.Test(el2.GetIndex())) continue;
+      if (mask.Test(el2.GetIndex()))
+        els.Append(el2.Nr());
 
-        auto & trafo2 = ma->GetTrafo (el2, lh);
-        auto & trafo2_def = trafo2.AddDeformation(displacement.get(), lh);
+    // boxes of the deformed elements
+    Array<Vec<DIM>> pmin(els.Size()), pmax(els.Size());
+    Array<double> diam(els.Size());
+    ParallelForRange (els.Size(), [&] (IntRange r)
+      {
+        LocalHeap lh(1000000, "T_GapFunction::Update");
+        for (auto i : r)
+          {
+            HeapReset hr(lh);
+            auto & trafo2 = ma->GetTrafo (ElementId(BND, els[i]), lh);
+            auto & trafo2_def = trafo2.AddDeformation(displacement.get(), lh);
 
-        IntegrationRule ir2(trafo2.GetElementType(), intorder2);
-        MappedIntegrationRule<DIM-1, DIM> mir2(ir2, trafo2, lh);
-        MappedIntegrationRule<DIM-1, DIM> mir2_def(ir2, trafo2_def, lh);
+            IntegrationRule ir2(trafo2.GetElementType(), intorder2);
+            MappedIntegrationRule<DIM-1, DIM> mir2_def(ir2, trafo2_def, lh);
 
-        netgen::Box<DIM> el_box{netgen::Box<DIM>::EMPTY_BOX};
-        for (auto & mip : mir2_def)
-          {
-            netgen::Point<DIM> p;
-            for (int j = 0; j < DIM; j++)
-              p(j) = mip.GetPoint()(j);
-            bbox.Add(p);
-            if(h==0.0)
-              el_box.Add(p);
+            pmin[i] = 1e99;
+            pmax[i] = -1e99;
+            for (auto & mip : mir2_def)
+              for (int j = 0; j < DIM; j++)
+                {
+                  pmin[i](j) = min2(pmin[i](j), mip.GetPoint()(j));
+                  pmax[i](j) = max2(pmax[i](j), mip.GetPoint()(j));
+                }
+            diam[i] = L2Norm(pmax[i]-pmin[i]);
           }
-        maxh = max(maxh, el_box.Diam());
-      }
+      });
 
     // Default-value for h is 2 * maximum_element_diameter
     if(h==0.0)
-      h = 2*maxh;
-
-    searchtree = make_unique<netgen::BoxTree<DIM, int>>(bbox);
-    for (Ngs_Element el2 : ma->Elements(BND))
       {
-        HeapReset hr(lh);
-        auto & mask = other.Mask();
-        if (!mask.Test(el2.GetIndex())) continue;
-
-        auto & trafo2 = ma->GetTrafo (el2, lh);
-        auto & trafo2_def = trafo2.AddDeformation(displacement.get(), lh);
+        double maxh = 0;
+        for (auto d : diam)
+          maxh = max(maxh, d);
+        h = 2*maxh;
+      }
 
-        IntegrationRule ir2(trafo2.GetElementType(), intorder2);
-        MappedIntegrationRule<DIM-1, DIM> mir2(ir2, trafo2, lh);
-        MappedIntegrationRule<DIM-1, DIM> mir2_def(ir2, trafo2_def, lh);
+    // same elements: refit the boxes, rebuild only if the tree degenerated
+    bool same_elements = searchtree.Size() == els.Size() && mesh_timestamp == ma->GetTimeStamp();
+    for (auto i : Range(els))
+      if (same_elements && els[i] != other_els[i])
+        same_elements = false;
 
-        for (auto & mip : mir2_def)
-          {
-            netgen::Point<DIM> p;
-            for (int j = 0; j < DIM; j++)
-              p(j) = mip.GetPoint()(j);
-            bbox.Add(p);
-          }
-
-        searchtree->Insert(bbox, el2.Nr());
+    if (same_elements)
+      {
+        searchtree.Refit(pmin, pmax);
+        if (searchtree.Cost() <= 2*built_cost)
+          return;
       }
+
+    searchtree.Build(els, pmin, pmax);
+    built_cost = searchtree.Cost();
+    other_els = std::move(els);
+    mesh_timestamp = ma->GetTimeStamp();
   }
 
   template<int DIM>
@@ -302,52 +470,26 @@ namespace ngcomp
     result = 0;
     if (!master.Mask().Test(el1.GetIndex())) return;
 
-    // int intorder2 = 2*displacement->GetFESpace()->GetOrder();
-
     auto & trafo1_def = trafo1.AddDeformation(displacement.get(), lh);
 
     auto & ip1 = ip.IP();
-    Vec<DIM> p1;
-    trafo1_def.CalcPoint(ip1, p1);
-
-    double mindist = 1e99;
-    result = std::numeric_limits<double>::infinity();
-
-    // find all bound-2 elements closer to p1 than h
-    netgen::Point<DIM> ngp1;
-    for (int j = 0; j < DIM; j++)
-      ngp1(j) = p1(j);
-    netgen::Box<DIM> box(ngp1, ngp1);
-    box.Increase(h);
-
+    Vec<DIM> hp1;
+    trafo1_def.CalcPoint(ip1, hp1);
     auto & mip = static_cast<const DimMappedIntegrationPoint<DIM>&>(ip);
 
-    searchtree->GetFirstIntersecting
-      (box.PMin(), box.PMax(),
-       [&] (int elnr2)
-       {
-         auto el2 = ma->GetElement( ElementId (BND, elnr2) );
-         HeapReset hr(lh);
-
-         bool common_vertex = false;
-         for (auto s_v : el1.Vertices() )
-           for (auto v : el2.Vertices() )
-             if(s_v==v)
-               common_vertex = true;
-         if (common_vertex) return false;
-         auto & trafo2 = ma->GetTrafo (el2, lh);
-         auto & trafo2_def = trafo2.AddDeformation(displacement.get(), lh);
-
-         Vec<DIM> p2;
-         IntegrationPoint ip2;
-         double dist = FindClosestPoint<DIM-1,DIM>(p1, mip.GetNV(), mindist, trafo2_def, ip2, p2 );
-         if(dist<mindist && dist < h)
-         {
-           mindist = dist;
-           result = p2-p1;
-         }
-         return false;
-       });
+    FlatMatrix<> p1(1, DIM, lh), nv(1, DIM, lh), p2(1, DIM, lh);
+    p1.Row(0) = hp1;
+    nv.Row(0) = mip.GetNV();
+    Vector<> mindist(1);
+    mindist = 1e99;
+    ArrayMem<int,1> el2(1);
+    ArrayMem<IntegrationPoint,1> ip2(1);
+    FindClosestPoints (trafo1.GetElementId(), p1, nv, mindist, el2, ip2, p2, lh);
+
+    if (el2[0] >= 0)
+      result = p2.Row(0) - p1.Row(0);
+    else
+      result = std::numeric_limits<double>::infinity();
   }
 
   template<int DIM>
@@ -355,8 +497,40 @@ namespace ngcomp
                                       BareSliceMatrix<> hresult) const
   {
     auto result = hresult.AddSize(mir.Size(), Dimension());
-    for (auto i : Range(mir))
-      Evaluate(mir[i], result.Row(i));
+    auto & trafo1 = mir.GetTransformation();
+    const auto & el1 = ma->GetElement(trafo1.GetElementId());
+    result = 0;
+    if (!master.Mask().Test(el1.GetIndex())) return;
+    if (trafo1.VB() != BND || mir.DimSpace() != DIM)
+      {
+        for (auto i : Range(mir))
+          Evaluate(mir[i], result.Row(i));
+        return;
+      }
+
+    // all points of the element in one search
+    LocalHeapMem<100000> lh("gapfunction");
+    auto & trafo1_def = trafo1.AddDeformation(displacement.get(), lh);
+    size_t np = mir.Size();
+    FlatMatrix<> p1(np, DIM, lh), nv(np, DIM, lh), p2(np, DIM, lh);
+    for (auto i : Range(np))
+      {
+        Vec<DIM> hp1;
+        trafo1_def.CalcPoint(mir[i].IP(), hp1);
+        p1.Row(i) = hp1;
+        nv.Row(i) = static_cast<const DimMappedIntegrationPoint<DIM>&>(mir[i]).GetNV();
+      }
+    FlatVector<> mindist(np, lh);
+    mindist = 1e99;
+    FlatArray<int> el2(np, lh);
+    FlatArray<IntegrationPoint> ip2(np, lh);
+    FindClosestPoints (trafo1.GetElementId(), p1, nv, mindist, el2, ip2, p2, lh);
+
+    for (auto i : Range(np))
+      if (el2[i] >= 0)
+        result.Row(i) = p2.Row(i) - p1.Row(i);
+      else
+        result.Row(i) = std::numeric_limits<double>::infinity();
   }
 
   template class T_GapFunction<2>;
@@ -859,28 +1033,26 @@ namespace ngcomp
                       auto& trafo = mesh->GetTrafo(el, lh);
                       IntegrationRule ir(trafo.GetElementType(), intorder);
                       MappedIntegrationRule<DIM-1, DIM> mir(ir, trafo, lh);
-                      for(const auto& mip : mir)
+                      Array<ContactPair<DIM>> pairs;
+                      tgap->CreateContactPairs(mir, lh, pairs);
+                      for(const auto& pair : pairs)
                         {
-                          auto pair = tgap->CreateContactPair(mip, lh);
-                          if(pair.has_value())
-                            {
-                              lock_guard<mutex> guard(add_mutex);
-                              bf->AddSpecialElement(make_unique<ContactElement<DIM>>(*pair, this));
-                              if(draw_pairs)
-                              {
-                                HeapReset hr(lh);
-                                auto & t1_def = trafo.AddDeformation(displacement.get(), lh);
-                                Vec<3> p1 = 0;
-                                t1_def.CalcPoint(pair->master_ip, p1);
-                                master_points.Append(p1);
-
-                                auto & t2 = mesh->GetTrafo(pair->other_el, lh);
-                                auto & t2_def = t2.AddDeformation(displacement.get(), lh);
-                                Vec<3> p2 = 0;
-                                t2_def.CalcPoint(pair->other_ip, p2);
-                                other_points.Append(p2);
-                              }
-                            }
+                          lock_guard<mutex> guard(add_mutex);
+                          bf->AddSpecialElement(make_unique<ContactElement<DIM>>(pair, this));
+                          if(draw_pairs)
+                          {
+                            HeapReset hr(lh);
+                            auto & t1_def = trafo.AddDeformation(displacement.get(), lh);
+                            Vec<3> p1 = 0;
+                            t1_def.CalcPoint(pair.master_ip, p1);
+                            master_points.Append(p1);
+
+                            auto & t2 = mesh->GetTrafo(pair.other_el, lh);
+                            auto & t2_def = t2.AddDeformation(displacement.get(), lh);
+                            Vec<3> p2 = 0;
+                            t2_def.CalcPoint(pair.other_ip, p2);
+                            other_points.Append(p2);
+                          }
                         }
                     });
                }
@@ -12,6 +12,131 @@ namespace ngcomp
     IntegrationPoint master_ip, other_ip;
   };
 
+  // Bounding volume hierarchy over element boxes. The tree is built in
+  // parallel, for small deformations the boxes are refitted instead of
+  // rebuilding the tree.
+  template <int DIM>
+  class ContactSearchTree
+  {
+    struct Node
+    {
+      Vec<DIM> pmin, pmax;
+      int left = -1, right = -1;    // children, -1 for leaves
+      int first = 0, size = 0;      // element range of leaves
+    };
+    Array<Node> nodes;
+    Array<int> elnrs;               // element numbers in tree order
+    Array<int> perm;                // tree order -> input order
+    Array<Vec<DIM>> bmin, bmax;     // element boxes in tree order
+    static constexpr int LEAFSIZE = 4;
+
+    void BuildNode (int nr, int first, int next, int levels, Array<INT<3>> * subtrees);
+    void FitNodes ();
+
+    // func(i) for all elements i (in tree order) with box intersecting [pmin,pmax]
+    template <typename FUNC>
+    void IterateIntersecting (const Vec<DIM> & pmin, const Vec<DIM> & pmax, FUNC && func) const
+    {
+      if (elnrs.Size() == 0) return;
+      ArrayMem<int, 64> stack;
+      stack.Append(0);
+      while (stack.Size())
+        {
+          auto & node = nodes[stack.Last()];
+          stack.DeleteLast();
+          bool overlap = true;
+          for (int j = 0; j < DIM; j++)
+            if (node.pmin(j) > pmax(j) || node.pmax(j) < pmin(j))
+              overlap = false;
+          if (!overlap) continue;
+          if (node.left >= 0)
+            {
+              stack.Append(node.left);
+              stack.Append(node.right);
+              continue;
+            }
+          for (int i = node.first; i < node.first+node.size; i++)
+            {
+              bool el_overlap = true;
+              for (int j = 0; j < DIM; j++)
+                if (bmin[i](j) > pmax(j) || bmax[i](j) < pmin(j))
+                  el_overlap = false;
+              if (el_overlap)
+                func(i);
+            }
+        }
+    }
+
+  public:
+    void Build (FlatArray<int> els, FlatArray<Vec<DIM>> pmin, FlatArray<Vec<DIM>> pmax);
+    // new boxes of the same elements, in the order given to Build
+    void Refit (FlatArray<Vec<DIM>> pmin, FlatArray<Vec<DIM>> pmax);
+    size_t Size () const { return elnrs.Size(); }
+    // sum of extents of all node boxes, grows if refitted boxes overlap
+    double Cost () const;
+
+    template <typename FUNC>
+    void GetIntersecting (const Vec<DIM> & pmin, const Vec<DIM> & pmax, FUNC && func) const
+    {
+      IterateIntersecting (pmin, pmax, [&] (int i) { func(elnrs[i]); });
+    }
+
+    // batched query for the points (rows of points) of one element: the tree
+    // is traversed once with the box of all points, candidate elements are
+    // tested against all points with SIMD. func(elnr, pnums) gets the points
+    // closer than h to the element box
+    template <typename FUNC>
+    void GetClose (FlatMatrix<> points, double h, FUNC && func) const
+    {
+      constexpr size_t SW = SIMD<double>::Size();
+      size_t np = points.Height();
+      if (np == 0) return;
+      size_t nchunks = (np+SW-1)/SW;
+      STACK_ARRAY(SIMD<double>, mem, DIM*nchunks);
+      FlatMatrix<SIMD<double>> simd_points(DIM, nchunks, mem);
+      Vec<DIM> pmin = 1e99, pmax = -1e99;
+      for (int j = 0; j < DIM; j++)
+        {
+          for (size_t i = 0; i < np; i++)
+            {
+              pmin(j) = min2(pmin(j), points(i,j));
+              pmax(j) = max2(pmax(j), points(i,j));
+            }
+          for (size_t k = 0; k < nchunks; k++)
+            simd_points(j,k) = SIMD<double>([&] (int lane)
+              { return k*SW+lane < np ? points(k*SW+lane,j) : 1e99; });
+        }
+      for (int j = 0; j < DIM; j++)
+        {
+          pmin(j) -= h;
+          pmax(j) += h;
+        }
+
+      ArrayMem<int, 64> close;
+      IterateIntersecting (pmin, pmax, [&] (int i)
+        {
+          close.SetSize0();
+          for (size_t k = 0; k < nchunks; k++)
+            {
+              // maximum norm distance of the points to the element box
+              SIMD<double> dist(-1e99);
+              for (int j = 0; j < DIM; j++)
+                {
+                  SIMD<double> below = SIMD<double>(bmin[i](j)) - simd_points(j,k);
+                  SIMD<double> above = simd_points(j,k) - SIMD<double>(bmax[i](j));
+                  dist = IfPos(below-dist, below, dist);
+                  dist = IfPos(above-dist, above, dist);
+                }
+              for (size_t lane = 0; lane < SW && k*SW+lane < np; lane++)
+                if (dist[lane] <= h)
+                  close.Append(k*SW+lane);
+            }
+          if (close.Size())
+            func(elnrs[i], FlatArray<int>(close));
+        });
+    }
+  };
+
   class GapFunction : public CoefficientFunction
   {
   protected:
@@ -34,7 +159,17 @@ namespace ngcomp
   template <int DIM>
   class T_GapFunction : public GapFunction
   {
-    unique_ptr<netgen::BoxTree<DIM, int>> searchtree;
+    ContactSearchTree<DIM> searchtree;
+    Array<int> other_els;
+    size_t mesh_timestamp = -1;
+    double built_cost = 0;
+
+    // closest points on other-elements for the points p1 (rows) of master
+    // element el1, pairs are accepted if closer than mindist and h
+    void FindClosestPoints (ElementId el1, FlatMatrix<> p1, FlatMatrix<> nv,
+                            FlatVector<> mindist, FlatArray<int> el2,
+                            FlatArray<IntegrationPoint> ip2, FlatMatrix<> p2,
+                            LocalHeap & lh) const;
   public:
     T_GapFunction( shared_ptr<MeshAccess> mesh_, Region master_, Region other_)
       : GapFunction(mesh_, master_, other_)
@@ -42,7 +177,7 @@ namespace ngcomp
 
     void Update(shared_ptr<GridFunction> gf, int intorder_, double h) override;
 
-    const netgen::BoxTree<DIM, int>& GetSearchTree() { return *searchtree; }
+    const ContactSearchTree<DIM>& GetSearchTree() { return searchtree; }
 
     double Evaluate (const BaseMappedIntegrationPoint & ip) const override
     {
@@ -56,6 +191,9 @@ namespace ngcomp
                   BareSliceMatrix<> result) const override;
 
     optional<ContactPair<DIM>> CreateContactPair(const MappedIntegrationPoint<DIM-1, DIM>& mip, LocalHeap& lh) const;
+    // contact pairs for all points of a master element rule
+    void CreateContactPairs(const MappedIntegrationRule<DIM-1, DIM>& mir, LocalHeap& lh,
+                            Array<ContactPair<DIM>>& pairs) const;
   };
 
   template<int DIM>
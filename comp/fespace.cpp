@@ -1673,6 +1673,55 @@ lot of new non-zero entries in the matrix!\n" << endl;
         throw Exception (*ex);
       }
   }
+
+
+  void IterateElementsUncolored (const FESpace & fes, 
+                                 VorB vb, 
+                                 LocalHeap & clh, 
+                                 const function<void(FESpace::Element,LocalHeap&)> & func)
+  {
+    static mutex copyex_mutex;
+    auto ma = fes.GetMeshAccess();
+    size_t ne = ma->GetNE(vb);
+
+    // consecutive elements share most of their dofs, so the chunks
+    // of SharedLoop2 keep the scatter local to one thread
+    Exception * ex = nullptr;
+    SharedLoop2 sl(ne);
+    ParallelJob
+      ( [&] (const TaskInfo & ti) 
+        {
+          LocalHeap lh = clh.Split(ti.thread_nr, ti.nthreads);
+          ArrayMem<int,100> temp_dnums;
+
+          for (size_t nr : sl)
+            {
+              ElementId ei(vb, nr);
+              if (!fes.DefinedOn(ei)) continue;
+              try
+                {
+                  HeapReset hr(lh);
+                  FESpace::Element el(fes, ei, temp_dnums, lh);
+                  func (move(el), lh);
+                }
+              catch (const Exception & e)
+                {
+                  lock_guard<mutex> guard(copyex_mutex);
+                  if (!ex)
+                    ex = new Exception (e);
+                }
+            }
+
+          ProgressOutput::SumUpLocal();
+        } );
+
+    if (ex)
+      {
+        Exception hex(*ex);
+        delete ex;
+        throw hex;
+      }
+  }
   
   /*
   // Aendern, Bremse!!!
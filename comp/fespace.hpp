@@ -876,6 +876,13 @@ ANY                  1 1 1 1 | 15
 			       VorB vb, 
 			       LocalHeap & clh, 
 			       const function<void(FESpace::Element,LocalHeap&)> & func);
+
+  /// iterates in parallel over consecutive chunks of elements, without coloring.
+  /// func must resolve write conflicts itself (e.g. by atomic adds)
+  extern NGS_DLL_HEADER void IterateElementsUncolored (const FESpace & fes,
+                                                       VorB vb, 
+                                                       LocalHeap & clh, 
+                                                       const function<void(FESpace::Element,LocalHeap&)> & func);
   /*
   template <typename TFUNC>
   inline void IterateElements (const FESpace & fes, 
@@ -7,6 +7,13 @@
 #include <parallelngs.hpp>
 #include <stdlib.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 using namespace ngcomp; 
 
 
@@ -225,6 +232,246 @@ namespace ngcomp
   }
 
 
+
+  /*
+    Checkpoint layout, one file per MPI rank ("filename.<rank>") if the
+    mesh is distributed, plus an index file "filename" written by rank 0:
+
+      CheckpointHeader     fixed size, native byte order
+      zero padding         up to checkpoint_alignment
+      payload              multidim vectors, raw FVDouble entries
+
+    The payload is page aligned. It is mapped and copied without parsing,
+    and can be opened directly, e.g. as numpy.memmap(filename, offset=4096).
+  */
+  struct CheckpointHeader
+  {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteorder;         // 0x01020304 as written
+    uint32_t nranks;
+    int32_t rank;               // -1 for the index file
+    uint32_t multidim;
+    uint32_t is_complex;
+    uint32_t dimension;
+    int32_t order;
+    uint64_t ndof;
+    uint64_t ndouble;           // doubles per vector
+    uint64_t fingerprint;
+    uint64_t payload_offset;
+    char fespace[64];
+  };
+
+  static constexpr char checkpoint_magic[8] = "NGSCKPT";
+  static constexpr uint32_t checkpoint_version = 1;
+  static constexpr size_t checkpoint_alignment = 4096;
+
+  static CheckpointHeader MakeCheckpointHeader (const GridFunction & gf)
+  {
+    auto fes = gf.GetFESpace();
+    auto comm = fes->GetMeshAccess()->GetCommunicator();
+
+    CheckpointHeader header;
+    memset (&header, 0, sizeof(header));
+    memcpy (header.magic, checkpoint_magic, sizeof(header.magic));
+    header.version = checkpoint_version;
+    header.byteorder = 0x01020304;
+    header.nranks = comm.Size();
+    header.rank = comm.Rank();
+    header.multidim = gf.GetMultiDim();
+    header.is_complex = fes->IsComplex();
+    header.dimension = fes->GetDimension();
+    header.order = fes->GetOrder();
+    header.ndof = fes->GetNDof();
+    header.ndouble = gf.GetVector().FVDouble().Size();
+    header.fingerprint = gf.DofFingerprint();
+    header.payload_offset = checkpoint_alignment;
+    strncpy (header.fespace, fes->GetClassName().c_str(), sizeof(header.fespace)-1);
+    return header;
+  }
+
+  static void CheckCheckpointHeader (const CheckpointHeader & header,
+                                     const CheckpointHeader & expected,
+                                     const string & filename)
+  {
+    auto Fail = [&] (string what)
+      {
+        throw Exception ("LoadCheckpoint: '"+filename+"' "+what);
+      };
+    if (memcmp (header.magic, checkpoint_magic, sizeof(header.magic)) != 0)
+      Fail ("is not a checkpoint");
+    if (header.byteorder != expected.byteorder)
+      Fail ("was written with a different byte order");
+    if (header.version != checkpoint_version)
+      Fail ("has version "+ToString(header.version)+", expected "+ToString(checkpoint_version));
+    if (header.nranks != expected.nranks)
+      Fail ("was written on "+ToString(header.nranks)+" ranks, restarting on "
+            +ToString(expected.nranks)+" ranks requires the same partition");
+    if (header.rank == -1) return;  // index file
+    if (header.rank != expected.rank)
+      Fail ("belongs to rank "+ToString(header.rank));
+    if (header.multidim != expected.multidim)
+      Fail ("has multidim = "+ToString(header.multidim)+", gridfunction has "+ToString(expected.multidim));
+    if (header.ndof != expected.ndof || header.ndouble != expected.ndouble ||
+        header.is_complex != expected.is_complex || header.dimension != expected.dimension)
+      Fail (string("was written for a ")+header.fespace+" with "+ToString(header.ndof)
+            +" dofs, gridfunction lives on a "+expected.fespace+" with "+ToString(expected.ndof)+" dofs");
+    if (header.fingerprint != expected.fingerprint)
+      Fail ("does not match the dof numbering of the space (different mesh, order or ordering)");
+  }
+
+  size_t GridFunction :: DofFingerprint () const
+  {
+    // FNV-1a over everything that determines the meaning of a dof number
+    uint64_t hash = 14695981039346656037ull;
+    auto Add = [&hash] (uint64_t v)
+      {
+        for (int i = 0; i < 8; i++)
+          {
+            hash ^= (v >> (8*i)) & 255;
+            hash *= 1099511628211ull;
+          }
+      };
+
+    for (char c : fespace->GetClassName())
+      Add (c);
+    Add (fespace->GetOrder());
+    Add (fespace->GetDimension());
+    Add (fespace->GetNDof());
+
+    Array<DofId> dnums;
+    for (size_t i = 0; i < ma->GetNE(VOL); i++)
+      {
+        ElementId ei(VOL, i);
+        for (auto v : ma->GetElVertices(ei))
+          Add (v);
+        fespace->GetDofNrs (ei, dnums);
+        Add (dnums.Size());
+        for (auto d : dnums)
+          Add (d);
+      }
+    return hash;
+  }
+
+  void GridFunction :: SaveCheckpoint (const string & filename) const
+  {
+    static Timer t("GridFunction::SaveCheckpoint"); RegionTimer reg(t);
+
+    auto comm = ma->GetCommunicator();
+    CheckpointHeader header = MakeCheckpointHeader (*this);
+
+    auto Write = [] (const string & name, const CheckpointHeader & header,
+                     FlatArray<const BaseVector*> vecs)
+      {
+        ofstream out(name, ios::binary);
+        out.write (reinterpret_cast<const char*>(&header), sizeof(header));
+        Array<char> padding(header.payload_offset-sizeof(header));
+        padding = 0;
+        out.write (padding.Data(), padding.Size());
+        for (auto v : vecs)
+          {
+            auto fv = v->FVDouble();
+            out.write (reinterpret_cast<const char*>(fv.Data()), fv.Size()*sizeof(double));
+          }
+        if (!out)
+          throw Exception ("SaveCheckpoint: could not write '"+name+"'");
+      };
+
+    Array<const BaseVector*> vecs;
+    for (int i = 0; i < multidim; i++)
+      {
+        GetVector(i).Cumulate();
+        vecs.Append (&GetVector(i));
+      }
+
+    if (comm.Size() == 1)
+      {
+        Write (filename, header, vecs);
+        return;
+      }
+
+    // every rank writes its own slice, no data passes through rank 0
+    Write (filename+"."+ToString(comm.Rank()), header, vecs);
+    if (comm.Rank() == 0)
+      {
+        CheckpointHeader index = header;
+        index.rank = -1;
+        index.ndof = index.ndouble = index.fingerprint = 0;
+        Write (filename, index, Array<const BaseVector*>());
+      }
+  }
+
+  void GridFunction :: LoadCheckpoint (const string & filename)
+  {
+    static Timer t("GridFunction::LoadCheckpoint"); RegionTimer reg(t);
+
+    auto comm = ma->GetCommunicator();
+    CheckpointHeader expected = MakeCheckpointHeader (*this);
+
+    auto ReadHeader = [] (const string & name)
+      {
+        CheckpointHeader header;
+        ifstream in(name, ios::binary);
+        if (!in.read (reinterpret_cast<char*>(&header), sizeof(header)))
+          throw Exception ("LoadCheckpoint: could not read '"+name+"'");
+        return header;
+      };
+
+    string piece = filename;
+    if (comm.Size() > 1)
+      {
+        CheckCheckpointHeader (ReadHeader(filename), expected, filename);
+        piece = filename+"."+ToString(comm.Rank());
+      }
+
+    CheckpointHeader header = ReadHeader(piece);
+    CheckCheckpointHeader (header, expected, piece);
+
+    size_t nd = header.ndouble;
+    size_t nbytes = header.payload_offset + multidim*nd*sizeof(double);
+
+    auto CopyPayload = [&] (const char * payload)
+      {
+        for (int i = 0; i < multidim; i++)
+          {
+            auto fv = GetVector(i).FVDouble();
+            auto src = reinterpret_cast<const double*>(payload) + i*nd;
+            ParallelForRange (nd, [&] (IntRange r)
+                              {
+                                memcpy (fv.Data()+r.First(), src+r.First(), r.Size()*sizeof(double));
+                              });
+          }
+      };
+
+#ifndef WIN32
+    int fd = open (piece.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat (fd, &st) != 0 || size_t(st.st_size) < nbytes)
+      {
+        if (fd >= 0) close(fd);
+        throw Exception ("LoadCheckpoint: '"+piece+"' is truncated");
+      }
+    void * map = mmap (nullptr, nbytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (map == MAP_FAILED)
+      throw Exception ("LoadCheckpoint: could not map '"+piece+"'");
+    madvise (map, nbytes, MADV_SEQUENTIAL);
+    CopyPayload (static_cast<const char*>(map) + header.payload_offset);
+    munmap (map, nbytes);
+#else
+    ifstream in(piece, ios::binary);
+    Array<char> payload(nbytes - header.payload_offset);
+    in.seekg (header.payload_offset);
+    if (!in.read (payload.Data(), payload.Size()))
+      throw Exception ("LoadCheckpoint: '"+piece+"' is truncated");
+    CopyPayload (payload.Data());
+#endif
+
+    for (int i = 0; i < multidim; i++)
+      GetVector(i).SetParallelStatus (CUMULATED);
+  }
+
+
   // void GridFunction :: Visualize(const string & given_name)
   void Visualize(shared_ptr<GridFunction> gf, const string & given_name)
   {
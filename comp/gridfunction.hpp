@@ -44,6 +44,7 @@ namespace ngcomp
     virtual int Dimension() const;
     virtual Array<int> Dimensions() const;
     virtual bool DefinedOn (const ElementTransformation & trafo) override;
+    virtual bool DependsOnElement() const override { return true; }
     void SelectComponent (int acomp) { comp = acomp; }
     const GridFunction & GetGridFunction() const { return *gf; }
       using CoefficientFunction::Evaluate;
@@ -157,6 +158,13 @@ namespace ngcomp
 
     /// increase multidim and copy vec to new component
     void AddMultiDimComponent (BaseVector & vec);
+
+    /// versioned binary checkpoint with page-aligned raw payload, one file per rank
+    void SaveCheckpoint (const string & filename) const;
+    /// restart from a checkpoint written on the same space and partition
+    void LoadCheckpoint (const string & filename);
+    /// hash of space type, order, ndof and dof numbering of all elements
+    size_t DofFingerprint () const;
   
     int GetLevelUpdated() const { return level_updated; }
     ///
@@ -120,24 +120,32 @@ namespace ngcomp
   }
 
 
-  template <typename SCAL>
-  H1AMG_Matrix<SCAL>::H1AMG_Matrix(shared_ptr<SparseMatrixTM<SCAL>> amat,
-                                   shared_ptr<BitArray> freedofs,
-                                   FlatArray<INT<2>> e2v,
-                                   FlatArray<double> edge_weights,
-                                   FlatArray<double> vertex_weights,
-                                   size_t level)
-  : mat(amat)
+  // edges of every vertex
+  static Table<int> VertexEdges (FlatArray<INT<2>> e2v, size_t num_vertices)
   {
-      static Timer t("H1AMG"); RegionTimer reg(t);
+      TableCreator<int> v2e_creator(num_vertices);
+      for ( ; !v2e_creator.Done(); v2e_creator++)
+        ParallelFor (e2v.Size(), [&] (size_t e)
+                     {
+                       for (int j = 0; j < 2; j++)
+                         v2e_creator.Add (e2v[e][j], e);
+                     });
+      return v2e_creator.MoveTable();
+  }
+
+  // matches strongly coupled vertex pairs, v2cv maps vertices to coarse vertices
+  // (-1 for vertices dropped from the coarse space), returns number of coarse vertices
+  static size_t MatchVertices (FlatArray<INT<2>> e2v,
+                               FlatArray<double> edge_weights,
+                               FlatArray<double> vertex_weights,
+                               const BitArray & freedofs,
+                               Array<size_t> & v2cv)
+  {
+      static Timer t("H1AMG - match"); RegionTimer reg(t);
 
       size_t num_edges = edge_weights.Size();
       size_t num_vertices = vertex_weights.Size();
 
-      cout << "H1AMG: level = " << level << ", num_edges = " << num_edges << ", nv = " << num_vertices << endl;
-
-      size = mat->Height();
-
       Array<double> edge_collapse_weights(num_edges);
       Array<double> sum_vertex_weights(num_vertices);
       for (auto i : Range(num_vertices))
@@ -157,22 +165,6 @@ namespace ngcomp
                      edge_collapse_weights[i] = edge_weights[i] * (vstr1+vstr2) / (vstr1 * vstr2);
                    });
 
-      // sort edges by collapse weights
-      /*
-      Array<int> indices(num_edges);
-      ParallelFor (num_edges, [&] (size_t edge)
-                   { indices[edge] = edge; });
-
-      SampleSortI(edge_collapse_weights, indices);
-
-      Array<size_t> invindices(num_edges);
-      ParallelFor (num_edges, [&] (size_t edge)
-                   {
-                     invindices[indices[edge]] = edge;
-                   });
-      */
-
-
       // which edges to collapse ?
 
       Array<bool> vertex_collapse(num_vertices);
@@ -180,22 +172,7 @@ namespace ngcomp
       edge_collapse = false;
       vertex_collapse = false;
 
-      TableCreator<int> v2e_creator(num_vertices);
-      for ( ; !v2e_creator.Done(); v2e_creator++)
-        ParallelFor (num_edges, [&] (size_t e)
-                     {
-                       for (int j = 0; j < 2; j++)
-                         v2e_creator.Add (e2v[e][j], e);
-                     });
-      Table<int> v2e = v2e_creator.MoveTable();
-
-      /*
-      ParallelFor (v2e.Size(), [&] (size_t vnr)
-                   {
-                     // QuickSortI (invindices, v2e[vnr]);
-                     QuickSortI (edge_collapse_weights, v2e[vnr]);
-                   }, TasksPerThread(5));
-      */
+      Table<int> v2e = VertexEdges (e2v, num_vertices);
 
       ParallelFor (v2e.Size(), [&] (size_t vnr)
                    {
@@ -223,7 +200,7 @@ namespace ngcomp
       isolated_verts.Clear();
       for (size_t i = 0; i < num_vertices; i++)
         if (sum_vertex_weights[i] <= 1.1 * vertex_weights[i] ||
-            (*freedofs)[i] == false)
+            !freedofs.Test(i))
           isolated_verts.SetBit(i);
 
       
@@ -234,7 +211,6 @@ namespace ngcomp
                                auto v1 = e2v[edgenr][1];
                                if (edge_collapse_weights[edgenr] >= 0.01 && !vertex_collapse[v0] && !vertex_collapse[v1]
                                    && !isolated_verts[v0] && !isolated_verts[v1])
-                                 // && (*freedofs)[v0] && (*freedofs)[v1])
                                  {
                                    edge_collapse[edgenr] = true;
                                    vertex_collapse[v0] = true;
@@ -255,7 +231,7 @@ namespace ngcomp
 
 
       // vertex 2 coarse vertex
-      Array<size_t> v2cv(num_vertices);
+      v2cv.SetSize(num_vertices);
       size_t num_coarse_vertices = 0;
       v2cv = -1;
       for (size_t i = 0; i < num_vertices; i++)
@@ -269,6 +245,24 @@ namespace ngcomp
             if (v0 > v1) Swap (v0,v1);
             v2cv[v1] = v2cv[v0];
           }
+      return num_coarse_vertices;
+  }
+
+
+  // edges and weights of the coarse graph defined by the vertex map v2cv
+  static void CoarsenGraph (FlatArray<INT<2>> e2v,
+                            FlatArray<double> edge_weights,
+                            FlatArray<double> vertex_weights,
+                            const BitArray & freedofs,
+                            FlatArray<size_t> v2cv,
+                            size_t num_coarse_vertices,
+                            Array<INT<2>> & coarse_e2v,
+                            Array<double> & coarse_edge_weights,
+                            Array<double> & coarse_vertex_weights)
+  {
+      static Timer t("H1AMG - coarsen graph"); RegionTimer reg(t);
+
+      size_t num_edges = edge_weights.Size();
 
       // edge to coarse edge
 
@@ -297,7 +291,7 @@ namespace ngcomp
           num_coarse_edges += coarse_edge_ht.Used(i);
         }
 
-      Array<INT<2>> coarse_e2v(num_coarse_edges);
+      coarse_e2v.SetSize(num_coarse_edges);
 
       ParallelFor (coarse_edge_ht.NumBuckets(),
                [&] (size_t nr)
@@ -334,8 +328,8 @@ namespace ngcomp
 
       coarse_edge_ht = ParallelHashTable<INT<2>, int>();
 
-      Array<double> coarse_edge_weights (num_coarse_edges);
-      Array<double> coarse_vertex_weights (num_coarse_vertices);
+      coarse_edge_weights.SetSize (num_coarse_edges);
+      coarse_vertex_weights.SetSize (num_coarse_vertices);
 
       coarse_edge_weights = 0.0;
       coarse_vertex_weights = 0.0;
@@ -345,7 +339,7 @@ namespace ngcomp
                     if (e2ce[e] != -1)
                       AtomicAdd(coarse_edge_weights[e2ce[e]], edge_weights[e]);
                     int v0 = e2v[e][0], v1 = e2v[e][1];
-                    bool free0 = (*freedofs)[v0], free1 = (*freedofs)[v1];
+                    bool free0 = freedofs.Test(v0), free1 = freedofs.Test(v1);
                     if (free0 && !free1 && v2cv[v0] != -1)
                       AtomicAdd(coarse_vertex_weights[v2cv[v0]], edge_weights[e]);
                     if (free1 && !free0 && v2cv[v1] != -1)
@@ -357,9 +351,58 @@ namespace ngcomp
                     if (v2cv[v] != -1)
                       AtomicAdd(coarse_vertex_weights[v2cv[v]], vertex_weights[v]);
                   });
+  }
+
+
+  template <typename SCAL>
+  H1AMG_Matrix<SCAL>::H1AMG_Matrix(shared_ptr<SparseMatrixTM<SCAL>> amat,
+                                   shared_ptr<BitArray> freedofs,
+                                   FlatArray<INT<2>> e2v,
+                                   FlatArray<double> edge_weights,
+                                   FlatArray<double> vertex_weights,
+                                   size_t alevel,
+                                   const H1AMG_Options & aoptions)
+    : level(alevel), options(aoptions), mat(amat)
+  {
+      static Timer t("H1AMG"); RegionTimer reg(t);
+
+      size_t num_edges = edge_weights.Size();
+      size_t num_vertices = vertex_weights.Size();
 
+      cout << "H1AMG: level = " << level << ", num_edges = " << num_edges << ", nv = " << num_vertices << endl;
 
-      // build smoother
+      size = mat->Height();
+
+      Array<size_t> v2cv;
+      size_t num_coarse_vertices =
+        MatchVertices (e2v, edge_weights, vertex_weights, *freedofs, v2cv);
+
+      Array<INT<2>> coarse_e2v;
+      Array<double> coarse_edge_weights, coarse_vertex_weights;
+      CoarsenGraph (e2v, edge_weights, vertex_weights, *freedofs, v2cv, num_coarse_vertices,
+                    coarse_e2v, coarse_edge_weights, coarse_vertex_weights);
+
+      // aggressive coarsening: match the coarse graph once more,
+      // aggregates of up to four vertices
+      if (int(level) < options.aggressive_levels && num_coarse_vertices >= options.coarse_size)
+        {
+          BitArray all_free(num_coarse_vertices);
+          all_free.Set();
+          Array<size_t> cv2ccv;
+          size_t num_cc_vertices =
+            MatchVertices (coarse_e2v, coarse_edge_weights, coarse_vertex_weights, all_free, cv2ccv);
+
+          ParallelFor (v2cv.Size(), [&] (size_t v)
+                       {
+                         if (v2cv[v] != -1)
+                           v2cv[v] = cv2ccv[v2cv[v]];
+                       });
+          num_coarse_vertices = num_cc_vertices;
+          CoarsenGraph (e2v, edge_weights, vertex_weights, *freedofs, v2cv, num_coarse_vertices,
+                        coarse_e2v, coarse_edge_weights, coarse_vertex_weights);
+        }
+
+      // smoothing blocks
       TableCreator<int> smoothing_blocks_creator(num_coarse_vertices);
       for ( ; !smoothing_blocks_creator.Done(); smoothing_blocks_creator++)
         ParallelFor (v2cv.Size(), [&] (size_t v)
@@ -368,8 +411,7 @@ namespace ngcomp
                          smoothing_blocks_creator.Add (v2cv[v], v);
                      });
 
-      auto blocks = make_shared<Table<int>> (smoothing_blocks_creator.MoveTable());
-      smoother = mat->CreateBlockJacobiPrecond(blocks);
+      blocks = make_shared<Table<int>> (smoothing_blocks_creator.MoveTable());
 
       // build prolongation
       Array<int> nne(num_vertices);
@@ -384,6 +426,7 @@ namespace ngcomp
       // smoothed prolongation
       if (level % 4 == 2)
         {
+          Table<int> v2e = VertexEdges (e2v, num_vertices);
           for (auto i : Range(num_vertices))
             nne[i] = 1+v2e[i].Size();
 
@@ -413,9 +456,9 @@ namespace ngcomp
           prolongation = MatMult (*smoothprol, *prolongation);
         }
 
-      auto coarsemat = mat -> Restrict (*prolongation);
+      coarse_mat = mat -> Restrict (*prolongation);
       // coarse freedofs
-      auto coarse_freedofs = make_shared<BitArray> (num_coarse_vertices);
+      coarse_freedofs = make_shared<BitArray> (num_coarse_vertices);
       coarse_freedofs->Clear();
       ParallelFor(v2cv.Size(), [&] (int v)
                   {
@@ -423,25 +466,173 @@ namespace ngcomp
                       coarse_freedofs->SetBitAtomic(v2cv[v]);
                   });
 
-      if ( (num_coarse_vertices < 10) || (num_coarse_vertices == num_vertices) )
-	{
-	  coarsemat->SetInverseType(SPARSECHOLESKY);
-	  coarse_precond = coarsemat->InverseMatrix(coarse_freedofs);
-	}
+      if ( (num_coarse_vertices < options.coarse_size) || (num_coarse_vertices == num_vertices) )
+        SetupCoarse();
       else
-        coarse_precond = make_shared<H1AMG_Matrix> (dynamic_pointer_cast<SparseMatrixTM<SCAL>> (coarsemat), coarse_freedofs,
-                                                    coarse_e2v, coarse_edge_weights, coarse_vertex_weights, level+1);
+        coarse_precond = make_shared<H1AMG_Matrix> (dynamic_pointer_cast<SparseMatrixTM<SCAL>> (coarse_mat), coarse_freedofs,
+                                                    coarse_e2v, coarse_edge_weights, coarse_vertex_weights, level+1,
+                                                    options);
 
       // restriction = TransposeMatrix (*prolongation);
       restriction = dynamic_pointer_cast<SparseMatrixTM<double>>(prolongation->CreateTranspose());
-    }
+
+      SetupSmoother();
+  }
+
+  template <typename SCAL>
+  void H1AMG_Matrix<SCAL>::SetupCoarse ()
+  {
+    coarse_mat->SetInverseType(SPARSECHOLESKY);
+    coarse_precond = coarse_mat->InverseMatrix(coarse_freedofs);
+  }
+
+  template <typename SCAL>
+  void H1AMG_Matrix<SCAL>::SetupSmoother ()
+  {
+    static Timer t("H1AMG - setup smoother"); RegionTimer reg(t);
+    smoother = mat->CreateBlockJacobiPrecond(blocks);
+    chebyshev = nullptr;
+    if (options.smoother != "chebyshev") return;
+
+    // power iteration for the largest eigenvalue of the block-Jacobi preconditioned matrix
+    auto v = mat->CreateColVector();
+    auto w = mat->CreateColVector();
+    v.SetRandom();
+    double lmax = 0;
+    for (int i = 0; i < 10; i++)
+      {
+        double norm = v.L2Norm();
+        if (norm == 0) break;
+        v *= 1/norm;
+        w = (*mat) * v;
+        v = (*smoother) * w;
+        lmax = v.L2Norm();
+      }
+    lmax *= 1.1;
+    if (lmax == 0) lmax = 1;
+
+    // ChebyshevIteration expects the spectral bounds of I - C A,
+    // and applies a polynomial of degree steps+1
+    chebyshev = make_shared<ChebyshevIteration> (*mat, *smoother, max(options.chebyshev_degree-1, 0));
+    chebyshev->SetBounds (1-lmax, 1-options.chebyshev_lower*lmax);
+  }
+
+  template <typename SCAL>
+  void H1AMG_Matrix<SCAL>::UpdateMatrix (shared_ptr<SparseMatrixTM<SCAL>> amat)
+  {
+    static Timer t("H1AMG::UpdateMatrix"); RegionTimer reg(t);
+    mat = amat;
+    size = mat->Height();
+
+    // same graph and prolongation, refill the Galerkin matrix in place.
+    // Restrict may return a new matrix (e.g. for non-symmetric storage),
+    // a factorization of the old one can then not be updated
+    auto old_coarse_mat = coarse_mat;
+    coarse_mat = mat -> Restrict (*prolongation, coarse_mat);
+    if (auto coarse_amg = dynamic_pointer_cast<H1AMG_Matrix<SCAL>> (coarse_precond))
+      coarse_amg->UpdateMatrix (dynamic_pointer_cast<SparseMatrixTM<SCAL>> (coarse_mat));
+    else if (auto fact = dynamic_pointer_cast<SparseFactorization> (coarse_precond);
+             fact && fact->SupportsUpdate() && coarse_mat == old_coarse_mat)
+      fact->Update();
+    else
+      SetupCoarse();
+
+    SetupSmoother();
+  }
+
+  template <typename SCAL>
+  void H1AMG_Matrix<SCAL>::PreSmooth (BaseVector & x, const BaseVector & b) const
+  {
+    if (!chebyshev)
+      {
+        smoother->GSSmooth (x, b, options.smoothing_steps);
+        return;
+      }
+    auto r = b.CreateVector();
+    auto w = b.CreateVector();
+    for (int i = 0; i < options.smoothing_steps; i++)
+      {
+        r = b - (*mat) * x;
+        w = (*chebyshev) * r;
+        x += w;
+      }
+  }
+
+  template <typename SCAL>
+  void H1AMG_Matrix<SCAL>::PostSmooth (BaseVector & x, const BaseVector & b) const
+  {
+    if (!chebyshev)
+      smoother->GSSmoothBack (x, b, options.smoothing_steps);
+    else
+      PreSmooth (x, b);
+  }
+
+  template <typename SCAL>
+  void H1AMG_Matrix<SCAL>::CoarseCorrection (const BaseVector & b, BaseVector & x) const
+  {
+    // direct solve on the coarsest level
+    if (options.cycle == "V" || !dynamic_pointer_cast<H1AMG_Matrix<SCAL>> (coarse_precond))
+      {
+        coarse_precond->Mult (b, x);
+        return;
+      }
+
+    if (options.cycle == "W")
+      {
+        // two stationary iterations with the coarse cycle
+        auto r = b.CreateVector();
+        auto w = b.CreateVector();
+        coarse_precond->Mult (b, x);
+        r = b - (*coarse_mat) * x;
+        coarse_precond->Mult (r, w);
+        x += w;
+        return;
+      }
+
+    // K-cycle: two steps of flexible CG with the coarse cycle as preconditioner
+    // (Notay, Vassilevski: Recursive Krylov-based multigrid cycles)
+    auto c1 = b.CreateVector();
+    auto v = b.CreateVector();
+    auto r = b.CreateVector();
+    coarse_precond->Mult (b, c1);
+    v = (*coarse_mat) * c1;
+    SCAL rho1 = S_InnerProduct<SCAL> (c1, v);
+    SCAL alpha1 = S_InnerProduct<SCAL> (c1, b);
+    if (rho1 == SCAL(0.0))
+      {
+        x = 0;
+        return;
+      }
+    r = b - (alpha1/rho1) * v;
+    if (r.L2Norm() <= 0.25 * b.L2Norm())
+      {
+        x = (alpha1/rho1) * c1;
+        return;
+      }
+
+    auto c2 = b.CreateVector();
+    auto w = b.CreateVector();
+    coarse_precond->Mult (r, c2);
+    w = (*coarse_mat) * c2;
+    SCAL gamma = S_InnerProduct<SCAL> (c2, v);
+    SCAL beta = S_InnerProduct<SCAL> (c2, w);
+    SCAL alpha2 = S_InnerProduct<SCAL> (c2, r);
+    SCAL rho2 = beta - gamma*gamma/rho1;
+    if (rho2 == SCAL(0.0))
+      {
+        x = (alpha1/rho1) * c1;
+        return;
+      }
+    x = (alpha1/rho1 - gamma*alpha2/(rho1*rho2)) * c1;
+    x += (alpha2/rho2) * c2;
+  }
 
   template <typename SCAL>
   void H1AMG_Matrix<SCAL>::Mult (const BaseVector & b, BaseVector & x) const
   {
       static Timer t("H1AMG::Mult"); RegionTimer reg(t);
       x = 0;
-      smoother->GSSmooth(x, b, smoothing_steps);
+      PreSmooth (x, b);
       auto residuum = b.CreateVector();
       residuum = b - (*mat) * x;
       
@@ -449,10 +640,10 @@ namespace ngcomp
       coarse_residuum = *restriction * residuum;
 
       auto coarse_x = coarse_precond->CreateColVector();
-      coarse_precond->Mult(coarse_residuum, coarse_x);
+      CoarseCorrection (coarse_residuum, coarse_x);
 
       x += *prolongation * coarse_x;
-      smoother->GSSmoothBack (x, b, smoothing_steps);
+      PostSmooth (x, b);
   }
 
   template <class SCAL>
@@ -460,6 +651,9 @@ namespace ngcomp
   {
     shared_ptr<BitArray> freedofs;
     shared_ptr<H1AMG_Matrix<SCAL>> mat;
+    H1AMG_Options options;
+    /// keep the hierarchy of the previous assembly if the matrix size is unchanged
+    bool reuse_setup;
 
     ParallelHashTable<INT<2>,double> edge_weights_ht;
     ParallelHashTable<INT<1>,double> vertex_weights_ht;
@@ -487,6 +681,20 @@ namespace ngcomp
         cout << IM(3) << "Create H1AMG" << endl;
       else
         cout << IM(3) << "Create H1AMG, complex" << endl;
+
+      options.cycle = flags.GetStringFlag ("cycle", options.cycle);
+      options.smoother = flags.GetStringFlag ("smoother", options.smoother);
+      options.smoothing_steps = int (flags.GetNumFlag ("smoothingsteps", options.smoothing_steps));
+      options.chebyshev_degree = int (flags.GetNumFlag ("chebyshevdegree", options.chebyshev_degree));
+      options.chebyshev_lower = flags.GetNumFlag ("chebyshevlower", options.chebyshev_lower);
+      options.aggressive_levels = int (flags.GetNumFlag ("aggressivelevels", options.aggressive_levels));
+      options.coarse_size = size_t (flags.GetNumFlag ("coarsesize", options.coarse_size));
+      reuse_setup = flags.GetDefineFlag ("reusesetup");
+
+      if (options.cycle != "V" && options.cycle != "W" && options.cycle != "K")
+        throw Exception ("H1AMG: unknown cycle '" + options.cycle + "', use 'V', 'W' or 'K'");
+      if (options.smoother != "gs" && options.smoother != "chebyshev")
+        throw Exception ("H1AMG: unknown smoother '" + options.smoother + "', use 'gs' or 'chebyshev'");
     }
 
     H1AMG_Preconditioner (const PDE & pde, const Flags & aflags, const string & aname)
@@ -504,6 +712,15 @@ namespace ngcomp
     {
       auto smat = dynamic_pointer_cast<SparseMatrixTM<SCAL>> (const_cast<BaseMatrix*>(matrix)->shared_from_this());
 
+      if (reuse_setup && mat && mat->Height() == matrix->Height())
+        {
+          // only the values changed: keep the coarsening, recompute the Galerkin matrices
+          edge_weights_ht = ParallelHashTable<INT<2>,double>();
+          vertex_weights_ht = ParallelHashTable<INT<1>,double>();
+          mat->UpdateMatrix (smat);
+          return;
+        }
+
       size_t num_vertices = matrix->Height();
       size_t num_edges = edge_weights_ht.Used();
 
@@ -527,7 +744,7 @@ namespace ngcomp
          });
       vertex_weights_ht = ParallelHashTable<INT<1>,double>();
 
-      mat = make_shared<H1AMG_Matrix<SCAL>> (smat, freedofs, e2v, edge_weights, vertex_weights, 0);
+      mat = make_shared<H1AMG_Matrix<SCAL>> (smat, freedofs, e2v, edge_weights, vertex_weights, 0, options);
     }
 
 
@@ -5,15 +5,47 @@
 
 namespace ngcomp
 {
+  /// cycle and smoother of the H1AMG hierarchy, set by preconditioner flags
+  struct H1AMG_Options
+  {
+    /// "V", "W" or "K" (Krylov-accelerated coarse correction).
+    /// The K-cycle is a nonlinear preconditioner, the outer iteration
+    /// must be flexible (e.g. GMRes instead of CG)
+    string cycle = "V";
+    /// "gs" (block Gauss-Seidel) or "chebyshev" (polynomial in block-Jacobi)
+    string smoother = "gs";
+    int smoothing_steps = 1;
+    /// polynomial degree of the Chebyshev smoother
+    int chebyshev_degree = 3;
+    /// Chebyshev damps the part [lower*lmax, lmax] of the spectrum
+    double chebyshev_lower = 0.3;
+    /// number of finest levels which match twice (aggregates of up to 4 vertices)
+    int aggressive_levels = 0;
+    /// levels with fewer dofs are solved directly
+    size_t coarse_size = 10;
+  };
+
   template <class SCAL>
   class NGS_DLL_HEADER H1AMG_Matrix : public ngla::BaseMatrix
   {
     size_t size;
+    size_t level;
+    H1AMG_Options options;
     std::shared_ptr<ngla::SparseMatrixTM<SCAL>> mat;
+    std::shared_ptr<ngcore::Table<int>> blocks;
     std::shared_ptr<ngla::BaseBlockJacobiPrecond> smoother;
+    std::shared_ptr<ngla::ChebyshevIteration> chebyshev;
     std::shared_ptr<ngla::SparseMatrixTM<double>> prolongation, restriction;
+    std::shared_ptr<ngla::BaseSparseMatrix> coarse_mat;
     std::shared_ptr<ngla::BaseMatrix> coarse_precond;
-    int smoothing_steps = 1;
+    std::shared_ptr<ngcore::BitArray> coarse_freedofs;
+
+    void SetupSmoother ();
+    void SetupCoarse ();
+    void PreSmooth (ngla::BaseVector & x, const ngla::BaseVector & b) const;
+    void PostSmooth (ngla::BaseVector & x, const ngla::BaseVector & b) const;
+    /// x = approximate inverse of coarse matrix times b, according to the cycle
+    void CoarseCorrection (const ngla::BaseVector & b, ngla::BaseVector & x) const;
 
   public:
     H1AMG_Matrix (std::shared_ptr<ngla::SparseMatrixTM<SCAL>> amat,
@@ -21,12 +53,16 @@ namespace ngcomp
                   ngcore::FlatArray<ngcore::INT<2>> e2v,
                   ngcore::FlatArray<double> edge_weights,
                   ngcore::FlatArray<double> vertex_weights,
-                  size_t level);
+                  size_t level,
+                  const H1AMG_Options & aoptions = H1AMG_Options());
+
+    /// new matrix values on the same sparsity pattern, keeps the coarsening
+    void UpdateMatrix (std::shared_ptr<ngla::SparseMatrixTM<SCAL>> amat);
 
     virtual int VHeight() const override { return size; }
     virtual int VWidth() const override { return size; }
     virtual bool IsComplex() const override { return is_same<SCAL,Complex>(); }
-    
+
     virtual AutoVector CreateRowVector () const override { return mat->CreateColVector(); }
     virtual AutoVector CreateColVector () const override { return mat->CreateRowVector(); }
 
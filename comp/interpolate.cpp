@@ -340,7 +340,7 @@ namespace ngcomp
     shared_ptr<CoefficientFunction> Diff (const CoefficientFunction * var, shared_ptr<CoefficientFunction> dir) const override
     {
       if (this == var) return dir;
-      return InterpolateCF(func->Diff(var, dir),fes);
+      return InterpolateCF(func->Differentiate(var, dir),fes);
     }
   };
   
@@ -826,7 +826,7 @@ namespace ngcomp
   Diff (const CoefficientFunction * var, shared_ptr<CoefficientFunction> dir) const 
   {
     if (this == var) return dir;
-    return make_shared<InterpolateProxy> (func->Diff(var,dir), space, testfunction, final_diffop, bonus_intorder);
+    return make_shared<InterpolateProxy> (func->Differentiate(var,dir), space, testfunction, final_diffop, bonus_intorder);
   }
   
   shared_ptr<CoefficientFunction> InterpolateCF (shared_ptr<CoefficientFunction> func, shared_ptr<FESpace> space,
@@ -26,6 +26,115 @@ namespace ngcomp
   
   
   string Ngs_Element::defaultstring = "default";
+
+
+  // Mapped SIMD integration rules of curved elements, a short list of rules
+  // per element. Lookups are lock-free, new rules are prepended with CAS.
+  class GeometryCache
+  {
+    struct Entry
+    {
+      Entry * next = nullptr;
+      Array<SIMD<double>> refpoints;  // reference coordinates identify the rule
+      Array<SIMD<double>> values;     // mapped point and Jacobian per point
+    };
+    std::vector<atomic<Entry*>> entries[3];
+    atomic<size_t> nbytes{0}, nentries{0};
+    static constexpr int MAXRULES = 16;
+
+  public:
+    GeometryCache (const MeshAccess & ma)
+    {
+      for (VorB vb : { VOL, BND, BBND })
+        entries[vb] = std::vector<atomic<Entry*>> (ma.GetNE(vb));
+    }
+
+    ~GeometryCache ()
+    {
+      for (auto & list : entries)
+        for (auto & first : list)
+          for (Entry * e = first.load(); e; )
+            {
+              Entry * next = e->next;
+              delete e;
+              e = next;
+            }
+    }
+
+    size_t NBytes () const { return nbytes; }
+    size_t NEntries () const { return nentries; }
+
+    template <int DIMS, int DIMR>
+    bool Lookup (VorB vb, size_t elnr, const SIMD_IntegrationRule & ir,
+                 SIMD_MappedIntegrationRule<DIMS,DIMR> & mir) const
+    {
+      if (vb > BBND || elnr >= entries[vb].size()) return false;
+      constexpr int NV = DIMR + DIMR*DIMS;
+      size_t nip = ir.Size();
+      for (Entry * e = entries[vb][elnr].load(memory_order_acquire); e; e = e->next)
+        {
+          if (e->values.Size() != NV*nip) continue;
+          bool same = true;
+          for (size_t i = 0; i < nip && same; i++)
+            for (int j = 0; j < DIMS; j++)
+              if (memcmp (&ir[i](j), &e->refpoints[i*DIMS+j], sizeof(SIMD<double>)) != 0)
+                {
+                  same = false;
+                  break;
+                }
+          if (!same) continue;
+
+          for (size_t i = 0; i < nip; i++)
+            {
+              const SIMD<double> * v = &e->values[i*NV];
+              for (int j = 0; j < DIMR; j++)
+                mir[i].Point()(j) = v[j];
+              for (int j = 0; j < DIMR; j++)
+                for (int k = 0; k < DIMS; k++)
+                  mir[i].Jacobian()(j,k) = v[DIMR+j*DIMS+k];
+              mir[i].Compute();
+            }
+          return true;
+        }
+      return false;
+    }
+
+    template <int DIMS, int DIMR>
+    void Store (VorB vb, size_t elnr, const SIMD_IntegrationRule & ir,
+                SIMD_MappedIntegrationRule<DIMS,DIMR> & mir)
+    {
+      if (vb > BBND || elnr >= entries[vb].size()) return;
+      auto & first = entries[vb][elnr];
+      int cnt = 0;
+      for (Entry * e = first.load(memory_order_acquire); e; e = e->next)
+        cnt++;
+      if (cnt >= MAXRULES) return;
+
+      constexpr int NV = DIMR + DIMR*DIMS;
+      size_t nip = ir.Size();
+      Entry * e = new Entry;
+      e->refpoints.SetSize(DIMS*nip);
+      e->values.SetSize(NV*nip);
+      for (size_t i = 0; i < nip; i++)
+        {
+          for (int j = 0; j < DIMS; j++)
+            e->refpoints[i*DIMS+j] = ir[i](j);
+          SIMD<double> * v = &e->values[i*NV];
+          for (int j = 0; j < DIMR; j++)
+            v[j] = mir[i].GetPoint()(j);
+          for (int j = 0; j < DIMR; j++)
+            for (int k = 0; k < DIMS; k++)
+              v[DIMR+j*DIMS+k] = mir[i].GetJacobian()(j,k);
+        }
+
+      e->next = first.load(memory_order_relaxed);
+      while (!first.compare_exchange_weak (e->next, e, memory_order_release, memory_order_relaxed))
+        ;
+      nbytes += sizeof(Entry) + (e->refpoints.Size()+e->values.Size()) * sizeof(SIMD<double>);
+      nentries++;
+    }
+  };
+
   template <int DIMS, int DIMR>
   class Ng_ElementTransformation : public ElementTransformation
   {
@@ -207,6 +316,10 @@ namespace ngcomp
       // static Timer t("eltrans::multipointjacobian"); RegionTimer reg(t);
       SIMD_MappedIntegrationRule<DIMS,DIMR> & mir = 
 	static_cast<SIMD_MappedIntegrationRule<DIMS,DIMR> &> (bmir);
+
+      auto cache = mesh->GetGeometryCache();
+      if (cache && cache->Lookup (VB(), elnr, ir, mir))
+        return;
       
       mesh->mesh.MultiElementTransformation <DIMS,DIMR>
         (elnr, ir.Size(),
@@ -216,6 +329,9 @@ namespace ngcomp
       
       for (int i = 0; i < ir.Size(); i++)
         mir[i].Compute();
+
+      if (cache)
+        cache->Store (VB(), elnr, ir, mir);
     }
 
     virtual const ElementTransformation & VAddDeformation (const GridFunction * gf, LocalHeap & lh) const override
@@ -1142,6 +1258,9 @@ namespace ngcomp
       }
     
     CalcIdentifiedFacets();
+
+    if (geometry_cache)
+      geometry_cache = make_shared<GeometryCache> (*this);
   }
 
   void MeshAccess :: 
@@ -1919,6 +2038,150 @@ namespace ngcomp
   }
 
 
+  static bool InsideReferenceElement (ELEMENT_TYPE et, const IntegrationPoint & ip, double eps)
+  {
+    double x = ip(0), y = ip(1), z = ip(2);
+    switch (et)
+      {
+      case ET_SEGM:
+        return x > -eps && x < 1+eps;
+      case ET_TRIG:
+        return x > -eps && y > -eps && x+y < 1+eps;
+      case ET_QUAD:
+        return x > -eps && y > -eps && x < 1+eps && y < 1+eps;
+      case ET_TET:
+        return x > -eps && y > -eps && z > -eps && x+y+z < 1+eps;
+      case ET_PRISM:
+        return x > -eps && y > -eps && x+y < 1+eps && z > -eps && z < 1+eps;
+      case ET_PYRAMID:
+        return z > -eps && z < 1+eps && x > -eps && y > -eps && x < 1-z+eps && y < 1-z+eps;
+      case ET_HEX:
+        return x > -eps && y > -eps && z > -eps && x < 1+eps && y < 1+eps && z < 1+eps;
+      default:
+        return false;
+      }
+  }
+
+  // Newton iteration for the reference coordinates of point in a volume
+  // element, returns true if the point is inside
+  template <int DIM>
+  static bool PointInVolumeElement (const ElementTransformation & trafo,
+                                    const double * point, IntegrationPoint & ip)
+  {
+    ELEMENT_TYPE et = trafo.GetElementType();
+    const POINT3D * verts = ElementTopology::GetVertices(et);
+    int nv = ElementTopology::GetNVertices(et);
+    Vec<3> xi = 0.0;
+    for (int i = 0; i < nv; i++)
+      for (int j = 0; j < 3; j++)
+        xi(j) += verts[i][j] / nv;
+
+    Vec<DIM> x;
+    Mat<DIM,DIM> jac;
+    for (int it = 0; it < 10; it++)
+      {
+        ip = IntegrationPoint(xi(0), xi(1), xi(2));
+        trafo.CalcPointJacobian (ip, x, jac);
+        Vec<DIM> res;
+        for (int j = 0; j < DIM; j++)
+          res(j) = point[j] - x(j);
+        Vec<DIM> dxi = Inv(jac) * res;
+        for (int j = 0; j < DIM; j++)
+          xi(j) += dxi(j);
+        if (L2Norm(dxi) < 1e-12)
+          break;
+        // far outside, the element is not a candidate
+        if (L2Norm(xi) > 10)
+          return false;
+      }
+    ip = IntegrationPoint(xi(0), xi(1), xi(2));
+    return InsideReferenceElement(et, ip, 1e-10);
+  }
+
+  void MeshAccess :: FindElementsOfPoints (SliceMatrix<double> points,
+                                           FlatArray<MeshPoint> result,
+                                           VorB vb) const
+  {
+    static Timer t("FindElementsOfPoints"); RegionTimer reg(t);
+    if (vb != VOL && vb != BND)
+      throw Exception("FindElementsOfPoints: only VOL and BND elements are supported");
+    if (vb == BND && dim == 1)
+      throw Exception("FindElementsOfPoints on BND for mesh-dim = 1 not implemented yet!");
+    size_t np = points.Height();
+    if (np == 0) return;
+
+    auto locate = [&] (const double * pnt, IntegrationPoint & ip, bool build) -> int
+      {
+        int edim = (vb == VOL) ? dim : dim-1;
+        switch (edim)
+          {
+          case 1: return mesh.FindElementOfPoint<1> (pnt, &ip(0), build, NULL, 0);
+          case 2: return mesh.FindElementOfPoint<2> (pnt, &ip(0), build, NULL, 0);
+          case 3: return mesh.FindElementOfPoint<3> (pnt, &ip(0), build, NULL, 0);
+          }
+        return -1;
+      };
+
+    // build the search tree once, before the parallel queries
+    {
+      Vec<3> p0 = 0.0;
+      for (size_t j = 0; j < min2(size_t(3), points.Width()); j++)
+        p0(j) = points(0,j);
+      IntegrationPoint ip;
+      locate(&p0(0), ip, true);
+    }
+
+    ParallelForRange (np, [&] (IntRange r)
+      {
+        LocalHeap lh(100000, "FindElementsOfPoints");
+        Array<int> elnums;
+        int last = -1;
+        for (auto i : r)
+          {
+            HeapReset hr(lh);
+            Vec<3> pnt = 0.0;
+            for (size_t j = 0; j < min2(size_t(3), points.Width()); j++)
+              pnt(j) = points(i,j);
+            IntegrationPoint ip;
+            int elnr = -1;
+
+            if (vb == VOL && last >= 0)
+              {
+                auto try_element = [&] (int el)
+                  {
+                    auto & trafo = GetTrafo (ElementId(VOL, el), lh);
+                    bool inside = false;
+                    Switch<3> (dim-1, [&] (auto DIM) {
+                        inside = PointInVolumeElement<DIM.value+1> (trafo, &pnt(0), ip);
+                      });
+                    return inside;
+                  };
+                if (try_element(last))
+                  elnr = last;
+                else
+                  for (auto f : GetElFacets(ElementId(VOL, last)))
+                    {
+                      GetFacetElements (f, elnums);
+                      for (auto el : elnums)
+                        if (el != last && try_element(el))
+                          {
+                            elnr = el;
+                            break;
+                          }
+                      if (elnr >= 0) break;
+                    }
+              }
+
+            if (elnr < 0)
+              elnr = locate(&pnt(0), ip, false);
+            if (elnr >= 0)
+              last = elnr;
+            result[i] = MeshPoint { ip(0), ip(1), ip(2), const_cast<MeshAccess*>(this), vb, elnr };
+          }
+      });
+  }
+
+
   void NGSolveTaskManager (function<void(int,int)> func)
   {
     // cout << "call ngsolve taskmanager from netgen, tm = " << task_manager << endl;
@@ -1959,7 +2222,25 @@ namespace ngcomp
   void MeshAccess :: Curve (int order)
   {
     mesh.Curve(order);
+    if (geometry_cache)
+      geometry_cache = make_shared<GeometryCache> (*this);
   } 
+
+  void MeshAccess :: EnableGeometryCache (bool enable)
+  {
+    if (!enable)
+      geometry_cache = nullptr;
+    else if (!geometry_cache)
+      geometry_cache = make_shared<GeometryCache> (*this);
+  }
+
+  Array<MemoryUsage> MeshAccess :: GetMemoryUsage () const
+  {
+    Array<MemoryUsage> mu;
+    if (geometry_cache)
+      mu += { "geometry cache", geometry_cache->NBytes(), geometry_cache->NEntries() };
+    return mu;
+  }
   
   int MeshAccess :: GetCurveOrder ()
   {
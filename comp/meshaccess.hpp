@@ -24,6 +24,7 @@ namespace ngcomp
   using netgen::Ng_Node;
   
   class MeshAccess;
+  class GeometryCache;
   class Ngs_Element;
   
 
@@ -232,6 +233,9 @@ namespace ngcomp
     /// for ALE
     shared_ptr<GridFunction> deformation;  
 
+    /// cached mapped integration rules of curved elements (opt-in)
+    shared_ptr<GeometryCache> geometry_cache;
+
     /// pml trafos per sub-domain
     Array<shared_ptr <PML_Transformation>> pml_trafos;
     
@@ -676,6 +680,13 @@ namespace ngcomp
       return deformation;
     }
 
+    /// store mapped points and Jacobians of SIMD integration rules on curved
+    /// elements, re-used by all later assemblies. Reset if the mesh changes
+    void EnableGeometryCache (bool enable = true);
+    GeometryCache * GetGeometryCache () const { return geometry_cache.get(); }
+
+    Array<MemoryUsage> GetMemoryUsage () const;
+
     void SetPML (const shared_ptr<PML_Transformation> & pml_trafo, int _domnr);
     void UnSetPML (int _domnr);
 
@@ -1061,6 +1072,14 @@ namespace ngcomp
 				   bool build_searchtree,
 				   int index) const;
 
+    /// locate many points (rows of points) at once, in parallel.
+    /// The search tree is built once, a point is first searched in the
+    /// element of the previous point and its neighbours, so sorted queries
+    /// hardly use the tree. Not found points get element number -1.
+    void FindElementsOfPoints (SliceMatrix<double> points,
+                               FlatArray<MeshPoint> result,
+                               VorB vb = VOL) const;
+
     /// is element straight or curved ?
     [[deprecated("Use GetElement(id).is_curved instead!")]]        
     bool IsElementCurved (int elnr) const
@@ -1568,8 +1568,32 @@ active_dofs : BitArray or None
     .def("Update", [](GF& self) { self.Update(); },
          "update vector size to finite element space dimension after mesh refinement")
     
-    .def("Save", [](GF& self, string filename, bool parallel)
+    .def("Save", [](GF& self, string filename, bool parallel, bool asynchronous)
          {
+           if (asynchronous)
+             {
+               // snapshot now, write while the computation continues
+               shared_ptr<string> buffer;
+               if (parallel)
+                 {
+                   ostringstream out(ios::binary);
+                   self.Save(out);
+                   buffer = make_shared<string>(out.str());
+                 }
+               else
+                 {
+                   auto fv = self.GetVector().FVDouble();
+                   buffer = make_shared<string>(fv.Size()*sizeof(double), '\0');
+                   memcpy (&(*buffer)[0], fv.Data(), buffer->size());
+                 }
+               BackgroundWriter::Get().Push
+                 ([filename, buffer] ()
+                  {
+                    ofstream out(filename, ios::binary);
+                    out.write(buffer->data(), buffer->size());
+                  });
+               return;
+             }
            ofstream out(filename, ios::binary);
            if (parallel)
              self.Save(out);
@@ -1577,7 +1601,8 @@ active_dofs : BitArray or None
              for (auto d : self.GetVector().FVDouble())
                SaveBin(out, d);
          },
-         py::arg("filename"), py::arg("parallel")=false, docu_string(R"raw_string(
+         py::arg("filename"), py::arg("parallel")=false, py::arg("asynchronous")=false,
+         docu_string(R"raw_string(
 Saves the gridfunction into a file.
 
 Parameters:
@@ -1588,6 +1613,41 @@ filename : string
 parallel : bool
   input parallel
 
+asynchronous : bool
+  copy the data and write the file on a background thread (see WaitForOutput)
+
+)raw_string"))
+    .def("SaveCheckpoint", [](GF& self, string filename)
+         {
+           self.SaveCheckpoint(filename);
+         },
+         py::arg("filename"), py::call_guard<py::gil_scoped_release>(), docu_string(R"raw_string(
+Writes a binary checkpoint of all multidim vectors.
+
+The file starts with a versioned header (space type, order, ndof and a
+fingerprint of the dof numbering), followed by the raw vector entries
+at offset 4096. With a distributed mesh every rank writes its own
+'filename.<rank>' and rank 0 writes an index 'filename'.
+
+Parameters:
+
+filename : string
+  output file name
+
+)raw_string"))
+    .def("LoadCheckpoint", [](GF& self, string filename)
+         {
+           self.LoadCheckpoint(filename);
+         },
+         py::arg("filename"), py::call_guard<py::gil_scoped_release>(), docu_string(R"raw_string(
+Restarts from a checkpoint written by SaveCheckpoint. The space and
+the partition have to be the same, which is checked via the header.
+
+Parameters:
+
+filename : string
+  input file name
+
 )raw_string"))
     .def("Load", [](GF& self, string filename, bool parallel)
          {
@@ -2056,7 +2116,20 @@ space : ngsolve.FESpace
                      "  when element matrices are independent of geometry, we store them \n"
                      "  only for the referecne elements",
                      py::arg("check_unused") = "bool = True\n"
-		     "  If set prints warnings if not UNUSED_DOFS are not used."
+		     "  If set prints warnings if not UNUSED_DOFS are not used.",
+                     py::arg("assembly_plan") = "bool = False\n"
+                     "  Cache the matrix positions of all element matrices at the\n"
+                     "  first assembly. Re-assembly with unchanged mesh and space\n"
+                     "  then scatters without searching the sparsity pattern.\n"
+                     "  Dof numbers and element matrices are still computed anew.",
+                     py::arg("atomic_assembly") = "bool = False\n"
+                     "  Assemble in parallel over chunks of consecutive elements and\n"
+                     "  facets without coloring, conflicts are resolved by atomic adds.\n"
+                     "  Not used if preconditioners are registered to the form.",
+                     py::arg("batch_assembly") = "bool = False\n"
+                     "  Compute element matrices of symbolic integrators in batches\n"
+                     "  of elements with the same type and order. The coefficient is\n"
+                     "  evaluated for all integration points of the batch at once."
                      );
                 })
 
@@ -3640,9 +3713,24 @@ deformation : ngsolve.comp.GridFunction
               return;
              });
 
+   m.def("WaitForOutput", [] ()
+         {
+           BackgroundWriter::Get().Wait();
+         },
+         py::call_guard<py::gil_scoped_release>(),
+         "Blocks until all asynchronous output is written");
+
+   m.def("SetOutputQueueSize", [] (size_t maxjobs)
+         {
+           BackgroundWriter::Get().SetMaxJobs(maxjobs);
+         },
+         py::arg("maxjobs"),
+         "Maximal number of pending asynchronous outputs before VTKOutput.Do and GridFunction.Save block");
+
    py::class_<BaseVTKOutput, shared_ptr<BaseVTKOutput>>(m, "VTKOutput")
     .def(py::init([] (shared_ptr<MeshAccess> ma, py::list coefs_list,
-                      py::list names_list, string filename, int subdivision, int only_element)
+                      py::list names_list, string filename, int subdivision, int only_element,
+                      string floatsize, bool vtu, string encoding, bool asynchronous)
          -> shared_ptr<BaseVTKOutput>
          {
            Array<shared_ptr<CoefficientFunction> > coefs
@@ -3651,9 +3739,11 @@ deformation : ngsolve.comp.GridFunction
              = makeCArray<string> (names_list);
            shared_ptr<BaseVTKOutput> ret;
            if (ma->GetDimension() == 2)
-             ret = make_shared<VTKOutput<2>> (ma, coefs, names, filename, subdivision, only_element);
+             ret = make_shared<VTKOutput<2>> (ma, coefs, names, filename, subdivision, only_element,
+                                              vtu, floatsize, encoding, asynchronous);
            else
-             ret = make_shared<VTKOutput<3>> (ma, coefs, names, filename, subdivision, only_element);
+             ret = make_shared<VTKOutput<3>> (ma, coefs, names, filename, subdivision, only_element,
+                                              vtu, floatsize, encoding, asynchronous);
            return ret;
          }),
          py::arg("ma"),
@@ -3661,20 +3751,48 @@ deformation : ngsolve.comp.GridFunction
          py::arg("names") = py::list(),
          py::arg("filename") = "vtkout",
          py::arg("subdivision") = 0,
-         py::arg("only_element") = -1
-         )
-     .def("Do", [](shared_ptr<BaseVTKOutput> self, VorB vb)
+         py::arg("only_element") = -1,
+         py::arg("floatsize") = "double",
+         py::arg("vtu") = false,
+         py::arg("encoding") = "raw",
+         py::arg("asynchronous") = false,
+         docu_string(R"raw_string(
+Writes coefficient functions evaluated on a (subdivided) mesh for ParaView.
+
+By default every call of Do writes an ASCII legacy file 'filename[_i].vtk'.
+With vtu=True it writes a binary XML unstructured grid 'filename[_i].vtu'
+and updates the time series index 'filename.pvd'. With MPI every rank
+writes its own piece and rank 0 writes a '.pvtu' master file referencing them.
+
+Parameters:
+
+vtu : bool
+  write XML '.vtu' files and a '.pvd' time series instead of '.vtk' files
+
+floatsize : string
+  "double" or "single" precision of points and fields (.vtu only)
+
+encoding : string
+  appended data of the .vtu files as "raw" binary or "base64"
+
+asynchronous : bool
+  Do only evaluates the fields, encoding and writing the .vtu files
+  runs on a background thread (see WaitForOutput)
+)raw_string"))
+     .def("Do", [](shared_ptr<BaseVTKOutput> self, VorB vb, double time)
           { 
-            self->Do(glh,vb);
+            self->Do(glh, vb, nullptr, time);
           },
           py::arg("vb")=VOL,
+          py::arg("time")=-1,
           py::call_guard<py::gil_scoped_release>())
-     .def("Do", [](shared_ptr<BaseVTKOutput> self, VorB vb, const BitArray * drawelems)
+     .def("Do", [](shared_ptr<BaseVTKOutput> self, VorB vb, const BitArray * drawelems, double time)
           { 
-            self->Do(glh, vb, drawelems);
+            self->Do(glh, vb, drawelems, time);
           },
           py::arg("vb")=VOL,
           py::arg("drawelems"),
+          py::arg("time")=-1,
           py::call_guard<py::gil_scoped_release>())
      ;
    
@@ -671,6 +671,20 @@ mesh (netgen.Mesh): a mesh generated from Netgen
     .def("GetCurveOrder", &MeshAccess::GetCurveOrder,
 	 "")
 
+    .def("EnableGeometryCache", &MeshAccess::EnableGeometryCache,
+         py::arg("enable") = true,
+         "Store mapped integration points and Jacobians of curved elements,\n"
+         "and re-use them in later assemblies. The cache is reset if the mesh changes.")
+
+    .def_property_readonly("__memory__",
+                           [] (const MeshAccess & self)
+                           {
+                             std::vector<tuple<string,size_t, size_t>> ret;
+                             for (auto mui : self.GetMemoryUsage())
+                               ret.push_back ( make_tuple(mui.Name(), mui.NBytes(), mui.NBlocks()));
+                             return ret;
+                           })
+
     .def("Contains",
          [](MeshAccess & ma, double x, double y, double z) 
           {
@@ -699,6 +713,34 @@ mesh (netgen.Mesh): a mesh generated from Netgen
                                    points.Append({p(0), p(1), p(2), self, vb, int(el.Nr())});
                                return MoveToNumpyArray(points);
                              })
+    .def("FindElementsOfPoints", [](MeshAccess* self,
+                                    py::array_t<double, py::array::c_style | py::array::forcecast> pnts,
+                                    VorB vb) -> py::array_t<MeshPoint>
+         {
+           if (pnts.ndim() != 2 || pnts.shape(1) < 1 || pnts.shape(1) > 3)
+             throw Exception("FindElementsOfPoints: points must be an array of shape (n, dim)");
+           auto p = pnts.unchecked<2>();
+           size_t np = p.shape(0), w = p.shape(1);
+           Array<MeshPoint> points(np);
+           self->FindElementsOfPoints (SliceMatrix<double>(np, w, w, const_cast<double*>(p.data(0,0))),
+                                       points, vb);
+           return MoveToNumpyArray(points);
+         }, py::arg("points"), py::arg("VOL_or_BND") = VOL,
+         docu_string(R"raw_string(Locate many points at once, in parallel.
+
+Parameters:
+
+points : numpy.ndarray
+  array of shape (n, dim) with the coordinates of the points
+
+VOL_or_BND : ngsolve.comp.VorB
+  search in volume (default) or surface elements
+
+Returns a numpy array of MeshPoints, which can be passed to
+CoefficientFunctions for vectorized evaluation. Points outside
+the mesh get element number -1. Sorted points (neighbouring points
+following each other) are located faster.
+)raw_string"))
     ;
     PyDefVectorized(mesh_access, "__call__",
          [](MeshAccess* ma, double x, double y, double z, VorB vb)
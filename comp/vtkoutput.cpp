@@ -9,6 +9,94 @@
 namespace ngcomp
 { 
 
+  BackgroundWriter :: ~BackgroundWriter ()
+  {
+    {
+      lock_guard<std::mutex> guard(queue_mutex);
+      stop = true;
+    }
+    cv.notify_all();
+    if (worker.joinable())
+      worker.join();
+  }
+
+  void BackgroundWriter :: Run ()
+  {
+    while (true)
+      {
+        std::function<void()> job;
+        {
+          unique_lock<std::mutex> lock(queue_mutex);
+          cv.wait (lock, [this] { return stop || jobs.size(); });
+          if (jobs.size() == 0) return;   // stopped and drained
+          job = std::move(jobs.front());
+          jobs.pop_front();
+          busy = true;
+        }
+
+        try
+          {
+            job();
+          }
+        catch (...)
+          {
+            lock_guard<std::mutex> guard(queue_mutex);
+            if (!error) error = std::current_exception();
+          }
+
+        {
+          lock_guard<std::mutex> guard(queue_mutex);
+          busy = false;
+        }
+        cv.notify_all();
+      }
+  }
+
+  void BackgroundWriter :: CheckError ()
+  {
+    // called with the lock held
+    if (error)
+      {
+        auto e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+      }
+  }
+
+  void BackgroundWriter :: SetMaxJobs (size_t amaxjobs)
+  {
+    lock_guard<std::mutex> guard(queue_mutex);
+    maxjobs = max2(amaxjobs, size_t(1));
+  }
+
+  void BackgroundWriter :: Push (std::function<void()> job)
+  {
+    unique_lock<std::mutex> lock(queue_mutex);
+    if (!worker.joinable())
+      worker = std::thread([this] { Run(); });
+
+    // backpressure: wait until the queue has room
+    cv.wait (lock, [this] { return error || jobs.size()+busy < maxjobs; });
+    CheckError();
+    jobs.push_back (std::move(job));
+    lock.unlock();
+    cv.notify_all();
+  }
+
+  void BackgroundWriter :: Wait ()
+  {
+    unique_lock<std::mutex> lock(queue_mutex);
+    cv.wait (lock, [this] { return jobs.size() == 0 && !busy; });
+    CheckError();
+  }
+
+  BackgroundWriter & BackgroundWriter :: Get ()
+  {
+    static BackgroundWriter writer;
+    return writer;
+  }
+
+
   ValueField::ValueField(int adim, string aname) : Array<double>(),  dim(adim), name(aname){;}
 
   template <int D> 
@@ -19,7 +107,11 @@ namespace ngcomp
                 flags.GetStringListFlag ("fieldnames" ),
                 flags.GetStringFlag ("filename","output"),
                 (int) flags.GetNumFlag ( "subdivision", 0),
-                (int) flags.GetNumFlag ( "only_element", -1))
+                (int) flags.GetNumFlag ( "only_element", -1),
+                flags.GetDefineFlag ( "vtu" ),
+                flags.GetStringFlag ( "floatsize", "double"),
+                flags.GetStringFlag ( "encoding", "raw"),
+                flags.GetDefineFlag ( "asynchronous" ))
   {;}
 
 
@@ -27,10 +119,19 @@ namespace ngcomp
   VTKOutput<D>::VTKOutput (shared_ptr<MeshAccess> ama,
                            const Array<shared_ptr<CoefficientFunction>> & a_coefs,
                            const Array<string> & a_field_names,
-                           string a_filename, int a_subdivision, int a_only_element)
+                           string a_filename, int a_subdivision, int a_only_element,
+                           bool a_vtu, string a_floatsize, string a_encoding,
+                           bool a_asynchronous)
     : ma(ama), coefs(a_coefs), fieldnames(a_field_names),
-      filename(a_filename), subdivision(a_subdivision), only_element(a_only_element)
+      filename(a_filename), subdivision(a_subdivision), only_element(a_only_element),
+      vtu(a_vtu), floatsize(a_floatsize), encoding(a_encoding),
+      asynchronous(a_asynchronous)
   {
+    if (floatsize != "single" && floatsize != "double")
+      throw Exception("VTKOutput: floatsize must be 'single' or 'double', got '"+floatsize+"'");
+    if (encoding != "raw" && encoding != "base64")
+      throw Exception("VTKOutput: encoding must be 'raw' or 'base64', got '"+encoding+"'");
+
     value_field.SetSize(a_coefs.Size());
     for (int i = 0; i < a_coefs.Size(); i++)
       if (fieldnames.Size() > i)
@@ -40,12 +141,28 @@ namespace ngcomp
   }
 
 
+  template <int D> 
+  VTKOutput<D>::~VTKOutput()
+  {
+    // pending jobs still write from this object
+    if (asynchronous)
+      {
+        // a destructor must not throw, whatever the writer failed with
+        try { BackgroundWriter::Get().Wait(); }
+        catch (std::exception & e)
+          { cerr << "VTKOutput: background output failed: " << e.what() << endl; }
+        catch (...)
+          { cerr << "VTKOutput: background output failed" << endl; }
+      }
+  }
+
   /// Empty all field 
   template <int D> 
   void VTKOutput<D>::ResetArrays()
   {
     points.SetSize(0);
     cells.SetSize(0);
+    celltypes.SetSize(0);
     for (auto field : value_field)
       field->SetSize(0);
   }
@@ -409,140 +526,440 @@ namespace ngcomp
     
 
   template <int D> 
-  void VTKOutput<D>::Do (LocalHeap & lh, VorB vb, const BitArray * drawelems)
+  void VTKOutput<D>::FillData (LocalHeap & lh, VorB vb, const BitArray * drawelems)
   {
-    ostringstream filenamefinal;
-    filenamefinal << filename;
-    if (output_cnt > 0)
-      filenamefinal << "_" << output_cnt;
-    filenamefinal << ".vtk";
-    fileout = make_shared<ofstream>(filenamefinal.str());
-    cout << IM(4) << " Writing VTK-Output";
-    if (output_cnt > 0)
-      cout << IM(4) << " ( " << output_cnt << " )";
-    cout << IM(4) << ":" << flush;
-    
-    output_cnt++;
+    static Timer t("VTKOutput::FillData"); RegionTimer reg(t);
 
     ResetArrays();
 
     Array<IntegrationPoint> ref_vertices_tet(0), ref_vertices_prism(0), ref_vertices_trig(0), ref_vertices_quad(0), ref_vertices_hex(0);
     Array<INT<ELEMENT_MAXPOINTS+1>> ref_tets(0), ref_prisms(0), ref_trigs(0), ref_quads(0), ref_hexes(0);
-    FlatArray<IntegrationPoint> ref_vertices;
-    FlatArray<INT<ELEMENT_MAXPOINTS+1>> ref_elems;
-    /*
-    if (D==3)
-      FillReferenceData3D(ref_vertices,ref_tets);
-    else
-      FillReferenceData2D(ref_vertices,ref_tets);
-    */
     FillReferenceTet(ref_vertices_tet,ref_tets);
     FillReferencePrism(ref_vertices_prism,ref_prisms);
     FillReferenceQuad(ref_vertices_quad,ref_quads);
     FillReferenceTrig(ref_vertices_trig,ref_trigs);
     FillReferenceHex(ref_vertices_hex,ref_hexes);
-      
-    // header:
-    *fileout << "# vtk DataFile Version 3.0" << endl;
-    *fileout << "vtk output" << endl;
-    *fileout << "ASCII" << endl;
-    *fileout << "DATASET UNSTRUCTURED_GRID" << endl;
 
-    int ne = ma->GetNE(vb);
+    // reference points, sub-cells and VTK cell type of an element type
+    auto GetReference = [&] (ELEMENT_TYPE eltype)
+      -> tuple<FlatArray<IntegrationPoint>, FlatArray<INT<ELEMENT_MAXPOINTS+1>>, unsigned char>
+      {
+        switch(eltype)
+          {
+          case ET_TRIG:  return { ref_vertices_trig, ref_trigs, 5 };
+          case ET_QUAD:  return { ref_vertices_quad, ref_quads, 9 };
+          case ET_TET:   return { ref_vertices_tet, ref_tets, 10 };
+          case ET_HEX:   return { ref_vertices_hex, ref_hexes, 12 };
+          case ET_PRISM: return { ref_vertices_prism, ref_prisms, 13 };
+          default:
+            throw Exception("VTK output for element-type"+ToString(eltype)+"not supported");
+          }
+      };
 
+    // first pass: offsets of every element into the point and cell arrays
+    int ne = ma->GetNE(vb);
     IntRange range = only_element >= 0 ? IntRange(only_element,only_element+1) : IntRange(ne);
-    
-    for ( int elnr : range)
-    {
-      if (drawelems && !(drawelems->Test(elnr)))
+
+    Array<int> elnrs;
+    Array<size_t> first_point, first_cell;
+    first_point.Append(0);
+    first_cell.Append(0);
+    for (int elnr : range)
+      {
+        if (drawelems && !(drawelems->Test(elnr)))
           continue;
-      
-      HeapReset hr(lh);
+        auto ref = GetReference(ma->GetElType(ElementId(vb, elnr)));
+        elnrs.Append(elnr);
+        first_point.Append(first_point.Last() + get<0>(ref).Size());
+        first_cell.Append(first_cell.Last() + get<1>(ref).Size());
+      }
+
+    points.SetSize(first_point.Last());
+    cells.SetSize(first_cell.Last());
+    celltypes.SetSize(first_cell.Last());
+    for (int i = 0; i < coefs.Size(); i++)
+      value_field[i]->SetSize(first_point.Last()*coefs[i]->Dimension());
+
+    // second pass: evaluate elements in parallel, each writes its own slots
+    ParallelForRange
+      (elnrs.Size(), [&] (IntRange r)
+       {
+         LocalHeap llh = lh.Split();
+         for (auto i : r)
+           {
+             HeapReset hr(llh);
+             ElementId ei(vb, elnrs[i]);
+             ElementTransformation & eltrans = ma->GetTrafo (ei, llh);
+             auto [ref_vertices, ref_elems, celltype] = GetReference(ma->GetElType(ei));
+
+             IntegrationRule ir(ref_vertices.Size(), ref_vertices.Data());
+             BaseMappedIntegrationRule & mir = eltrans(ir, llh);
+
+             size_t offset = first_point[i];
+             auto pts = mir.GetPoints();
+             for (size_t j = 0; j < ir.Size(); j++)
+               for (int d = 0; d < D; d++)
+                 points[offset+j](d) = pts(j,d);
+
+             for (int k = 0; k < coefs.Size(); k++)
+               {
+                 int dim = coefs[k]->Dimension();
+                 FlatMatrix<> vals(ir.Size(), dim, llh);
+                 coefs[k]->Evaluate(mir, vals);
+                 FlatVector<>(ir.Size()*dim, value_field[k]->Data()+offset*dim) = vals.AsVector();
+               }
+
+             for (size_t j = 0; j < ref_elems.Size(); j++)
+               {
+                 INT<ELEMENT_MAXPOINTS+1> new_elem = ref_elems[j];
+                 for (int l = 1; l <= new_elem[0]; ++l)
+                   new_elem[l] += offset;
+                 cells[first_cell[i]+j] = new_elem;
+                 celltypes[first_cell[i]+j] = celltype;
+               }
+           }
+       });
+  }
+
+
+  /// one DataArray of the appended data section of a .vtu file
+  struct VTUDataArray
+  {
+    string name;
+    string type;
+    int ncomp;
+    Array<char> data;
+  };
+
+  static string VTUTypeName (float) { return "Float32"; }
+  static string VTUTypeName (double) { return "Float64"; }
+  static string VTUTypeName (int32_t) { return "Int32"; }
+  static string VTUTypeName (int64_t) { return "Int64"; }
+  static string VTUTypeName (uint8_t) { return "UInt8"; }
+
+  /// runs func on sub-ranges of [0,n), with the TaskManager if parallel
+  template <typename FUNC>
+  static void VTUForRange (bool parallel, size_t n, FUNC func)
+  {
+    if (parallel)
+      ParallelForRange (n, func);
+    else
+      func (IntRange(n));
+  }
 
-      ElementId ei(vb, elnr);
-      ElementTransformation & eltrans = ma->GetTrafo (ei, lh);
-      ELEMENT_TYPE eltype = ma->GetElType(ei);
+  /// converts n values given by get(i) to TOUT
+  template <typename TOUT, typename FUNC>
+  static VTUDataArray MakeVTUDataArray (bool parallel, string name, int ncomp, size_t n, FUNC get)
+  {
+    VTUDataArray a { name, VTUTypeName(TOUT()), ncomp, Array<char>(n*sizeof(TOUT)) };
+    TOUT * p = reinterpret_cast<TOUT*> (a.data.Data());
+    VTUForRange (parallel, n, [&] (IntRange r)
+                 {
+                   for (auto i : r)
+                     p[i] = get(i);
+                 });
+    return a;
+  }
 
-      switch(eltype)
+  static void WriteBase64 (ostream & out, const char * data, size_t n)
+  {
+    static const char table[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const unsigned char * p = reinterpret_cast<const unsigned char*> (data);
+    string buf;
+    buf.reserve(4*((n+2)/3));
+    size_t i = 0;
+    for ( ; i+2 < n; i += 3)
       {
-      case ET_TRIG:
-        ref_vertices.Assign(ref_vertices_trig);
-        ref_elems.Assign(ref_trigs);
-        break;
-      case ET_QUAD:
-        ref_vertices.Assign(ref_vertices_quad);
-        ref_elems.Assign(ref_quads);
-        break;
-      case ET_TET:
-        ref_vertices.Assign(ref_vertices_tet);
-        ref_elems.Assign(ref_tets);
-        break;
-      case ET_HEX:
-        ref_vertices.Assign(ref_vertices_hex);
-        ref_elems.Assign(ref_hexes);
-        break;        
-      case ET_PRISM:
-        ref_vertices.Assign(ref_vertices_prism);
-        ref_elems.Assign(ref_prisms);
-        break;
-      default:
-        throw Exception("VTK output for element-type"+ToString(eltype)+"not supported");
+        uint32_t v = (uint32_t(p[i]) << 16) | (uint32_t(p[i+1]) << 8) | p[i+2];
+        buf += table[(v >> 18) & 63];
+        buf += table[(v >> 12) & 63];
+        buf += table[(v >> 6) & 63];
+        buf += table[v & 63];
+      }
+    if (i < n)
+      {
+        uint32_t v = uint32_t(p[i]) << 16;
+        if (i+1 < n) v |= uint32_t(p[i+1]) << 8;
+        buf += table[(v >> 18) & 63];
+        buf += table[(v >> 12) & 63];
+        buf += (i+1 < n) ? table[(v >> 6) & 63] : '=';
+        buf += '=';
       }
+    out.write(buf.data(), buf.size());
+  }
 
-      int offset = points.Size();
-      for ( auto ip : ref_vertices)
+  static string VTKByteOrder ()
+  {
+    uint16_t one = 1;
+    return *reinterpret_cast<uint8_t*>(&one) ? "LittleEndian" : "BigEndian";
+  }
+
+  template <int D> 
+  shared_ptr<typename VTKOutput<D>::OutputData> VTKOutput<D>::TakeData ()
+  {
+    auto data = make_shared<OutputData>();
+    data->points = std::move(points);
+    data->cells = std::move(cells);
+    data->celltypes = std::move(celltypes);
+    data->fields.SetAllocSize(value_field.Size());
+    for (auto field : value_field)
       {
-        if (vb==VOL)
-        {
-          MappedIntegrationPoint<D,D> mip(ip, eltrans);
-          points.Append(mip.GetPoint());
-        }
-        else
-        {
-          MappedIntegrationPoint<D-1,D> mip(ip, eltrans);
-          points.Append(mip.GetPoint());
-        }
+        ValueField f(field->Dimension(), field->Name());
+        static_cast<Array<double>&>(f) = std::move(static_cast<Array<double>&>(*field));
+        data->fields.Append(std::move(f));
       }
-      
-      for (int i = 0; i < coefs.Size(); i++)
+    return data;
+  }
+
+  template <int D> 
+  void VTKOutput<D>::WriteVTU (const string & vtufilename, const OutputData & data, bool parallel) const
+  {
+    auto & points = data.points;
+    auto & cells = data.cells;
+    auto & celltypes = data.celltypes;
+
+    size_t np = points.Size();
+    size_t nc = cells.Size();
+    size_t nconn = 0;
+    for (auto c : cells)
+      nconn += c[0];
+
+    // compact encoding: Int32 connectivity whenever it fits
+    bool index64 = max2(np, nconn) > size_t(std::numeric_limits<int32_t>::max());
+    bool single = floatsize == "single";
+
+    auto MakeFloatArray = [&] (string name, int ncomp, size_t n, auto get)
       {
-        for ( auto ip : ref_vertices)
-        {
-          if (vb==VOL)
+        return single ? MakeVTUDataArray<float>(parallel, name, ncomp, n, get)
+          : MakeVTUDataArray<double>(parallel, name, ncomp, n, get);
+      };
+    auto MakeIndexArray = [&] (string name, size_t n, auto get)
+      {
+        return index64 ? MakeVTUDataArray<int64_t>(parallel, name, 1, n, get)
+          : MakeVTUDataArray<int32_t>(parallel, name, 1, n, get);
+      };
+
+    Array<size_t> conn_offset(nc+1);
+    conn_offset[0] = 0;
+    for (size_t i = 0; i < nc; i++)
+      conn_offset[i+1] = conn_offset[i] + cells[i][0];
+
+    auto pointarray = MakeFloatArray("Points", 3, 3*np, [&] (size_t i)
+                                     { return i%3 < D ? points[i/3](i%3) : 0.0; });
+    auto MakeConnectivity = [&] (auto tout)
+      {
+        using TOUT = decltype(tout);
+        VTUDataArray a { "connectivity", VTUTypeName(TOUT()), 1, Array<char>(nconn*sizeof(TOUT)) };
+        TOUT * p = reinterpret_cast<TOUT*> (a.data.Data());
+        VTUForRange (parallel, nc, [&] (IntRange r)
+                     {
+                       for (auto i : r)
+                         for (int j = 0; j < cells[i][0]; j++)
+                           p[conn_offset[i]+j] = cells[i][j+1];
+                     });
+        return a;
+      };
+    auto connarray = index64 ? MakeConnectivity(int64_t()) : MakeConnectivity(int32_t());
+    auto offsetarray = MakeIndexArray("offsets", nc, [&] (size_t i) { return conn_offset[i+1]; });
+    auto typearray = MakeVTUDataArray<uint8_t>(parallel, "types", 1, nc,
+                                               [&] (size_t i) { return celltypes[i]; });
+    Array<VTUDataArray> fields;
+    fields.SetAllocSize(data.fields.Size());
+    for (auto & field : data.fields)
+      fields.Append (MakeFloatArray(field.Name(), field.Dimension(), field.Size(),
+                                    [&] (size_t i) { return field[i]; }));
+
+    Array<VTUDataArray*> all { &pointarray, &connarray, &offsetarray, &typearray };
+    for (auto & f : fields)
+      all.Append (&f);
+
+    // byte offsets of the arrays in the appended section, header is one UInt64
+    auto EncodedSize = [&] (size_t n) -> size_t
+      {
+        return encoding == "raw" ? n : 4*((n+2)/3);
+      };
+    Array<size_t> offsets;
+    size_t offset = 0;
+    for (auto a : all)
+      {
+        offsets.Append(offset);
+        offset += EncodedSize(sizeof(uint64_t)) + EncodedSize(a->data.Size());
+      }
+
+    auto DataArrayTag = [&] (ostream & out, int nr)
+      {
+        out << "<DataArray type=\"" << all[nr]->type << "\" Name=\"" << all[nr]->name
+            << "\" NumberOfComponents=\"" << all[nr]->ncomp
+            << "\" format=\"appended\" offset=\"" << offsets[nr] << "\"/>" << endl;
+      };
+
+    ofstream out(vtufilename, ios::binary);
+    out << "<?xml version=\"1.0\"?>" << endl;
+    out << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"" << VTKByteOrder()
+        << "\" header_type=\"UInt64\">" << endl;
+    out << "<UnstructuredGrid>" << endl;
+    out << "<Piece NumberOfPoints=\"" << np << "\" NumberOfCells=\"" << nc << "\">" << endl;
+    out << "<Points>" << endl;
+    DataArrayTag(out, 0);
+    out << "</Points>" << endl;
+    out << "<Cells>" << endl;
+    for (int i = 1; i < 4; i++)
+      DataArrayTag(out, i);
+    out << "</Cells>" << endl;
+    out << "<PointData>" << endl;
+    for (int i = 4; i < all.Size(); i++)
+      DataArrayTag(out, i);
+    out << "</PointData>" << endl;
+    out << "</Piece>" << endl;
+    out << "</UnstructuredGrid>" << endl;
+    out << "<AppendedData encoding=\"" << encoding << "\">" << endl << "_";
+    for (auto a : all)
+      {
+        uint64_t nbytes = a->data.Size();
+        if (encoding == "raw")
           {
-            MappedIntegrationPoint<D,D> mip(ip, eltrans);
-            const int dim = coefs[i]->Dimension();
-            FlatVector<> tmp(dim,lh);
-            coefs[i]->Evaluate(mip,tmp);
-            for (int d = 0; d < dim; ++d)
-              value_field[i]->Append(tmp(d));
+            out.write(reinterpret_cast<char*>(&nbytes), sizeof(nbytes));
+            out.write(a->data.Data(), nbytes);
           }
-          else
+        else
           {
-            MappedIntegrationPoint<D-1,D> mip(ip, eltrans);
-            const int dim = coefs[i]->Dimension();
-            FlatVector<> tmp(dim,lh);
-            coefs[i]->Evaluate(mip,tmp);
-            for (int d = 0; d < dim; ++d)
-              value_field[i]->Append(tmp(d));
+            // header and data are encoded separately, as VTK expects for uncompressed data
+            WriteBase64(out, reinterpret_cast<char*>(&nbytes), sizeof(nbytes));
+            WriteBase64(out, a->data.Data(), nbytes);
           }
-        }
       }
-      
-      for ( auto elem : ref_elems)
+    out << endl << "</AppendedData>" << endl;
+    out << "</VTKFile>" << endl;
+  }
+
+  static string VTKBaseName (const string & path)
+  {
+    auto pos = path.find_last_of("/\\");
+    return pos == string::npos ? path : path.substr(pos+1);
+  }
+
+  template <int D> 
+  void VTKOutput<D>::WritePVTU (ostream & out, const string & piecename, int npieces) const
+  {
+    string ftype = floatsize == "single" ? "Float32" : "Float64";
+    out << "<?xml version=\"1.0\"?>" << endl;
+    out << "<VTKFile type=\"PUnstructuredGrid\" version=\"1.0\" byte_order=\"" << VTKByteOrder()
+        << "\" header_type=\"UInt64\">" << endl;
+    out << "<PUnstructuredGrid GhostLevel=\"0\">" << endl;
+    out << "<PPoints>" << endl
+        << "<PDataArray type=\"" << ftype << "\" Name=\"Points\" NumberOfComponents=\"3\"/>" << endl
+        << "</PPoints>" << endl;
+    out << "<PPointData>" << endl;
+    for (auto field : value_field)
+      out << "<PDataArray type=\"" << ftype << "\" Name=\"" << field->Name()
+          << "\" NumberOfComponents=\"" << field->Dimension() << "\"/>" << endl;
+    out << "</PPointData>" << endl;
+    for (int i = 0; i < npieces; i++)
+      out << "<Piece Source=\"" << VTKBaseName(piecename) << "_p" << i << ".vtu\"/>" << endl;
+    out << "</PUnstructuredGrid>" << endl;
+    out << "</VTKFile>" << endl;
+  }
+
+  template <int D> 
+  void VTKOutput<D>::WritePVD (ostream & out) const
+  {
+    out << "<?xml version=\"1.0\"?>" << endl;
+    out << "<VTKFile type=\"Collection\" version=\"0.1\">" << endl;
+    out << "<Collection>" << endl;
+    for (int i = 0; i < times.Size(); i++)
+      out << "<DataSet timestep=\"" << times[i] << "\" part=\"0\" file=\""
+          << VTKBaseName(timefiles[i]) << "\"/>" << endl;
+    out << "</Collection>" << endl;
+    out << "</VTKFile>" << endl;
+  }
+
+  template <int D> 
+  void VTKOutput<D>::Do (LocalHeap & lh, VorB vb, const BitArray * drawelems, double time)
+  {
+    static Timer t("VTKOutput::Do"); RegionTimer reg(t);
+
+    ostringstream filenamefinal;
+    filenamefinal << filename;
+    if (output_cnt > 0)
+      filenamefinal << "_" << output_cnt;
+    string basename = filenamefinal.str();
+
+    cout << IM(4) << " Writing VTK-Output";
+    if (output_cnt > 0)
+      cout << IM(4) << " ( " << output_cnt << " )";
+    cout << IM(4) << ":" << flush;
+    
+    if (time < 0) time = output_cnt;
+    output_cnt++;
+
+    FillData (lh, vb, drawelems);
+
+    if (!vtu)
       {
-        INT<ELEMENT_MAXPOINTS+1> new_elem = elem;
-        for (int i = 1; i <= new_elem[0]; ++i)
-          new_elem[i] += offset;
-        cells.Append(new_elem);
+        fileout = make_shared<ofstream>(basename+".vtk");
+        // header:
+        *fileout << "# vtk DataFile Version 3.0" << endl;
+        *fileout << "vtk output" << endl;
+        *fileout << "ASCII" << endl;
+        *fileout << "DATASET UNSTRUCTURED_GRID" << endl;
+
+        PrintPoints();
+        PrintCells();
+        PrintCellTypes(vb,drawelems);
+        PrintFieldData();
+        fileout = nullptr;
       }
+    else
+      {
+        NgMPI_Comm comm = ma->GetCommunicator();
+        string piecefile = basename+".vtu";
+        string masterfile = basename+".vtu";
+        ostringstream pvtu, pvd;
+        if (comm.Size() > 1)
+          {
+            // every rank writes its piece, the master file references all of them
+            piecefile = basename+"_p"+ToString(comm.Rank())+".vtu";
+            masterfile = basename+".pvtu";
+            if (comm.Rank() == 0)
+              WritePVTU (pvtu, basename, comm.Size());
+          }
 
-    }
+        times.Append(time);
+        timefiles.Append(masterfile);
+        if (comm.Rank() == 0)
+          WritePVD(pvd);
 
-    PrintPoints();
-    PrintCells();
-    PrintCellTypes(vb,drawelems);
-    PrintFieldData();
+        // index files are tiny, they are formatted here and written after the piece
+        auto WriteIndexFiles = [this, masterfile, pvtustr = pvtu.str(), pvdstr = pvd.str()] ()
+          {
+            if (pvtustr.size())
+              {
+                ofstream out(masterfile);
+                out << pvtustr;
+              }
+            if (pvdstr.size())
+              {
+                ofstream out(filename+".pvd");
+                out << pvdstr;
+              }
+          };
+
+        auto data = TakeData();
+        if (asynchronous)
+          BackgroundWriter::Get().Push
+            ([this, data, piecefile, WriteIndexFiles] ()
+             {
+               WriteVTU (piecefile, *data, false);
+               WriteIndexFiles();
+             });
+        else
+          {
+            static Timer tw("VTKOutput::WriteVTU"); RegionTimer regw(tw);
+            WriteVTU (piecefile, *data, true);
+            WriteIndexFiles();
+          }
+      }
       
     cout << IM(4) << " Done." << endl;
   }    
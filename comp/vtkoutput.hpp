@@ -6,9 +6,46 @@
 /* Date:   1. June 2014                                              */
 /*********************************************************************/
 
+#include <condition_variable>
+#include <deque>
+
 namespace ngcomp
 { 
 
+  /*
+    Runs output jobs in order on a dedicated thread, such that
+    encoding and file I/O overlap with the computation. Push blocks
+    while maxjobs jobs are pending, which bounds the memory held by
+    snapshots. An exception thrown by a job is rethrown by the next
+    Push or Wait.
+   */
+  class NGS_DLL_HEADER BackgroundWriter
+  {
+    size_t maxjobs;
+    std::deque<std::function<void()>> jobs;
+    bool busy = false;
+    bool stop = false;
+    std::exception_ptr error;
+    std::mutex queue_mutex;
+    std::condition_variable cv;
+    std::thread worker;
+
+    void Run ();
+    void CheckError ();
+  public:
+    BackgroundWriter (size_t amaxjobs = 2) : maxjobs(max2(amaxjobs, size_t(1))) { ; }
+    ~BackgroundWriter ();
+
+    void SetMaxJobs (size_t amaxjobs);
+    void Push (std::function<void()> job);
+    /// blocks until all pending jobs are written
+    void Wait ();
+
+    /// shared writer used by VTKOutput and GridFunction::Save
+    static BackgroundWriter & Get ();
+  };
+
+
   class ValueField : public Array<double>
   {
     int dim = 1;
@@ -30,7 +67,8 @@ namespace ngcomp
   {
   public:
     virtual ~BaseVTKOutput() { ; }
-    virtual void Do (LocalHeap & lh, VorB vb = VOL, const BitArray * drawelems = 0) = 0;
+    virtual void Do (LocalHeap & lh, VorB vb = VOL, const BitArray * drawelems = 0,
+                     double time = -1) = 0;
   };
   
   template <int D> 
@@ -45,11 +83,29 @@ namespace ngcomp
     int subdivision;
     int only_element = -1;
 
+    bool vtu = false;              // XML .vtu and .pvd instead of ASCII .vtk
+    string floatsize = "double";   // "single" writes Float32 points and fields
+    string encoding = "raw";       // appended data of .vtu: "raw" or "base64"
+
+    bool asynchronous = false;     // encode and write .vtu files on the BackgroundWriter
+
+    /// evaluated data of one output, handed over to the writer
+    struct OutputData
+    {
+      Array<Vec<D>> points;
+      Array<INT<ELEMENT_MAXPOINTS+1>> cells;
+      Array<unsigned char> celltypes;
+      Array<ValueField> fields;
+    };
+
     Array<shared_ptr<ValueField>> value_field;
     Array<Vec<D>> points;
     Array<INT<ELEMENT_MAXPOINTS+1>> cells;
+    Array<unsigned char> celltypes;
 
     int output_cnt = 0;
+    Array<double> times;           // time series of the .pvd index
+    Array<string> timefiles;
     
     shared_ptr<ofstream> fileout;
     
@@ -59,8 +115,10 @@ namespace ngcomp
                const Flags &,shared_ptr<MeshAccess>);
 
     VTKOutput (shared_ptr<MeshAccess>, const Array<shared_ptr<CoefficientFunction>> &,
-               const Array<string> &, string, int, int);
-    virtual ~VTKOutput() { ; }
+               const Array<string> &, string, int, int,
+               bool avtu = false, string afloatsize = "double", string aencoding = "raw",
+               bool aasynchronous = false);
+    virtual ~VTKOutput();
     
     void ResetArrays();
     
@@ -75,7 +133,19 @@ namespace ngcomp
     void PrintCellTypes(VorB vb, const BitArray * drawelems=nullptr);
     void PrintFieldData();    
 
-    virtual void Do (LocalHeap & lh, VorB vb = VOL, const BitArray * drawelems = 0);
+    /// evaluate points, cells and fields of all drawn elements in parallel
+    void FillData (LocalHeap & lh, VorB vb, const BitArray * drawelems);
+    /// moves the evaluated arrays out of the output object
+    shared_ptr<OutputData> TakeData ();
+    /// XML unstructured grid with binary appended data
+    void WriteVTU (const string & filename, const OutputData & data, bool parallel) const;
+    /// parallel master file referencing the .vtu pieces of all ranks
+    void WritePVTU (ostream & out, const string & piecename, int npieces) const;
+    /// time series index of all outputs so far
+    void WritePVD (ostream & out) const;
+
+    virtual void Do (LocalHeap & lh, VorB vb = VOL, const BitArray * drawelems = 0,
+                     double time = -1);
   };
 
 
@@ -3,11 +3,15 @@
 #include<l2hofe_impl.hpp>
 #include<l2hofefo.hpp>
 #include<regex>
+#include <set>
+#include <sys/stat.h>
+#ifdef WIN32
+#include <direct.h>
+#include <process.h>
+#endif
 
 namespace ngfem
 {
-    atomic<unsigned> Code::id_counter{0};
-
     void Code::AddLinkFlag(string flag)
     {
         if(std::find(std::begin(link_flags), std::end(link_flags), flag) == std::end(link_flags))
@@ -16,67 +20,242 @@ namespace ngfem
 
     string Code::AddPointer(const void *p)
     {
-        string name = "compiled_code_pointer" + ToString(id_counter++); 
+        // the address is set after loading, and the name depends only on the
+        // position in the code, such that the library can be cached
+        string name = "compiled_code_pointer" + ToString(deriv) + (is_simd ? "_simd_" : "_")
+          + ToString(pointer_values.size());
         top += "extern \"C\" void* " + name + ";\n";
-        stringstream s_ptr;
 #ifdef WIN32
-        s_ptr << "0x";
+        pointer += "__declspec(dllexport) ";
 #endif
-        s_ptr << std::hex << p;
-        pointer += "void *" + name + " = reinterpret_cast<void*>(" + s_ptr.str() + ");\n";
+        pointer += "void *" + name + " = nullptr;\n";
+        pointer_values.push_back ( { name, p } );
         return name;
     }
 
+    static string compile_cache_directory = getenv("NGS_COMPILE_CACHE") ? getenv("NGS_COMPILE_CACHE") : "";
+
+    void SetCompileCacheDirectory (string dir)
+    {
+      compile_cache_directory = dir;
+    }
+
+    string GetCompileCacheDirectory ()
+    {
+      return compile_cache_directory;
+    }
+
+    // 64 bit FNV-1a, stable between runs
+    static uint64_t HashCode (const string & s)
+    {
+      uint64_t hash = 14695981039346656037ull;
+      for (unsigned char c : s)
+        {
+          hash ^= c;
+          hash *= 1099511628211ull;
+        }
+      return hash;
+    }
+
+    static string ReadFile (const string & filename)
+    {
+      ifstream in(filename, ios::binary);
+      if (!in) return "";
+      stringstream ss;
+      ss << in.rdbuf();
+      return ss.str();
+    }
+
+    // contents of an executable script found in the PATH
+    static string ReadFromPath (const string & name)
+    {
+      const char * path = getenv("PATH");
+      if (!path) return "";
+#ifdef WIN32
+      char separator = ';';
+#else
+      char separator = ':';
+#endif
+      stringstream dirs(path);
+      string dir;
+      while (getline(dirs, dir, separator))
+        if (dir.size() && ifstream(dir+"/"+name).good())
+          return ReadFile(dir+"/"+name);
+      return "";
+    }
+
+    static string AbsolutePath (const string & path)
+    {
+#ifdef WIN32
+      return path;
+#else
+      if (path.size() && path[0] == '/') return path;
+      char *temp = getcwd(nullptr, 0);
+      string cwd(temp);
+      free(temp);
+      return cwd+"/"+path;
+#endif
+    }
+
     unique_ptr<SharedLibrary> CompileCode(const std::vector<string> &codes, const std::vector<string> &link_flags )
     {
-      static int counter = 0;
+      static atomic<int> counter{0};
       static ngstd::Timer tcompile("CompiledCF::Compile");
       static ngstd::Timer tlink("CompiledCF::Link");
+      static std::set<string> loaded_libs;
+      static mutex loaded_libs_mutex;
+#ifdef WIN32
+      string lib_ext = ".dll";
+      string compiler = "ngscxx.bat";
+      string linker = "ngsld.bat";
+      string compiler_script = compiler;
+      string linker_script = linker;
+      int pid = _getpid();
+#else
+      string lib_ext = ".so";
+      string compiler = "ngscxx -c";
+      string linker = "ngsld -shared";
+      string compiler_script = "ngscxx";
+      string linker_script = "ngsld";
+      int pid = getpid();
+#endif
+      
+      // file names must be unique if several processes share the cache directory
+      string cache_dir = GetCompileCacheDirectory();
+      string prefix = cache_dir.size() ?
+        cache_dir + "/code" + ToString(pid) + "_" + ToString(counter++) :
+        "code" + ToString(counter++);
+
+      // the dynamic loader maps a file only once per process, but every
+      // compiled function needs its own pointer variables
+      auto load = [&] (string lib_name)
+        {
+          bool first;
+          {
+            lock_guard<mutex> guard(loaded_libs_mutex);
+            first = loaded_libs.insert(lib_name).second;
+          }
+          auto library = make_unique<SharedLibrary>();
+          if (first)
+            {
+              library->Load(lib_name);
+              return library;
+            }
+          string copy_name = AbsolutePath(prefix+"_copy"+lib_ext);
+          {
+            ifstream in(lib_name, ios::binary);
+            ofstream out(copy_name, ios::binary);
+            out << in.rdbuf();
+          }
+          library->Load(copy_name);
+#ifdef WIN32
+          library->RemoveFileOnUnload();
+#else
+          std::remove (copy_name.c_str());
+#endif
+          return library;
+        };
+      
+      // the library is determined by the code, flags and the NGSolve version,
+      // compiler flags, defines and include paths are set in the wrapper scripts
+      string key, cached_lib, cached_key;
+      if (cache_dir.size())
+        {
+          key = "NGSolve " + ngsolve_version + "\n" + compiler + "\n" + linker + "\n";
+          key += ReadFromPath(compiler_script) + ReadFromPath(linker_script);
+          for (auto & flag : link_flags)
+            key += flag + "\n";
+          for (auto & code : codes)
+            key += "// ---- code unit ----\n" + code;
+
+          stringstream hash;
+          hash << std::hex << std::setw(16) << std::setfill('0') << HashCode(key);
+          cached_lib = AbsolutePath(cache_dir + "/ngscode_" + hash.str() + lib_ext);
+          cached_key = cache_dir + "/ngscode_" + hash.str() + ".key";
+
+          if (ifstream(cached_lib).good() && ReadFile(cached_key) == key)
+            {
+              cout << IM(3) << "using cached library " << cached_lib << endl;
+              return load(cached_lib);
+            }
+#ifdef WIN32
+          _mkdir (cache_dir.c_str());
+#else
+          mkdir (cache_dir.c_str(), 0755);
+#endif
+        }
+
+      // compile all code units in parallel
       string object_files;
-      int i = 0;
-      string prefix = "code" + ToString(counter++);
-      for(string code : codes) {
-        string file_prefix = prefix+"_"+ToString(i++);
-        ofstream codefile(file_prefix+".cpp");
-        codefile << code;
-        codefile.close();
-        cout << IM(3) << "compiling..." << endl;
-        tcompile.Start();
+      std::vector<string> commands;
+      for (int i : Range(codes.size()))
+        {
+          string file_prefix = prefix+"_"+ToString(i);
+          ofstream codefile(file_prefix+".cpp");
+          codefile << codes[i];
+          codefile.close();
 #ifdef WIN32
-        string scompile = "cmd /C \"ngscxx.bat " + file_prefix + ".cpp\"";
-        object_files += file_prefix+".obj ";
+          commands.push_back ("cmd /C \"" + compiler + " " + file_prefix + ".cpp\"");
+          object_files += file_prefix+".obj ";
 #else
-        string scompile = "ngscxx -c " + file_prefix + ".cpp -o " + file_prefix + ".o";
-        object_files += file_prefix+".o ";
+          commands.push_back (compiler + " " + file_prefix + ".cpp -o " + file_prefix + ".o");
+          object_files += file_prefix+".o ";
 #endif
-        int err = system(scompile.c_str());
+        }
+
+      cout << IM(3) << "compiling..." << endl;
+      tcompile.Start();
+      std::vector<int> errors(commands.size(), 0);
+      std::vector<std::thread> threads;
+      for (int i : Range(commands.size()))
+        threads.emplace_back ([&commands, &errors, i] ()
+                              { errors[i] = system(commands[i].c_str()); });
+      for (auto & t : threads)
+        t.join();
+      tcompile.Stop();
+      for (int err : errors)
         if (err) throw Exception ("problem calling compiler");
-        tcompile.Stop();
-      }
 
       cout << IM(3) << "linking..." << endl;
       tlink.Start();
 #ifdef WIN32
-        string slink = "cmd /C \"ngsld.bat /OUT:" + prefix+".dll " + object_files + "\"";
+      string slink = "cmd /C \"" + linker + " /OUT:" + prefix+lib_ext + " " + object_files + "\"";
 #else
-        string slink = "ngsld -shared " + object_files + " -o " + prefix + ".so -lngstd -lngbla -lngfem -lngcore";
-        for (auto flag : link_flags)
-            slink += " "+flag;
+      string slink = linker + " " + object_files + " -o " + prefix + lib_ext + " -lngstd -lngbla -lngfem -lngcore";
+      for (auto flag : link_flags)
+        slink += " "+flag;
 #endif
       int err = system(slink.c_str());
       if (err) throw Exception ("problem calling linker");      
       tlink.Stop();
       cout << IM(3) << "done" << endl;
-      auto library = make_unique<SharedLibrary>();
+
+      string lib_name = AbsolutePath(prefix+lib_ext);
+      if (cache_dir.size())
+        {
+          // rename is atomic, concurrent processes see either no or the complete file
+          ofstream keyfile(prefix+".key", ios::binary);
+          keyfile << key;
+          keyfile.close();
+          if (std::rename (lib_name.c_str(), cached_lib.c_str()) == 0)
+            {
+              lib_name = cached_lib;
+              std::rename ((prefix+".key").c_str(), cached_key.c_str());
+            }
+          else
+            std::remove ((prefix+".key").c_str());
+          for (int i : Range(codes.size()))
+            {
+              std::remove ((prefix+"_"+ToString(i)+".cpp").c_str());
 #ifdef WIN32
-      library->Load(prefix+".dll");
+              std::remove ((prefix+"_"+ToString(i)+".obj").c_str());
 #else
-      char *temp = getcwd(nullptr, 0);
-      string cwd(temp);
-      free(temp);
-      library->Load(cwd+"/"+prefix+".so");
+              std::remove ((prefix+"_"+ToString(i)+".o").c_str());
 #endif
-      return library;
+            }
+        }
+      
+      return load(lib_name);
     }
 
     namespace detail {
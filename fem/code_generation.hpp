@@ -43,17 +43,18 @@ namespace ngfem
     string body;
 
     string res_type;
-    bool is_simd;
-    int deriv;
+    bool is_simd = false;
+    int deriv = 0;
     std::vector<string> link_flags;
 
     string pointer;
+    // values of the pointer variables, set after loading the library
+    std::vector<std::pair<string, const void*>> pointer_values;
 
     string AddPointer(const void *p );
 
     void AddLinkFlag(string flag);
 
-    static atomic<unsigned> id_counter;
     static string Map( string code, std::map<string,string> variables ) {
       for ( auto mapping : variables ) {
         string oldStr = '{'+mapping.first+'}';
@@ -69,6 +70,76 @@ namespace ngfem
     }
   };
 
+  // register code for the in-process evaluation of compiled
+  // CoefficientFunctions: every component of every step is a register
+  struct Bytecode
+  {
+    enum OPCODE { CONSTANT, PARAMETER, COORDINATE, COPY, ADD, SUB, MUL, DIV, SCALE,
+                  UNARY, BINARY, LOAD, STORE, STEP };
+
+    struct Instruction
+    {
+      OPCODE op = STEP;
+      int dest = 0, src1 = 0, src2 = 0;
+      double val = 0;
+      const void * ptr = nullptr;   // parameter value, or operator object
+      SIMD<double> (*unary)(const void*, SIMD<double>) = nullptr;
+      SIMD<double> (*binary)(const void*, SIMD<double>, SIMD<double>) = nullptr;
+      Instruction () = default;
+      Instruction (OPCODE aop, int adest, int asrc1 = 0, int asrc2 = 0)
+        : op(aop), dest(adest), src1(asrc1), src2(asrc2) { ; }
+    };
+
+    Array<Instruction> instructions;
+    Array<int> first_reg;  // first register of every step
+
+    int Reg (int step, int comp = 0) const { return first_reg[step]+comp; }
+
+    void Add (Instruction instr) { instructions.Append (instr); }
+
+    void Constant (int dest, double val)
+    {
+      Instruction instr(CONSTANT, dest);
+      instr.val = val;
+      Add (instr);
+    }
+
+    // value is read at evaluation time
+    void Parameter (int dest, const double * pval)
+    {
+      Instruction instr(PARAMETER, dest);
+      instr.ptr = pval;
+      Add (instr);
+    }
+
+    void Scale (int dest, double scal, int src)
+    {
+      Instruction instr(SCALE, dest, src);
+      instr.val = scal;
+      Add (instr);
+    }
+
+    template <typename OP>
+    void Unary (int dest, const OP & op, int src)
+    {
+      Instruction instr(UNARY, dest, src);
+      instr.ptr = &op;
+      instr.unary = [] (const void * op, SIMD<double> x) -> SIMD<double>
+        { return (*static_cast<const OP*>(op)) (x); };
+      Add (instr);
+    }
+
+    template <typename OP>
+    void Binary (int dest, const OP & op, int src1, int src2)
+    {
+      Instruction instr(BINARY, dest, src1, src2);
+      instr.ptr = &op;
+      instr.binary = [] (const void * op, SIMD<double> x, SIMD<double> y) -> SIMD<double>
+        { return (*static_cast<const OP*>(op)) (x, y); };
+      Add (instr);
+    }
+  };
+
   struct CodeExpr
   {
     string code;
@@ -178,6 +249,12 @@ namespace ngfem
   }
 
   unique_ptr<SharedLibrary> CompileCode(const std::vector<string> &codes, const std::vector<string> &libraries );
+
+  // libraries are cached in this directory, and re-used if code, flags and
+  // NGSolve version are identical. Empty string disables the cache.
+  // Initialized from the environment variable NGS_COMPILE_CACHE
+  NGS_DLL_HEADER void SetCompileCacheDirectory (string dir);
+  NGS_DLL_HEADER string GetCompileCacheDirectory ();
   namespace detail {
       string GenerateL2ElementCode(int order);
   }
@@ -115,6 +115,77 @@ namespace ngfem
     throw Exception(string("Diff not implemented for CF ")+typeid(*this).name());
   }
 
+  // derivatives built during one top-level Differentiate call
+  struct DiffCache
+  {
+    typedef std::tuple<const CoefficientFunction*, const CoefficientFunction*,
+                       const CoefficientFunction*> TKey;
+    std::map<TKey, shared_ptr<CoefficientFunction>> derivs;
+    std::map<TKey, bool> depends;
+    // nodes and directions created during differentiation must not be
+    // freed while their addresses are keys
+    Array<shared_ptr<CoefficientFunction>> keep_alive;
+  };
+  static thread_local DiffCache * diff_cache = nullptr;
+
+  // does the derivative of cf (possibly) not vanish ? Leaves are
+  // differentiated, they may depend on var implicitly (shape, gridfunction)
+  static bool DependsOn (const CoefficientFunction * cf,
+                         const CoefficientFunction * var,
+                         shared_ptr<CoefficientFunction> dir)
+  {
+    if (cf == var) return true;
+    DiffCache::TKey key { cf, var, dir.get() };
+    auto pos = diff_cache->depends.find(key);
+    if (pos != diff_cache->depends.end())
+      return pos->second;
+
+    auto inputs = cf->InputCoefficientFunctions();
+    bool dep = false;
+    if (inputs.Size() == 0)
+      dep = cf->Differentiate(var, dir)->GetDescription() != "ZeroCF";
+    else
+      for (auto & in : inputs)
+        if (in && DependsOn (in.get(), var, dir))
+          {
+            dep = true;
+            break;
+          }
+    diff_cache->depends[key] = dep;
+    return dep;
+  }
+  
+  shared_ptr<CoefficientFunction> CoefficientFunction ::
+  Differentiate (const CoefficientFunction * var, shared_ptr<CoefficientFunction> dir) const
+  {
+    unique_ptr<DiffCache> own_cache;
+    if (!diff_cache)
+      {
+        own_cache = make_unique<DiffCache>();
+        diff_cache = own_cache.get();
+      }
+    struct ResetCache
+    {
+      bool own;
+      ~ResetCache () { if (own) diff_cache = nullptr; }
+    } reset { own_cache != nullptr };
+
+    DiffCache::TKey key { this, var, dir.get() };
+    auto pos = diff_cache->derivs.find(key);
+    if (pos != diff_cache->derivs.end())
+      return pos->second;
+
+    shared_ptr<CoefficientFunction> deriv;
+    if (this != var && InputCoefficientFunctions().Size() && !DependsOn(this, var, dir))
+      deriv = ZeroCF(Dimensions());
+    else
+      deriv = Diff(var, dir);
+    diff_cache->derivs[key] = deriv;
+    diff_cache->keep_alive.Append (const_cast<CoefficientFunction*>(this)->shared_from_this());
+    diff_cache->keep_alive.Append (dir);
+    return deriv;
+  }
+
   shared_ptr<CoefficientFunction> CoefficientFunction ::
   Operator (const string & name) const
   {
@@ -290,6 +361,12 @@ namespace ngfem
     code.body += Var(index).Declare(code.res_type);
     code.body += Var(index).Assign(Var(val), false);
   }
+
+  bool ConstantCoefficientFunction :: GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const
+  {
+    code.Constant (code.Reg(index), val);
+    return true;
+  }
   
   ///
   ConstantCoefficientFunctionC ::   
@@ -423,6 +500,18 @@ namespace ngfem
     code.body += Var(index).Assign(s.str(), false);
   }
 
+  template<typename SCAL>
+  bool ParameterCoefficientFunction<SCAL> :: GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const
+  {
+    if constexpr(is_same_v<SCAL, Complex>)
+      return false;
+    else
+      {
+        code.Parameter (code.Reg(index), &val);
+        return true;
+      }
+  }
+
   template class ParameterCoefficientFunction<double>;
   template class ParameterCoefficientFunction<Complex>;
 
@@ -1074,6 +1163,7 @@ public:
     return "ZeroCF";
   }
 
+  virtual bool DependsOnElement() const override { return false; }
 
   virtual void TraverseTree (const function<void(CoefficientFunction&)> & func) override
   {
@@ -1082,10 +1172,16 @@ public:
 
   virtual void GenerateCode(Code &code, FlatArray<int> inputs, int index) const override
   {
-    FlatArray<int> hdims = Dimensions();        
-    for (int i : Range(hdims[0]))
-      for (int j : Range(hdims[1]))
+    TraverseDimensions( Dimensions(), [&](int ind, int i, int j) {
         code.body += Var(index,i,j).Assign(string("0.0"));
+      });
+  }
+
+  virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override
+  {
+    for (int k = 0; k < Dimension(); k++)
+      code.Constant (code.Reg(index,k), 0.0);
+    return true;
   }
 
   using T_CoefficientFunction<ZeroCoefficientFunction>::Evaluate;
@@ -1183,6 +1279,13 @@ public:
     });
   }
 
+  virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override
+  {
+    for (int k = 0; k < Dimension(); k++)
+      code.Scale (code.Reg(index,k), scal, code.Reg(inputs[0],k));
+    return true;
+  }
+
   virtual void TraverseTree (const function<void(CoefficientFunction&)> & func) override
   {
     c1->TraverseTree (func);
@@ -1277,7 +1380,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return scal * c1->Diff(var, dir);
+    return scal * c1->Differentiate(var, dir);
   }
   
 };
@@ -1374,7 +1477,7 @@ public:
                                         shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return scal * c1->Diff(var, dir);
+    return scal * c1->Differentiate(var, dir);
   }
   
 };
@@ -1489,7 +1592,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return c1->Diff(var,dir)*c2 + c1 * c2->Diff(var,dir);
+    return c1->Differentiate(var,dir)*c2 + c1 * c2->Differentiate(var,dir);
   }
   
   /*
@@ -1838,8 +1941,8 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return InnerProduct(c1->Diff(var,dir),c2) + InnerProduct(c1,c2->Diff(var,dir));
-    // return c1->Diff(var,dir)*c2 + c1 * c2->Diff(var,dir);
+    return InnerProduct(c1->Differentiate(var,dir),c2) + InnerProduct(c1,c2->Differentiate(var,dir));
+    // return c1->Differentiate(var,dir)*c2 + c1 * c2->Differentiate(var,dir);
   }
   
 
@@ -2021,7 +2124,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return 2*InnerProduct(c1->Diff(var,dir),c1);
+    return 2*InnerProduct(c1->Differentiate(var,dir),c1);
   }
 
   virtual void NonZeroPattern (const class ProxyUserData & ud,
@@ -2253,7 +2356,7 @@ public:
                                         shared_ptr<CoefficientFunction> dir) const override
   {
     if (var == this) return dir;
-    return make_shared<ConstantCoefficientFunction>(1.0)/NormCF(c1) * InnerProduct(c1,c1->Diff(var,dir));
+    return make_shared<ConstantCoefficientFunction>(1.0)/NormCF(c1) * InnerProduct(c1,c1->Differentiate(var,dir));
   }
 
 };
@@ -2609,7 +2712,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (var == this) return dir;
-    return c1->Diff(var,dir)*c2 + c1 * c2->Diff(var,dir);
+    return c1->Differentiate(var,dir)*c2 + c1 * c2->Differentiate(var,dir);
   }
   
 };
@@ -2809,7 +2912,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return c1->Diff(var,dir)*c2 + c1 * c2->Diff(var,dir);
+    return c1->Differentiate(var,dir)*c2 + c1 * c2->Differentiate(var,dir);
   }
   
   
@@ -2946,7 +3049,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return CrossProduct(c1->Diff(var,dir),c2) + CrossProduct(c1, c2->Diff(var,dir));
+    return CrossProduct(c1->Differentiate(var,dir),c2) + CrossProduct(c1, c2->Differentiate(var,dir));
   }
   
   
@@ -2974,6 +3077,8 @@ public:
     func(*this);
   }
 
+  virtual bool DependsOnElement() const override { return false; }
+
   virtual void GenerateCode(Code &code, FlatArray<int> inputs, int index) const override
   {
     FlatArray<int> hdims = Dimensions();        
@@ -2987,6 +3092,15 @@ public:
         }
   }
 
+  virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override
+  {
+    int hd = Dimensions()[0];
+    for (int i : Range(hd))
+      for (int j : Range(hd))
+        code.Constant (code.Reg(index,i*hd+j), (i == j) ? 1.0 : 0.0);
+    return true;
+  }
+
   
   virtual void NonZeroPattern (const class ProxyUserData & ud,
                                FlatVector<AutoDiffDiff<1,bool>> values) const override
@@ -3215,7 +3329,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return TransposeCF (c1->Diff(var, dir));
+    return TransposeCF (c1->Differentiate(var, dir));
   }  
 };
 
@@ -3359,7 +3473,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return (-1)*InverseCF(c1) * c1->Diff(var,dir) * InverseCF(c1);
+    return (-1)*InverseCF(c1) * c1->Differentiate(var,dir) * InverseCF(c1);
   }  
 };
 
@@ -3514,7 +3628,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return DeterminantCF(c1) * InnerProduct( TransposeCF(InverseCF(c1)), c1->Diff(var,dir) );
+    return DeterminantCF(c1) * InnerProduct( TransposeCF(InverseCF(c1)), c1->Differentiate(var,dir) );
   }  
 };
 
@@ -3666,15 +3780,15 @@ public:
     if (this->Dimensions()[0] <= 2)
       {
         //Cofactor Matrix linear in 2d (in 1d Cofactor Matrix = 0)
-        return CofactorCF(c1->Diff(var,dir));
+        return CofactorCF(c1->Differentiate(var,dir));
       }
     else //3d
       {
         //formula follows from Cayley–Hamilton
         //Cof(A) = 0.5*(tr(A)**2 - tr(A**2))I - tr(A)A^T +(AA)^T
 
-        //return (0.5*(TraceCF(c1)*TraceCF(c1) - TraceCF(c1*c1))*IdentityCF(3) - TraceCF(c1)*TransposeCF(c1) + TransposeCF(c1*c1))->Diff(var,dir);
-        return  0.5*(2*TraceCF(c1)*TraceCF(c1->Diff(var,dir)) - TraceCF(c1->Diff(var,dir)*c1 + c1 * c1->Diff(var,dir)))*IdentityCF(3)- TraceCF(c1->Diff(var,dir))*TransposeCF(c1) - TraceCF(c1)*TransposeCF(c1->Diff(var,dir)) + TransposeCF(c1->Diff(var,dir)*c1 + c1 * c1->Diff(var,dir));
+        //return (0.5*(TraceCF(c1)*TraceCF(c1) - TraceCF(c1*c1))*IdentityCF(3) - TraceCF(c1)*TransposeCF(c1) + TransposeCF(c1*c1))->Differentiate(var,dir);
+        return  0.5*(2*TraceCF(c1)*TraceCF(c1->Differentiate(var,dir)) - TraceCF(c1->Differentiate(var,dir)*c1 + c1 * c1->Differentiate(var,dir)))*IdentityCF(3)- TraceCF(c1->Differentiate(var,dir))*TransposeCF(c1) - TraceCF(c1)*TransposeCF(c1->Differentiate(var,dir)) + TransposeCF(c1->Differentiate(var,dir)*c1 + c1 * c1->Differentiate(var,dir));
       }
   }  
 };
@@ -3822,7 +3936,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return SymmetricCF(c1->Diff(var, dir));
+    return SymmetricCF(c1->Differentiate(var, dir));
   }
 };
 
@@ -3960,7 +4074,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return SkewCF(c1->Diff(var, dir));
+    return SkewCF(c1->Differentiate(var, dir));
   }
 };
 
@@ -4103,7 +4217,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return TraceCF(c1->Diff(var, dir));
+    return TraceCF(c1->Differentiate(var, dir));
   }
 };
 
@@ -4142,7 +4256,7 @@ cl_BinaryOpCF<GenericPlus>::Diff(const CoefficientFunction * var,
                                    shared_ptr<CoefficientFunction> dir) const
 {
   if (var == this) return dir;
-  return c1->Diff(var,dir) + c2->Diff(var,dir);
+  return c1->Differentiate(var,dir) + c2->Differentiate(var,dir);
 }
 
 shared_ptr<CoefficientFunction> operator+ (shared_ptr<CoefficientFunction> c1, shared_ptr<CoefficientFunction> c2)
@@ -4167,7 +4281,7 @@ cl_BinaryOpCF<GenericMinus>::Diff(const CoefficientFunction * var,
                                     shared_ptr<CoefficientFunction> dir) const
 {
   if (var == this) return dir;      
-  return c1->Diff(var,dir) - c2->Diff(var,dir);
+  return c1->Differentiate(var,dir) - c2->Differentiate(var,dir);
 }
 
 shared_ptr<CoefficientFunction> operator- (shared_ptr<CoefficientFunction> c1, shared_ptr<CoefficientFunction> c2)
@@ -4191,7 +4305,7 @@ cl_BinaryOpCF<GenericMult>::Diff(const CoefficientFunction * var,
                                    shared_ptr<CoefficientFunction> dir) const
 {
   if (var == this) return dir;    
-  return c1->Diff(var,dir)*c2 + c1*c2->Diff(var,dir);
+  return c1->Differentiate(var,dir)*c2 + c1*c2->Differentiate(var,dir);
 }
 
 template <> 
@@ -4200,7 +4314,7 @@ cl_BinaryOpCF<GenericDiv>::Diff(const CoefficientFunction * var,
                                    shared_ptr<CoefficientFunction> dir) const
 {
   if (var == this) return dir;
-  return (c1->Diff(var,dir)*c2 - c1*c2->Diff(var,dir)) / (c2*c2);
+  return (c1->Differentiate(var,dir)*c2 - c1*c2->Differentiate(var,dir)) / (c2*c2);
 }
 
 
@@ -4287,7 +4401,7 @@ shared_ptr<CoefficientFunction> operator* (shared_ptr<CoefficientFunction> c1, s
   {
     if (var == this) return dir;
     cout << "Warning: differentiate conjugate by taking conjugate of derivative" << endl;
-    return ConjCF(c1->Diff(var, dir));
+    return ConjCF(c1->Differentiate(var, dir));
   }
 
 
@@ -4531,6 +4645,12 @@ public:
     code.body += Var(index).Assign( Var(inputs[0], i, j ));
   }
 
+  virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override
+  {
+    code.Add (Bytecode::Instruction(Bytecode::COPY, code.Reg(index), code.Reg(inputs[0],comp)));
+    return true;
+  }
+
   virtual void TraverseTree (const function<void(CoefficientFunction&)> & func) override
   {
     c1->TraverseTree (func);
@@ -4603,7 +4723,7 @@ public:
                                           shared_ptr<CoefficientFunction> dir) const override
   {
     if (this == var) return dir;
-    return MakeComponentCoefficientFunction (c1->Diff(var, dir), comp);
+    return MakeComponentCoefficientFunction (c1->Differentiate(var, dir), comp);
   }  
 
   /*
@@ -4683,6 +4803,9 @@ public:
     return (matindex < ci.Size() && ci[matindex]);
   }
 
+  // selects the input by the material of the element
+  bool DependsOnElement() const override { return true; }
+
   /*
   bool ElementwiseConstant() const override
   {
@@ -4743,7 +4866,7 @@ public:
     Array<shared_ptr<CoefficientFunction>> ci_deriv;
     for (auto & cf : ci)
       if (cf)
-        ci_deriv.Append (cf->Diff(var, dir));
+        ci_deriv.Append (cf->Differentiate(var, dir));
       else
         ci_deriv.Append (nullptr);
     return MakeDomainWiseCoefficientFunction(move (ci_deriv));
@@ -5437,7 +5560,7 @@ class IfPosCoefficientFunction : public T_CoefficientFunction<IfPosCoefficientFu
                                           shared_ptr<CoefficientFunction> dir) const override
     {
       if (this == var) return dir;
-      return IfPos (cf_if, cf_then->Diff(var, dir), cf_else->Diff(var, dir));
+      return IfPos (cf_if, cf_then->Differentiate(var, dir), cf_else->Differentiate(var, dir));
     }  
   };
   
@@ -5495,6 +5618,7 @@ public:
   { return "VectorialCoefficientFunction"; }
   
   virtual void GenerateCode(Code &code, FlatArray<int> inputs, int index) const override;
+  virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override;
 
   virtual void TraverseTree (const function<void(CoefficientFunction&)> & func) override
   {
@@ -5643,7 +5767,7 @@ public:
     Array<shared_ptr<CoefficientFunction>> diff_ci;
     for (auto & cf : ci)
       if (cf)
-        diff_ci.Append (cf->Diff(var, dir));
+        diff_ci.Append (cf->Differentiate(var, dir));
       else
         diff_ci.Append (nullptr);
     auto veccf = MakeVectorialCoefficientFunction (move(diff_ci));
@@ -5672,6 +5796,15 @@ public:
 
   }
 
+  bool VectorialCoefficientFunction::GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const
+  {
+    int k = 0;
+    for (int input : Range(ci))
+      for (int i : Range(ci[input]->Dimension()))
+        code.Add (Bytecode::Instruction(Bytecode::COPY, code.Reg(index,k++), code.Reg(inputs[input],i)));
+    return true;
+  }
+
 
   shared_ptr<CoefficientFunction>
   MakeVectorialCoefficientFunction (Array<shared_ptr<CoefficientFunction>> aci)
@@ -5713,6 +5846,8 @@ public:
       return string("coordinate ")+dirname;
     }
 
+    virtual bool DependsOnElement() const override { return false; }
+
     using BASE::Evaluate;
     virtual double Evaluate (const BaseMappedIntegrationPoint & ip) const override
     {
@@ -5747,6 +5882,12 @@ public:
         code.body += v.Assign(CodeExpr(string("points(i,")+ToLiteral(dir)+")"));
     }
 
+    virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override
+    {
+      code.Add (Bytecode::Instruction(Bytecode::COORDINATE, code.Reg(index), dir));
+      return true;
+    }
+
     template <typename MIR, typename T, ORDERING ORD>
     void T_Evaluate (const MIR & ir, BareSliceMatrix<T,ORD> values) const
     {
@@ -5915,6 +6056,12 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
     lib_function_complex compiled_function_complex = nullptr;
     lib_function_simd_complex compiled_function_simd_complex = nullptr;
 
+    // steps created by Optimize (folded constants, zeros)
+    Array<shared_ptr<CoefficientFunction>> own_steps;
+    // in-process tier, used for SIMD evaluation until the library is loaded
+    Bytecode bytecode;
+    Array<bool> step_in_memory;  // needs a value matrix (not only registers)
+
   public:
     CompiledCoefficientFunction() = default;
     CompiledCoefficientFunction (shared_ptr<CoefficientFunction> acf)
@@ -5957,6 +6104,399 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
          });
       cout << IM(3) << "inputs = " << endl << inputs << endl;
 
+      Optimize();
+      BuildBytecode();
+    }
+
+    /*
+      Optimization of the linearized steps:
+      - scalar steps with constant inputs are folded (EvaluateConst)
+      - steps without proxies which are zero by their NonZeroPattern
+        become zero constants
+      - products with one or identity, and sums with zero are bypassed
+      - structurally equal steps, i.e. steps generating the same code
+        for the same inputs, are merged
+      - steps not contributing to the result are removed
+     */
+    void Optimize ()
+    {
+      size_t n = steps.Size();
+      Array<int> repl(n);       // replacement step, repl[i] <= i
+      Array<bool> is_const(n), has_proxy(n);
+      Array<Array<int>> in(n);
+      std::map<string,int> known;
+      ProxyUserData ud;
+      int nfolded = 0, nmerged = 0;
+
+      auto const_value = [&] (int s, double val)
+        { return is_const[s] && steps[s]->EvaluateConst() == val; };
+      auto same_shape = [&] (int s1, int s2)
+        {
+          return is_complex[s1] == is_complex[s2] &&
+            steps[s1]->Dimensions() == steps[s2]->Dimensions();
+        };
+      
+      for (size_t i = 0; i < n; i++)
+        {
+          repl[i] = i;
+          is_const[i] = false;
+          has_proxy[i] = dynamic_cast<ProxyFunction*> (steps[i]) != nullptr;
+          for (int nr : inputs[i])
+            {
+              in[i].Append (repl[nr]);
+              has_proxy[i] = has_proxy[i] || has_proxy[repl[nr]];
+            }
+          auto & stepi = *steps[i];
+          
+          if (!is_complex[i])
+            {
+              bool folded = false;
+              if (dynamic_cast<ConstantCoefficientFunction*> (&stepi))
+                is_const[i] = true;
+              else if (dim[i] == 1 && in[i].Size())
+                {
+                  bool const_inputs = true;
+                  for (int nr : in[i])
+                    const_inputs = const_inputs && is_const[nr];
+                  if (const_inputs)
+                    try
+                      {
+                        own_steps.Append (make_shared<ConstantCoefficientFunction> (stepi.EvaluateConst()));
+                        folded = true;
+                      }
+                    catch (const Exception &) { ; }
+                }
+              if (!folded && !has_proxy[i] && stepi.GetDescription() != "ZeroCF" && !is_const[i])
+                {
+                  Vector<AutoDiffDiff<1,bool>> nz(dim[i]);
+                  stepi.NonZeroPattern (ud, nz);
+                  bool zero = true;
+                  for (auto v : nz)
+                    zero = zero && !v.Value();
+                  if (zero)
+                    {
+                      if (dim[i] == 1)
+                        own_steps.Append (make_shared<ConstantCoefficientFunction> (0.0));
+                      else
+                        own_steps.Append (ZeroCF (stepi.Dimensions()));
+                      folded = true;
+                    }
+                }
+              if (folded)
+                {
+                  steps[i] = own_steps.Last().get();
+                  in[i].SetSize0();
+                  is_const[i] = dim[i] == 1;
+                  nfolded++;
+                }
+            }
+
+          // bypass neutral operations
+          int bypass = -1;
+          string desc = steps[i]->GetDescription();
+          if (in[i].Size() == 2 && dim[i] == 1 && !is_complex[i])
+            {
+              int in0 = in[i][0], in1 = in[i][1];
+              if (desc == "binary operation '*'")
+                {
+                  if (const_value(in0, 1)) bypass = in1;
+                  else if (const_value(in1, 1)) bypass = in0;
+                }
+              if (desc == "binary operation '+'")
+                {
+                  if (const_value(in0, 0)) bypass = in1;
+                  else if (const_value(in1, 0)) bypass = in0;
+                }
+              if (desc == "binary operation '-'" && const_value(in1, 0)) bypass = in0;
+              if (desc == "binary operation '/'" && const_value(in1, 1)) bypass = in0;
+            }
+          if (in[i].Size() == 2 &&
+              (dynamic_cast<MultMatMatCoefficientFunction*> (steps[i]) ||
+               dynamic_cast<MultMatVecCoefficientFunction*> (steps[i])))
+            {
+              if (dynamic_cast<IdentityCoefficientFunction*> (steps[in[i][0]])) bypass = in[i][1];
+              else if (dynamic_cast<IdentityCoefficientFunction*> (steps[in[i][1]])) bypass = in[i][0];
+            }
+          if (bypass != -1 && same_shape(i, bypass))
+            {
+              repl[i] = bypass;
+              nfolded++;
+              continue;
+            }
+
+          // common subexpressions
+          try
+            {
+              Code code;
+              code.res_type = is_complex[i] ? "Complex" : "double";
+              steps[i]->GenerateCode (code, in[i], -1);
+              if (code.body.find("GenerateCode() not overloaded") != string::npos ||
+                  code.body.find("undefined(") != string::npos)
+                continue;
+              stringstream key;
+              key << typeid(*steps[i]).name() << " " << steps[i]->Dimensions() << " " << is_complex[i] << "\n"
+                  << code.top << code.header << code.body;
+              for (auto [name, ptr] : code.pointer_values)
+                key << ptr << " ";
+              auto pos = known.find(key.str());
+              if (pos == known.end())
+                known[key.str()] = i;
+              else
+                {
+                  repl[i] = pos->second;
+                  nmerged++;
+                }
+            }
+          catch (const Exception &) { ; }
+        }
+
+      // keep the steps needed for the result
+      Array<bool> needed(n);
+      needed = false;
+      needed[repl[n-1]] = true;
+      for (int i = n-1; i >= 0; i--)
+        if (needed[i])
+          for (int nr : in[i])
+            needed[nr] = true;
+
+      Array<int> newnr(n);
+      Array<CoefficientFunction*> newsteps;
+      Array<int> newdim;
+      Array<bool> newcomplex;
+      for (size_t i = 0; i < n; i++)
+        if (needed[i])
+          {
+            newnr[i] = newsteps.Size();
+            newsteps.Append (steps[i]);
+            newdim.Append (dim[i]);
+            newcomplex.Append (is_complex[i]);
+          }
+      
+      inputs = DynamicTable<int> (newsteps.Size());
+      max_inputsize = 0;
+      for (size_t i = 0; i < n; i++)
+        if (needed[i])
+          {
+            max_inputsize = max2(in[i].Size(), max_inputsize);
+            for (int nr : in[i])
+              inputs.Add (newnr[i], newnr[nr]);
+          }
+      cout << IM(3) << "CompiledCF optimization: " << n << " steps -> " << newsteps.Size()
+           << ", folded " << nfolded << ", merged " << nmerged << endl;
+      
+      steps = std::move(newsteps);
+      dim = std::move(newdim);
+      is_complex = std::move(newcomplex);
+      totdim = 0;
+      for (int d : dim) totdim += d;
+    }
+
+    /*
+      Steps providing bytecode are executed point by point in registers,
+      other steps are evaluated for the whole rule into value matrices.
+      Registers are loaded from / stored to the value matrices where
+      needed by a step or by another block of bytecode.
+     */
+    void BuildBytecode ()
+    {
+      bytecode = Bytecode();
+      step_in_memory.SetSize0();
+      if (is_complex.Contains(true)) return;
+
+      bytecode.first_reg.SetSize(steps.Size());
+      Array<int> step_of_reg(totdim);
+      for (int i = 0, reg = 0; i < steps.Size(); i++)
+        {
+          bytecode.first_reg[i] = reg;
+          for (int k = 0; k < dim[i]; k++)
+            step_of_reg[reg++] = i;
+        }
+
+      // block number of every register, -1 for values of evaluated steps
+      Array<int> block_of_reg(totdim);
+      Array<bool> in_memory(totdim);
+      in_memory = false;
+      int block = 0;
+      for (int i : Range(steps))
+        {
+          size_t first = bytecode.instructions.Size();
+          if (steps[i]->GenerateBytecode (bytecode, inputs[i], i))
+            {
+              for (int k = 0; k < dim[i]; k++)
+                block_of_reg[bytecode.Reg(i,k)] = block;
+              continue;
+            }
+          bytecode.instructions.SetSize(first);
+          for (int in : inputs[i])
+            for (int k = 0; k < dim[in]; k++)
+              in_memory[bytecode.Reg(in,k)] = true;
+          for (int k = 0; k < dim[i]; k++)
+            {
+              block_of_reg[bytecode.Reg(i,k)] = -1;
+              in_memory[bytecode.Reg(i,k)] = true;
+            }
+          bytecode.Add (Bytecode::Instruction(Bytecode::STEP, bytecode.Reg(i), i));
+          block++;
+        }
+      for (int k = 0; k < dim.Last(); k++)
+        in_memory[bytecode.Reg(steps.Size()-1,k)] = true;
+
+      auto uses = [] (const Bytecode::Instruction & instr) -> int
+        {
+          switch (instr.op)
+            {
+            case Bytecode::COPY: case Bytecode::SCALE: case Bytecode::UNARY: return 1;
+            case Bytecode::ADD: case Bytecode::SUB: case Bytecode::MUL: case Bytecode::DIV:
+            case Bytecode::BINARY: return 2;
+            default: return 0;
+            }
+        };
+      
+      // registers used across blocks go through memory
+      block = 0;
+      for (auto & instr : bytecode.instructions)
+        {
+          if (instr.op == Bytecode::STEP) { block++; continue; }
+          int nuse = uses(instr);
+          if (nuse >= 1 && block_of_reg[instr.src1] != block) in_memory[instr.src1] = true;
+          if (nuse >= 2 && block_of_reg[instr.src2] != block) in_memory[instr.src2] = true;
+        }
+
+      // insert loads at the beginning and stores at the end of every block
+      Array<Bytecode::Instruction> program;
+      Array<bool> loaded(totdim);
+      size_t pos = 0, n = bytecode.instructions.Size();
+      block = 0;
+      while (pos < n)
+        {
+          auto & first = bytecode.instructions[pos];
+          if (first.op == Bytecode::STEP)
+            {
+              program.Append (first);
+              pos++; block++;
+              continue;
+            }
+          size_t end = pos;
+          while (end < n && bytecode.instructions[end].op != Bytecode::STEP) end++;
+
+          loaded = false;
+          for (size_t j = pos; j < end; j++)
+            {
+              auto & instr = bytecode.instructions[j];
+              int nuse = uses(instr);
+              for (int src : { instr.src1, instr.src2 })
+                if (nuse-- > 0 && block_of_reg[src] != block && !loaded[src])
+                  {
+                    program.Append (Bytecode::Instruction(Bytecode::LOAD, src));
+                    loaded[src] = true;
+                  }
+            }
+          for (size_t j = pos; j < end; j++)
+            program.Append (bytecode.instructions[j]);
+          for (size_t j = pos; j < end; j++)
+            {
+              int dest = bytecode.instructions[j].dest;
+              if (in_memory[dest])
+                program.Append (Bytecode::Instruction(Bytecode::STORE, dest));
+            }
+          pos = end;
+        }
+      bytecode.instructions = std::move(program);
+
+      step_in_memory.SetSize(steps.Size());
+      step_in_memory = false;
+      for (int reg : Range(totdim))
+        if (in_memory[reg])
+          step_in_memory[step_of_reg[reg]] = true;
+    }
+
+    void EvaluateBytecode (const SIMD_BaseMappedIntegrationRule & ir,
+                           BareSliceMatrix<SIMD<double>> values) const
+    {
+      size_t np = ir.Size();
+      size_t mem_size = 0;
+      for (size_t i = 0; i+1 < steps.Size(); i++)
+        if (step_in_memory[i])
+          mem_size += np*dim[i];
+      ArrayMem<SIMD<double>, 1000> hmem(mem_size);
+      ArrayMem<BareSliceMatrix<SIMD<double>>,100> temp(steps.Size());
+      ArrayMem<BareSliceMatrix<SIMD<double>>, 100> in(max_inputsize);
+      ArrayMem<SIMD<double>*, 100> rows(totdim);
+      size_t mem_ptr = 0;
+      for (size_t i = 0; i < steps.Size(); i++)
+        {
+          if (i+1 == steps.Size())
+            new (&temp[i]) BareSliceMatrix<SIMD<double>> (values);
+          else if (step_in_memory[i])
+            {
+              new (&temp[i]) BareSliceMatrix<SIMD<double>> (FlatMatrix<SIMD<double>> (dim[i], np, &hmem[mem_ptr]));
+              mem_ptr += np*dim[i];
+            }
+          else
+            continue;
+          for (int k = 0; k < dim[i]; k++)
+            rows[bytecode.Reg(i,k)] = &temp[i](k,0);
+        }
+
+      ArrayMem<SIMD<double>, 100> reg(totdim);
+      auto points = ir.GetPoints();
+      int dimspace = ir.DimSpace();
+      auto code = bytecode.instructions.Data();
+      size_t pos = 0, n = bytecode.instructions.Size();
+      while (pos < n)
+        {
+          if (code[pos].op == Bytecode::STEP)
+            {
+              int i = code[pos].src1;
+              auto inputi = inputs[i];
+              for (int nr : Range(inputi))
+                new (&in[nr]) BareSliceMatrix<SIMD<double>> (temp[inputi[nr]]);
+              steps[i] -> Evaluate (ir, in.Range(0, inputi.Size()), temp[i]);
+              pos++;
+              continue;
+            }
+
+          size_t end = pos;
+          while (end < n && code[end].op != Bytecode::STEP) end++;
+          for (size_t p = 0; p < np; p++)
+            for (size_t j = pos; j < end; j++)
+              {
+                auto & instr = code[j];
+                SIMD<double> & dest = reg[instr.dest];
+                switch (instr.op)
+                  {
+                  case Bytecode::CONSTANT:
+                    dest = instr.val; break;
+                  case Bytecode::PARAMETER:
+                    dest = *static_cast<const double*>(instr.ptr); break;
+                  case Bytecode::COORDINATE:
+                    dest = (instr.src1 < dimspace) ? points(p, instr.src1) : SIMD<double>(0.0); break;
+                  case Bytecode::COPY:
+                    dest = reg[instr.src1]; break;
+                  case Bytecode::ADD:
+                    dest = reg[instr.src1] + reg[instr.src2]; break;
+                  case Bytecode::SUB:
+                    dest = reg[instr.src1] - reg[instr.src2]; break;
+                  case Bytecode::MUL:
+                    dest = reg[instr.src1] * reg[instr.src2]; break;
+                  case Bytecode::DIV:
+                    dest = reg[instr.src1] / reg[instr.src2]; break;
+                  case Bytecode::SCALE:
+                    dest = instr.val * reg[instr.src1]; break;
+                  case Bytecode::UNARY:
+                    dest = instr.unary(instr.ptr, reg[instr.src1]); break;
+                  case Bytecode::BINARY:
+                    dest = instr.binary(instr.ptr, reg[instr.src1], reg[instr.src2]); break;
+                  case Bytecode::LOAD:
+                    dest = rows[instr.dest][p]; break;
+                  case Bytecode::STORE:
+                    rows[instr.dest][p] = dest; break;
+                  case Bytecode::STEP:
+                    break;
+                  }
+              }
+          pos = end;
+        }
     }
 
 
@@ -6038,6 +6578,8 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
                      inputs.Add (mypos, steps.Pos(incf.get()));
                  }
              });
+          Optimize();
+          BuildBytecode();
         }
     }
 
@@ -6045,7 +6587,7 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
     virtual shared_ptr<CoefficientFunction>
     Diff (const CoefficientFunction * var, shared_ptr<CoefficientFunction> dir) const override
     {
-      auto diff_cf = cf->Diff(var, dir);
+      auto diff_cf = cf->Differentiate(var, dir);
       return Compile (diff_cf, false, 0, 0);
     }
 
@@ -6056,8 +6598,10 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
         std::vector<string> link_flags;
         if(cf->IsComplex())
             maxderiv = 0;
-        stringstream s;
+        // one code unit per derivative, compiled in parallel
+        std::vector<stringstream> s(maxderiv+1);
         string pointer_code;
+        std::vector<std::pair<string, const void*>> pointer_values;
         string top_code = ""
              "#include<fem.hpp>\n"
              "using namespace ngfem;\n"
@@ -6088,6 +6632,7 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
             }
 
             pointer_code += code.pointer;
+            pointer_values.insert (pointer_values.end(), code.pointer_values.begin(), code.pointer_values.end());
             top_code += code.top;
 
             // set results
@@ -6127,21 +6672,21 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
 
             // Function name
 #ifdef WIN32
-            s << "__declspec(dllexport) ";
+            s[deriv] << "__declspec(dllexport) ";
 #endif
-            s << "void CompiledEvaluate";
-            if(deriv==2) s << "D";
-            if(deriv>=1) s << "Deriv";
-            if(simd) s << "SIMD";
+            s[deriv] << "void CompiledEvaluate";
+            if(deriv==2) s[deriv] << "D";
+            if(deriv>=1) s[deriv] << "Deriv";
+            if(simd) s[deriv] << "SIMD";
 
             // Function parameters
             if (simd)
               {
-                s << "(SIMD_BaseMappedIntegrationRule & mir, BareSliceMatrix<" << res_type << "> results";
+                s[deriv] << "(SIMD_BaseMappedIntegrationRule & mir, BareSliceMatrix<" << res_type << "> results";
               }
             else
               {
-                s << "(BaseMappedIntegrationRule & mir, BareSliceMatrix<" << res_type << "> results";
+                s[deriv] << "(BaseMappedIntegrationRule & mir, BareSliceMatrix<" << res_type << "> results";
                 /*
                 string param_type = simd ? "BareSliceMatrix<SIMD<"+scal_type+">> " : "FlatMatrix<"+scal_type+"> ";
                 if (simd && deriv == 0) param_type = "BareSliceMatrix<SIMD<"+scal_type+">> ";
@@ -6150,24 +6695,23 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
                   s << ", " << param_type << parameters[i];
                 */
               }
-            s << " ) {" << endl;
-            s << code.header << endl;
-            s << "[[maybe_unused]] auto points = mir.GetPoints();" << endl;
-            s << "[[maybe_unused]] auto domain_index = mir.GetTransformation().GetElementIndex();" << endl;
-            s << "for ( auto i : Range(mir)) {" << endl;
-            s << "[[maybe_unused]] auto & ip = mir[i];" << endl;
-            s << code.body << endl;
-            s << "}\n}" << endl << endl;
+            s[deriv] << " ) {" << endl;
+            s[deriv] << code.header << endl;
+            s[deriv] << "[[maybe_unused]] auto points = mir.GetPoints();" << endl;
+            s[deriv] << "[[maybe_unused]] auto domain_index = mir.GetTransformation().GetElementIndex();" << endl;
+            s[deriv] << "for ( auto i : Range(mir)) {" << endl;
+            s[deriv] << "[[maybe_unused]] auto & ip = mir[i];" << endl;
+            s[deriv] << code.body << endl;
+            s[deriv] << "}\n}" << endl << endl;
 
             for(const auto &lib : code.link_flags)
                 if(std::find(std::begin(link_flags), std::end(link_flags), lib) == std::end(link_flags))
                     link_flags.push_back(lib);
 
         }
-        s << "}" << endl;
-        string file_code = top_code + s.str();
         std::vector<string> codes;
-        codes.push_back(file_code);
+        for (auto & sd : s)
+          codes.push_back(top_code + sd.str() + "}\n");
         if(pointer_code.size()) {
           pointer_code = "extern \"C\" {\n" + pointer_code;
           pointer_code += "}\n";
@@ -6175,8 +6719,10 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
         }
 
         auto self = dynamic_pointer_cast<CompiledCoefficientFunction>(shared_from_this());
-        auto compile_func = [self, codes, link_flags, maxderiv] () {
+        auto compile_func = [self, codes, link_flags, maxderiv, pointer_values] () {
               self->library = CompileCode( codes, link_flags );
+              for (auto [name, value] : pointer_values)
+                *self->library->GetFunction<void**>(name) = const_cast<void*>(value);
               if(self->cf->IsComplex())
               {
                   self->compiled_function_simd_complex = self->library->GetFunction<lib_function_simd_complex>("CompiledEvaluateSIMD");
@@ -6547,6 +7093,12 @@ class CompiledCoefficientFunction : public CoefficientFunction //, public std::e
         return;
       }
 
+      if (step_in_memory.Size())
+      {
+        EvaluateBytecode (ir, values);
+        return;
+      }
+
       T_Evaluate (ir, values);
       return;
 
@@ -44,6 +44,9 @@ namespace ngfem
 
     virtual void DoArchive(Archive& ar) { ar & dimension & dims & is_complex; }
     virtual void GenerateCode(Code &code, FlatArray<int> inputs, int index) const;
+    /// register code for the in-process evaluation, returns false if not supported
+    virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const
+    { return false; }
     ///
     virtual int NumRegions () { return INT_MAX; }
     virtual bool DefinedOn (const ElementTransformation & trafo) { return true; }
@@ -228,9 +231,16 @@ namespace ngfem
     virtual void PrintReportRec (ostream & ost, int level) const;
     virtual string GetDescription () const;
 
+    // derivative of this node, children are differentiated by Differentiate
     virtual shared_ptr<CoefficientFunction>
       Diff (const CoefficientFunction * var, shared_ptr<CoefficientFunction> dir) const;
 
+    // derivative of the tree: within one differentiation the derivative
+    // of a shared subtree is built once, subtrees not depending on var
+    // give ZeroCF
+    shared_ptr<CoefficientFunction>
+      Differentiate (const CoefficientFunction * var, shared_ptr<CoefficientFunction> dir) const;
+
     virtual shared_ptr<CoefficientFunction> Operator (const string & name) const;
     virtual shared_ptr<CoefficientFunction> Operator (shared_ptr<class DifferentialOperator> diffop) const;
     
@@ -238,6 +248,9 @@ namespace ngfem
     virtual Array<shared_ptr<CoefficientFunction>> InputCoefficientFunctions() const
     { return Array<shared_ptr<CoefficientFunction>>(); }
     virtual bool StoreUserData() const { return false; }
+    /// values depend on the element (number, material, geometry), not only on
+    /// the mapped point and the inputs. Leaves are assumed to, unless they say otherwise
+    virtual bool DependsOnElement() const { return InputCoefficientFunctions().Size() == 0; }
 
   };
 
@@ -546,6 +559,7 @@ namespace ngfem
 
     using BASE::Evaluate;
     // virtual bool ElementwiseConstant () const override { return true; }
+    bool DependsOnElement() const override { return false; }
     
     virtual double Evaluate (const BaseMappedIntegrationPoint & ip) const override
     {
@@ -605,6 +619,7 @@ namespace ngfem
     virtual string GetDescription () const override;
     
     virtual void GenerateCode(Code &code, FlatArray<int> inputs, int index) const override; 
+    virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override;
 
     /*
     virtual void NonZeroPattern (const class ProxyUserData & ud, FlatVector<bool> nonzero) const
@@ -667,6 +682,7 @@ namespace ngfem
     
     void PrintReport (ostream & ost) const override;
     void GenerateCode(Code &code, FlatArray<int> inputs, int index) const override;
+    bool DependsOnElement() const override { return false; }
   };
 
 
@@ -694,8 +710,10 @@ namespace ngfem
 
     virtual void SetValue (SCAL in) { val = in; }
     virtual SCAL GetValue () { return val; }
+    bool DependsOnElement() const override { return false; }
     void PrintReport (ostream & ost) const override;
     void GenerateCode (Code &code, FlatArray<int> inputs, int index) const override;
+    bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override;
   };
 
   
@@ -1113,6 +1131,13 @@ public:
         });
   }
 
+  virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override
+  {
+    for (int k = 0; k < this->Dimension(); k++)
+      code.Unary (code.Reg(index,k), lam, code.Reg(inputs[0],k));
+    return true;
+  }
+
   virtual void TraverseTree (const function<void(CoefficientFunction&)> & func) override
   {
     c1->TraverseTree (func);
@@ -1343,6 +1368,24 @@ public:
     });
   }
 
+  virtual bool GenerateBytecode (Bytecode & code, FlatArray<int> inputs, int index) const override
+  {
+    Bytecode::OPCODE op = Bytecode::BINARY;
+    if (opname == "+") op = Bytecode::ADD;
+    if (opname == "-") op = Bytecode::SUB;
+    if (opname == "*") op = Bytecode::MUL;
+    if (opname == "/") op = Bytecode::DIV;
+    for (int k = 0; k < Dimension(); k++)
+      {
+        int dest = code.Reg(index,k), src1 = code.Reg(inputs[0],k), src2 = code.Reg(inputs[1],k);
+        if (op == Bytecode::BINARY)
+          code.Binary (dest, lam, src1, src2);
+        else
+          code.Add (Bytecode::Instruction(op, dest, src1, src2));
+      }
+    return true;
+  }
+
   virtual void TraverseTree (const function<void(CoefficientFunction&)> & func) override
   {
     c1->TraverseTree (func);
@@ -47,6 +47,7 @@ namespace ngfem
 #include "finiteelement.hpp"
 #include "scalarfe.hpp"
 #include "tscalarfe.hpp"
+#include "shapetable.hpp"
 
 #include "elementtransformation.hpp"
 
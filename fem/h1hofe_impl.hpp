@@ -725,6 +725,126 @@ namespace ngfem
       }
   }
 
+
+  /* *********************** Shape tables  **********************/
+
+#ifndef FASTCOMPILE
+  template <ELEMENT_TYPE ET, class SHAPES, class BASE>
+  const SIMD_ShapeTable * H1HighOrderFE<ET,SHAPES,BASE> ::
+  GetShapeTable (const SIMD_IntegrationRule & ir) const
+  {
+    // other shape engines may depend on more than orders and orientation
+    if constexpr (DIM == 0 || !is_same<SHAPES, H1HighOrderFE_Shape<ET>>::value)
+      return nullptr;
+    else
+      {
+        if (order < shape_table_min_order) return nullptr;
+
+        ArrayMem<size_t, 64> key;
+        key.Append (1);
+        key.Append (ET);
+        key.Append (ndof);
+        key.Append (nodalp2);
+        key.Append (VertexOrderClass<N_VERTEX> (this->vnums));
+        for (int i = 0; i < N_EDGE; i++)
+          key.Append (order_edge[i]);
+        for (int i = 0; i < N_FACE; i++)
+          for (int j = 0; j < 2; j++)
+            key.Append (order_face[i][j]);
+        for (int i = 0; i < N_CELL; i++)
+          for (int j = 0; j < 3; j++)
+            key.Append (order_cell[i][j]);
+
+        return GetSIMDShapeTable
+          (key, ir, DIM, ndof, [this, &ir] (SIMD_ShapeTable & tab)
+           {
+             for (size_t k = 0; k < ir.Size(); k++)
+               this->T_CalcShape (GetTIPGrad<DIM> (ir[k]),
+                                  SBLambda ([&tab, k] (size_t i, auto s)
+                                            {
+                                              tab.shape(i,k) = s.Value();
+                                              for (int d = 0; d < DIM; d++)
+                                                tab.dshape(i*DIM+d,k) = s.DValue(d);
+                                            }));
+           });
+      }
+  }
+
+  template <ELEMENT_TYPE ET, class SHAPES, class BASE>
+  void H1HighOrderFE<ET,SHAPES,BASE> ::
+  CalcShape (const SIMD_IntegrationRule & ir, BareSliceMatrix<SIMD<double>> shape) const
+  {
+    if (auto tab = GetShapeTable (ir))
+      tab->CalcShape (shape);
+    else
+      BASE::CalcShape (ir, shape);
+  }
+
+  template <ELEMENT_TYPE ET, class SHAPES, class BASE>
+  void H1HighOrderFE<ET,SHAPES,BASE> ::
+  Evaluate (const SIMD_IntegrationRule & ir, BareSliceVector<> coefs,
+            BareVector<SIMD<double>> values) const
+  {
+    if (auto tab = GetShapeTable (ir))
+      tab->Evaluate (coefs, values);
+    else
+      BASE::Evaluate (ir, coefs, values);
+  }
+
+  template <ELEMENT_TYPE ET, class SHAPES, class BASE>
+  void H1HighOrderFE<ET,SHAPES,BASE> ::
+  AddTrans (const SIMD_IntegrationRule & ir, BareVector<SIMD<double>> values,
+            BareSliceVector<> coefs) const
+  {
+    if (auto tab = GetShapeTable (ir))
+      tab->AddTrans (values, coefs);
+    else
+      BASE::AddTrans (ir, values, coefs);
+  }
+
+  template <ELEMENT_TYPE ET, class SHAPES, class BASE>
+  void H1HighOrderFE<ET,SHAPES,BASE> ::
+  EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir, BareSliceVector<> coefs,
+                BareSliceMatrix<SIMD<double>> values) const
+  {
+    if (mir.DimSpace() == DIM)
+      if (auto tab = GetShapeTable (mir.IR()))
+        {
+          tab->EvaluateGrad (mir, coefs, values);
+          return;
+        }
+    BASE::EvaluateGrad (mir, coefs, values);
+  }
+
+  template <ELEMENT_TYPE ET, class SHAPES, class BASE>
+  void H1HighOrderFE<ET,SHAPES,BASE> ::
+  AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir, BareSliceMatrix<SIMD<double>> values,
+                BareSliceVector<> coefs) const
+  {
+    if (mir.DimSpace() == DIM)
+      if (auto tab = GetShapeTable (mir.IR()))
+        {
+          tab->AddGradTrans (mir, values, coefs);
+          return;
+        }
+    BASE::AddGradTrans (mir, values, coefs);
+  }
+
+  template <ELEMENT_TYPE ET, class SHAPES, class BASE>
+  void H1HighOrderFE<ET,SHAPES,BASE> ::
+  CalcMappedDShape (const SIMD_BaseMappedIntegrationRule & mir,
+                    BareSliceMatrix<SIMD<double>> dshapes) const
+  {
+    if (mir.DimSpace() == DIM)
+      if (auto tab = GetShapeTable (mir.IR()))
+        {
+          tab->CalcMappedDShape (mir, dshapes);
+          return;
+        }
+    BASE::CalcMappedDShape (mir, dshapes);
+  }
+#endif
+
 }
 
 #endif
@@ -213,6 +213,25 @@ namespace ngfem
     elmat += helmat;
     if (!IsSymmetric().IsTrue()) symmetric_so_far = false;    
   }
+
+  void BilinearFormIntegrator ::
+  CalcElementMatricesAdd (FlatArray<const FiniteElement*> fels,
+                          FlatArray<const ElementTransformation*> trafos,
+                          FlatArray<FlatMatrix<double>> elmats,
+                          bool & symmetric_so_far,
+                          LocalHeap & lh) const
+  {
+    bool symmetric_in = symmetric_so_far;
+    bool symmetric_out = true;
+    for (size_t i = 0; i < fels.Size(); i++)
+      {
+        HeapReset hr(lh);
+        bool symmetric_el = symmetric_in;
+        CalcElementMatrixAdd (*fels[i], *trafos[i], elmats[i], symmetric_el, lh);
+        symmetric_out &= symmetric_el;
+      }
+    symmetric_so_far = symmetric_out;
+  }
   
 
 
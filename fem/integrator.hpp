@@ -331,6 +331,17 @@ namespace ngfem
                             bool & symmetric_so_far,                            
                             LocalHeap & lh) const;
     
+    /**
+       Computes the element matrices of several elements of the same
+       type, order and material, and adds them to elmats[i].
+    */
+    virtual void
+      CalcElementMatricesAdd (FlatArray<const FiniteElement*> fels,
+                              FlatArray<const ElementTransformation*> trafos,
+                              FlatArray<FlatMatrix<double>> elmats,
+                              bool & symmetric_so_far,
+                              LocalHeap & lh) const;
+    
 
     
     virtual void
@@ -65,7 +65,7 @@ namespace ngfem
     {
       auto deriv = make_shared<SumOfIntegrals>();
       for (auto & icf : icfs)
-        deriv->icfs += make_shared<Integral> (icf->cf->Diff(var.get(), dir), icf->dx);
+        deriv->icfs += make_shared<Integral> (icf->cf->Differentiate(var.get(), dir), icf->dx);
       return deriv;
     }
 
@@ -90,17 +90,17 @@ namespace ngfem
             {
             case VOL:
               if (icf->dx.element_vb == VOL)
-                deriv->icfs += make_shared<Integral> ( icf->cf->Diff(shape.get(), dir) + divdir*icf->cf, icf->dx);
+                deriv->icfs += make_shared<Integral> ( icf->cf->Differentiate(shape.get(), dir) + divdir*icf->cf, icf->dx);
               else
                 throw Exception("In DiffShape: for vb=VOL only element_vb=VOL implemented!");
               break;
             case BND:
               if (icf->dx.element_vb == VOL)
-                deriv->icfs += make_shared<Integral> ( icf->cf->Diff(shape.get(), dir) + sdivdir*icf->cf, icf->dx);
+                deriv->icfs += make_shared<Integral> ( icf->cf->Differentiate(shape.get(), dir) + sdivdir*icf->cf, icf->dx);
               else if (icf->dx.element_vb == BND && dir->Dimension() == 3)
-                deriv->icfs += make_shared<Integral> ( icf->cf->Diff(shape.get(), dir) + bsdivdir*icf->cf, icf->dx);
+                deriv->icfs += make_shared<Integral> ( icf->cf->Differentiate(shape.get(), dir) + bsdivdir*icf->cf, icf->dx);
               else if (icf->dx.element_vb == BND && dir->Dimension() == 2)
-                deriv->icfs += make_shared<Integral> ( icf->cf->Diff(shape.get(), dir), icf->dx);
+                deriv->icfs += make_shared<Integral> ( icf->cf->Differentiate(shape.get(), dir), icf->dx);
               else
                 throw Exception("In DiffShape: for vb=BND something went wrong!");
               break;
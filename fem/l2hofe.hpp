@@ -126,6 +126,34 @@ namespace ngfem
     NGS_DLL_HEADER virtual void GetTraceTrans (int facet, FlatVector<> fcoefs, FlatVector<> coefs) const;
 
     HD NGS_DLL_HEADER virtual void GetDiagMassMatrix (FlatVector<> mass) const;
+
+#ifndef FASTCOMPILE
+    // high order elements evaluate from tabulated shapes, see shapetable.hpp
+    using BASE::CalcShape;
+    using BASE::AddTrans;
+    using BASE::AddGradTrans;
+    using BASE::CalcMappedDShape;
+
+    NGS_DLL_HEADER virtual void CalcShape (const SIMD_IntegrationRule & ir,
+                                           BareSliceMatrix<SIMD<double>> shape) const override;
+    NGS_DLL_HEADER virtual void Evaluate (const SIMD_IntegrationRule & ir,
+                                          BareSliceVector<> coefs,
+                                          BareVector<SIMD<double>> values) const override;
+    NGS_DLL_HEADER virtual void AddTrans (const SIMD_IntegrationRule & ir,
+                                          BareVector<SIMD<double>> values,
+                                          BareSliceVector<> coefs) const override;
+    NGS_DLL_HEADER virtual void EvaluateGrad (const SIMD_BaseMappedIntegrationRule & ir,
+                                              BareSliceVector<> coefs,
+                                              BareSliceMatrix<SIMD<double>> values) const override;
+    NGS_DLL_HEADER virtual void AddGradTrans (const SIMD_BaseMappedIntegrationRule & ir,
+                                              BareSliceMatrix<SIMD<double>> values,
+                                              BareSliceVector<> coefs) const override;
+    NGS_DLL_HEADER virtual void CalcMappedDShape (const SIMD_BaseMappedIntegrationRule & mir,
+                                                  BareSliceMatrix<SIMD<double>> dshapes) const override;
+
+  protected:
+    const SIMD_ShapeTable * GetShapeTable (const SIMD_IntegrationRule & ir) const;
+#endif
   };
 
 }
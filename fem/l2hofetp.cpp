@@ -7,6 +7,23 @@ namespace ngfem
 
   L2HighOrderFETP<ET_QUAD> :: ~L2HighOrderFETP() { ; }
 
+  // Legendre polynomials of fac*(2x-1) and their x-derivatives, in the points of a 1D rule
+  static void CalcLegendreShapes1D (int order, double fac, const SIMD_IntegrationRule & ir,
+                                    FlatMatrix<SIMD<double>> shape,
+                                    FlatMatrix<SIMD<double>> dshape)
+  {
+    for (size_t i = 0; i < ir.Size(); i++)
+      {
+        AutoDiff<1,SIMD<double>> adx(ir[i](0), 0);
+        LegendrePolynomial (order, fac*(2*adx-1),
+                            SBLambda([&] (size_t nr, auto val)
+                                     {
+                                       shape(nr, i) = val.Value();
+                                       dshape(nr, i) = val.DValue(0);
+                                     }));
+      }
+  }
+
   
 
 
@@ -335,6 +352,152 @@ namespace ngfem
 
   
   
+  void L2HighOrderFETP<ET_QUAD> ::
+  EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceVector<> bcoefs,
+                BareSliceMatrix<SIMD<double>> values) const
+  {
+    static Timer t("quad evaluate grad");
+    ThreadRegionTimer reg(t, TaskManager::GetThreadId());
+
+    auto & ir = mir.IR();
+    if (ir.IsTP() && ir.GetIRX().GetNIP() > 1 && ir.GetIRY().GetNIP() > 1)
+      {
+        double facx[] = { -1, 1, 1, -1 };
+        double facy[] = { -1, -1, 1, 1 };
+        INT<4> f = GetFaceSort (0, vnums);
+        double fx = facx[f[0]];
+        double fy = facy[f[0]];
+        bool flip = (facx[f[0]] == facx[f[1]]);
+
+        auto & irx = ir.GetIRX();
+        auto & iry = ir.GetIRY();
+        size_t nipx = irx.GetNIP();
+        size_t nipy = iry.GetNIP();
+
+        bool needs_copy = bcoefs.Dist() != 1;
+        STACK_ARRAY(double, mem_coefs, needs_copy ? (order+1)*(order+1) : 0);
+        if (needs_copy)
+          {
+            FlatVector<> coefs(sqr(order+1), mem_coefs);
+            coefs = bcoefs;
+          }
+        FlatMatrix<> mat_coefs(order+1, order+1, needs_copy ? mem_coefs : &bcoefs(0));
+
+        STACK_ARRAY(SIMD<double>, mem_shapex, 2*(order+1)*irx.Size());
+        FlatMatrix<SIMD<double>> simd_shapex(order+1, irx.Size(), mem_shapex);
+        FlatMatrix<SIMD<double>> simd_dshapex(order+1, irx.Size(), mem_shapex+(order+1)*irx.Size());
+        CalcLegendreShapes1D (order, fx, irx, simd_shapex, simd_dshapex);
+        SliceMatrix<double> shapex(order+1, nipx, SIMD<double>::Size()*irx.Size(), &simd_shapex(0,0)[0]);
+        SliceMatrix<double> dshapex(order+1, nipx, SIMD<double>::Size()*irx.Size(), &simd_dshapex(0,0)[0]);
+
+        STACK_ARRAY(SIMD<double>, mem_shapey, 2*(order+1)*iry.Size());
+        FlatMatrix<SIMD<double>> simd_shapey(order+1, iry.Size(), mem_shapey);
+        FlatMatrix<SIMD<double>> simd_dshapey(order+1, iry.Size(), mem_shapey+(order+1)*iry.Size());
+        CalcLegendreShapes1D (order, fy, iry, simd_shapey, simd_dshapey);
+        SliceMatrix<double> shapey(order+1, nipy, SIMD<double>::Size()*iry.Size(), &simd_shapey(0,0)[0]);
+        SliceMatrix<double> dshapey(order+1, nipy, SIMD<double>::Size()*iry.Size(), &simd_dshapey(0,0)[0]);
+
+        STACK_ARRAY(double, mem_tmp, (order+1)*nipx);
+        FlatMatrix<> tmp(order+1, nipx, mem_tmp);
+
+        for (int j = 0; j < 2; j++)
+          {
+            auto sx = (j == 0) ? dshapex : shapex;
+            auto sy = (j == 1) ? dshapey : shapey;
+            values(j, ir.Size()-1) = 0.0; // clear overhead
+            FlatMatrix<> mat_values(nipx, nipy, &values(j,0)[0]);
+            
+            if (flip)
+              tmp = mat_coefs * sx;
+            else
+              tmp = Trans(mat_coefs) * sx;
+            mat_values = Trans(tmp) * sy;
+          }
+        
+        mir.TransformGradient (values);
+        return;
+      }
+
+    TBASE::EvaluateGrad (mir, bcoefs, values);
+  }
+
+  void L2HighOrderFETP<ET_QUAD> ::
+  AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceMatrix<SIMD<double>> values,
+                BareSliceVector<> bcoefs) const
+  {
+    static Timer t("quad AddGradTrans");
+    ThreadRegionTimer reg(t, TaskManager::GetThreadId());
+
+    auto & ir = mir.IR();
+    if (ir.IsTP() && ir.GetIRX().GetNIP() > 1 && ir.GetIRY().GetNIP() > 1)
+      {
+        mir.TransformGradientTrans (values);
+
+        double facx[] = { -1, 1, 1, -1 };
+        double facy[] = { -1, -1, 1, 1 };
+        INT<4> f = GetFaceSort (0, vnums);
+        double fx = facx[f[0]];
+        double fy = facy[f[0]];
+        bool flip = (facx[f[0]] == facx[f[1]]);
+
+        auto & irx = ir.GetIRX();
+        auto & iry = ir.GetIRY();
+        size_t nipx = irx.GetNIP();
+        size_t nipy = iry.GetNIP();
+
+        bool needs_copy = bcoefs.Dist() != 1;
+        STACK_ARRAY(double, mem_coefs, needs_copy ? (order+1)*(order+1) : 0);
+        if (needs_copy)
+          {
+            FlatVector<> coefs(sqr(order+1), mem_coefs);
+            coefs = bcoefs;
+          }
+        FlatMatrix<> mat_coefs(order+1, order+1, needs_copy ? mem_coefs : &bcoefs(0));
+
+        STACK_ARRAY(SIMD<double>, mem_shapex, 2*(order+1)*irx.Size());
+        FlatMatrix<SIMD<double>> simd_shapex(order+1, irx.Size(), mem_shapex);
+        FlatMatrix<SIMD<double>> simd_dshapex(order+1, irx.Size(), mem_shapex+(order+1)*irx.Size());
+        CalcLegendreShapes1D (order, fx, irx, simd_shapex, simd_dshapex);
+        SliceMatrix<double> shapex(order+1, nipx, SIMD<double>::Size()*irx.Size(), &simd_shapex(0,0)[0]);
+        SliceMatrix<double> dshapex(order+1, nipx, SIMD<double>::Size()*irx.Size(), &simd_dshapex(0,0)[0]);
+
+        STACK_ARRAY(SIMD<double>, mem_shapey, 2*(order+1)*iry.Size());
+        FlatMatrix<SIMD<double>> simd_shapey(order+1, iry.Size(), mem_shapey);
+        FlatMatrix<SIMD<double>> simd_dshapey(order+1, iry.Size(), mem_shapey+(order+1)*iry.Size());
+        CalcLegendreShapes1D (order, fy, iry, simd_shapey, simd_dshapey);
+        SliceMatrix<double> shapey(order+1, nipy, SIMD<double>::Size()*iry.Size(), &simd_shapey(0,0)[0]);
+        SliceMatrix<double> dshapey(order+1, nipy, SIMD<double>::Size()*iry.Size(), &simd_dshapey(0,0)[0]);
+
+        STACK_ARRAY(double, mem_tmp, (order+1)*nipx);
+        FlatMatrix<> tmp(order+1, nipx, mem_tmp);
+
+        for (int j = 0; j < 2; j++)
+          {
+            auto sx = (j == 0) ? dshapex : shapex;
+            auto sy = (j == 1) ? dshapey : shapey;
+            FlatMatrix<> mat_values(nipx, nipy, &values(j,0)[0]);
+
+            tmp = sy * Trans(mat_values);
+            if (flip)
+              mat_coefs += tmp * Trans(sx);
+            else
+              mat_coefs += sx * Trans(tmp);
+          }
+
+        if (needs_copy)
+          {
+            FlatVector<> coefs(sqr(order+1), mem_coefs);
+            bcoefs.Range(0,ndof) = coefs;
+          }
+        return;
+      }
+
+    TBASE::AddGradTrans (mir, values, bcoefs);
+  }
+
+  
   // template class L2HighOrderFETP<ET_QUAD>;
   template class T_ScalarFiniteElement<L2HighOrderFETP<ET_QUAD>, ET_QUAD, DGFiniteElement<ET_trait<ET_QUAD>::DIM>>;
 
@@ -670,6 +833,88 @@ namespace ngfem
   }
   
 
+  void L2HighOrderFETP<ET_HEX> ::  
+  EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceVector<> bcoefs,
+                BareSliceMatrix<SIMD<double>> values) const
+  {
+    static Timer t("hex EvaluateGrad");
+    ThreadRegionTimer reg(t, TaskManager::GetThreadId());
+    auto & ir = mir.IR();
+    if (ir.IsTP())
+      {
+        auto & irx = ir.GetIRX();
+        auto & iry = ir.GetIRY();
+        auto & irz = ir.GetIRZ();
+        size_t nipx = irx.GetNIP();
+        size_t nipy = iry.GetNIP();
+        size_t nipz = irz.GetNIP();
+        size_t ndof = (order+1)*(order+1)*(order+1);
+        bool needs_copy = bcoefs.Dist() != 1;
+        STACK_ARRAY(double, mem_coefs, needs_copy ? ndof : 0);
+        if (needs_copy)
+          {
+            FlatVector<> coefs(ndof, mem_coefs);
+            coefs = bcoefs;
+          }
+        FlatMatrix<> mat_coefs(sqr(order+1), order+1, needs_copy ? mem_coefs : &bcoefs(0));
+
+        STACK_ARRAY(SIMD<double>, mem_shapex, 2*(order+1)*irx.Size());
+        FlatMatrix<SIMD<double>> simd_shapex(order+1, irx.Size(), mem_shapex);
+        FlatMatrix<SIMD<double>> simd_dshapex(order+1, irx.Size(), mem_shapex+(order+1)*irx.Size());
+        CalcLegendreShapes1D (order, 1, irx, simd_shapex, simd_dshapex);
+        SliceMatrix<double> shapex(order+1, nipx, SIMD<double>::Size()*irx.Size(), &simd_shapex(0,0)[0]);
+        SliceMatrix<double> dshapex(order+1, nipx, SIMD<double>::Size()*irx.Size(), &simd_dshapex(0,0)[0]);
+
+        STACK_ARRAY(SIMD<double>, mem_shapey, 2*(order+1)*iry.Size());
+        FlatMatrix<SIMD<double>> simd_shapey(order+1, iry.Size(), mem_shapey);
+        FlatMatrix<SIMD<double>> simd_dshapey(order+1, iry.Size(), mem_shapey+(order+1)*iry.Size());
+        CalcLegendreShapes1D (order, 1, iry, simd_shapey, simd_dshapey);
+        SliceMatrix<double> shapey(order+1, nipy, SIMD<double>::Size()*iry.Size(), &simd_shapey(0,0)[0]);
+        SliceMatrix<double> dshapey(order+1, nipy, SIMD<double>::Size()*iry.Size(), &simd_dshapey(0,0)[0]);
+
+        STACK_ARRAY(SIMD<double>, mem_shapez, 2*(order+1)*irz.Size());
+        FlatMatrix<SIMD<double>> simd_shapez(order+1, irz.Size(), mem_shapez);
+        FlatMatrix<SIMD<double>> simd_dshapez(order+1, irz.Size(), mem_shapez+(order+1)*irz.Size());
+        CalcLegendreShapes1D (order, 1, irz, simd_shapez, simd_dshapez);
+        SliceMatrix<double> shapez(order+1, nipz, SIMD<double>::Size()*irz.Size(), &simd_shapez(0,0)[0]);
+        SliceMatrix<double> dshapez(order+1, nipz, SIMD<double>::Size()*irz.Size(), &simd_dshapez(0,0)[0]);
+
+        STACK_ARRAY(double, memtshapez, nipz*(order+1));
+        FlatMatrix<> tshapez(nipz, order+1, memtshapez);
+        STACK_ARRAY(double, memtshapey, nipy*(order+1));
+        FlatMatrix<> tshapey(nipy, order+1, memtshapey);
+        STACK_ARRAY(double, memtshapex, nipx*(order+1));
+        FlatMatrix<> tshapex(nipx, order+1, memtshapex);
+
+        STACK_ARRAY(double, mem1, nipz*sqr(order+1));
+        FlatMatrix<> temp1(nipz, sqr(order+1), mem1);
+        FlatMatrix<> temp1reshape(nipz*(order+1), order+1, &temp1(0,0));
+        STACK_ARRAY(double, mem2, nipy*nipz*(order+1));
+        FlatMatrix<> temp2(nipy, nipz*(order+1), mem2);
+        FlatMatrix<> temp2reshape(nipz*nipy, order+1, &temp2(0,0));
+        
+        for (size_t j = 0; j < 3; j++)
+          {
+            tshapez = Trans( (j == 2) ? dshapez : shapez);
+            tshapey = Trans( (j == 1) ? dshapey : shapey);
+            tshapex = Trans( (j == 0) ? dshapex : shapex);
+
+            temp1 = tshapez*Trans(mat_coefs);
+            temp2 = tshapey*Trans(temp1reshape);
+
+            values(j, ir.Size()-1) = 0.0; // clear overhead
+            FlatMatrix<> temp3(nipx, nipz*nipy, &values(j,0)[0]);
+            temp3 = tshapex*Trans(temp2reshape);
+          }
+        
+        mir.TransformGradient (values);
+        return;
+      }
+
+    TBASE::EvaluateGrad(mir, bcoefs, values);
+  }
+  
   L2HighOrderFETP<ET_HEX> :: ~L2HighOrderFETP() { ; }   
 }
 
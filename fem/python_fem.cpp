@@ -165,7 +165,7 @@ cl_UnaryOpCF<GenericBSpline>::Diff(const CoefficientFunction * var,
                                    shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return UnaryOpCF(c1, GenericBSpline(lam.sp->Differentiate())) * c1->Diff(var, dir);
+  return UnaryOpCF(c1, GenericBSpline(lam.sp->Differentiate())) * c1->Differentiate(var, dir);
 }
 
 
@@ -181,7 +181,7 @@ cl_UnaryOpCF<GenericIdentity>::Diff(const CoefficientFunction * var,
                                       shared_ptr<CoefficientFunction> dir) const
 {
   if (var == this) return dir;
-  auto hcf = c1->Diff(var, dir);
+  auto hcf = c1->Differentiate(var, dir);
   hcf->SetDimensions(Dimensions());
   return hcf;
 }
@@ -295,7 +295,7 @@ cl_BinaryOpCF<GenericATan2>::Diff(const CoefficientFunction * var,
                                   shared_ptr<CoefficientFunction> dir) const
 {
   if (var == this) return dir;    
-  return (c1->Diff(var,dir)*c2 - c2->Diff(var,dir)*c1) / (c1*c1+c2*c2);
+  return (c1->Differentiate(var,dir)*c2 - c2->Differentiate(var,dir)*c1) / (c1*c1+c2*c2);
 }
 
 
@@ -316,7 +316,7 @@ cl_UnaryOpCF<GenericSin>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return UnaryOpCF(c1, GenericCos(), "cos") * c1->Diff(var, dir);
+  return UnaryOpCF(c1, GenericCos(), "cos") * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -324,7 +324,7 @@ cl_UnaryOpCF<GenericCos>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return -1 * UnaryOpCF(c1, GenericSin(), "sin") * c1->Diff(var, dir);
+  return -1 * UnaryOpCF(c1, GenericSin(), "sin") * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -332,7 +332,7 @@ cl_UnaryOpCF<GenericTan>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return make_shared<ConstantCoefficientFunction>(1) / (UnaryOpCF(c1, GenericCos(), "cos")*UnaryOpCF(c1, GenericCos(), "cos")) * c1->Diff(var, dir);
+  return make_shared<ConstantCoefficientFunction>(1) / (UnaryOpCF(c1, GenericCos(), "cos")*UnaryOpCF(c1, GenericCos(), "cos")) * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -340,7 +340,7 @@ cl_UnaryOpCF<GenericSinh>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return UnaryOpCF(c1, GenericCosh(), "cosh") * c1->Diff(var, dir);
+  return UnaryOpCF(c1, GenericCosh(), "cosh") * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -348,7 +348,7 @@ cl_UnaryOpCF<GenericCosh>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return UnaryOpCF(c1, GenericSinh(), "sinh") * c1->Diff(var, dir);
+  return UnaryOpCF(c1, GenericSinh(), "sinh") * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -356,7 +356,7 @@ cl_UnaryOpCF<GenericExp>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return UnaryOpCF(c1, GenericExp(), "exp") * c1->Diff(var, dir);
+  return UnaryOpCF(c1, GenericExp(), "exp") * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -364,7 +364,7 @@ cl_UnaryOpCF<GenericLog>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return c1->Diff(var, dir) / c1;
+  return c1->Differentiate(var, dir) / c1;
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -372,7 +372,7 @@ cl_UnaryOpCF<GenericSqrt>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return make_shared<ConstantCoefficientFunction>(0.5)/UnaryOpCF(c1, GenericSqrt(), "sqrt") * c1->Diff(var, dir);
+  return make_shared<ConstantCoefficientFunction>(0.5)/UnaryOpCF(c1, GenericSqrt(), "sqrt") * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -380,7 +380,7 @@ cl_BinaryOpCF<GenericPow>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return UnaryOpCF(c1,GenericLog(),"log")*c2->Diff(var, dir)*BinaryOpCF(c1,c2,GenericPow(), "pow") + c2*c1->Diff(var,dir)/c1*BinaryOpCF(c1,c2,GenericPow(), "pow");
+  return UnaryOpCF(c1,GenericLog(),"log")*c2->Differentiate(var, dir)*BinaryOpCF(c1,c2,GenericPow(), "pow") + c2*c1->Differentiate(var,dir)/c1*BinaryOpCF(c1,c2,GenericPow(), "pow");
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -388,7 +388,7 @@ cl_UnaryOpCF<GenericASin>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return make_shared<ConstantCoefficientFunction>(1)/UnaryOpCF(make_shared<ConstantCoefficientFunction>(1) - c1 * c1, GenericSqrt(), "sqrt") * c1->Diff(var, dir);
+  return make_shared<ConstantCoefficientFunction>(1)/UnaryOpCF(make_shared<ConstantCoefficientFunction>(1) - c1 * c1, GenericSqrt(), "sqrt") * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -396,7 +396,7 @@ cl_UnaryOpCF<GenericACos>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return make_shared<ConstantCoefficientFunction>(-1)/UnaryOpCF(make_shared<ConstantCoefficientFunction>(1) - c1*c1, GenericSqrt(), "sqrt") * c1->Diff(var, dir);
+  return make_shared<ConstantCoefficientFunction>(-1)/UnaryOpCF(make_shared<ConstantCoefficientFunction>(1) - c1*c1, GenericSqrt(), "sqrt") * c1->Differentiate(var, dir);
 }
 
 template <> shared_ptr<CoefficientFunction>
@@ -404,7 +404,7 @@ cl_UnaryOpCF<GenericATan>::Diff(const CoefficientFunction * var,
                                  shared_ptr<CoefficientFunction> dir) const
 {
   if (this == var) return dir;
-  return make_shared<ConstantCoefficientFunction>(1) / (c1*c1 + make_shared<ConstantCoefficientFunction>(1)) * c1->Diff(var, dir);
+  return make_shared<ConstantCoefficientFunction>(1) / (c1*c1 + make_shared<ConstantCoefficientFunction>(1)) * c1->Differentiate(var, dir);
 }
 
 
@@ -901,7 +901,7 @@ cf : ngsolve.CoefficientFunction
           [] (shared_ptr<CF> coef, shared_ptr<CF> var, shared_ptr<CF> dir)
           {
             cout << "warning: Derive is deprecated, use Diff instead" << endl;
-            return coef->Diff(var.get(), dir);
+            return coef->Differentiate(var.get(), dir);
           },
           "depricated: use 'Diff' instead", 
           py::arg("variable"), py::arg("direction")=1.0)
@@ -909,9 +909,9 @@ cf : ngsolve.CoefficientFunction
           [] (shared_ptr<CF> coef, shared_ptr<CF> var, shared_ptr<CF> dir)
           {
             if (dir)
-              return coef->Diff(var.get(), dir);
+              return coef->Differentiate(var.get(), dir);
             if (var->Dimension() == 1)
-              return coef->Diff(var.get(), make_shared<ConstantCoefficientFunction>(1));
+              return coef->Differentiate(var.get(), make_shared<ConstantCoefficientFunction>(1));
             else
               {
                 if (coef->Dimension() != 1)
@@ -926,7 +926,7 @@ cf : ngsolve.CoefficientFunction
                     ei[i] = one;
                     auto vec = MakeVectorialCoefficientFunction (Array<shared_ptr<CoefficientFunction>>(ei));
                     vec->SetDimensions(var->Dimensions());
-                    ddi[i] = coef->Diff(var.get(), vec);
+                    ddi[i] = coef->Differentiate(var.get(), vec);
                   }
                 auto dvec = MakeVectorialCoefficientFunction (move(ddi));
                 dvec->SetDimensions(var->Dimensions());
@@ -938,7 +938,7 @@ cf : ngsolve.CoefficientFunction
 
     .def ("DiffShape", [] (shared_ptr<CF> coef, shared_ptr<CF> dir)
           {
-            return coef->Diff (shape.get(), dir);
+            return coef->Differentiate (shape.get(), dir);
           },
           "Compute shape derivative in direction", 
           py::arg("direction")=1.0)
@@ -2267,10 +2267,20 @@ alpha : double
     
                            
   m.def("GenerateL2ElementCode", &GenerateL2ElementCode);
+  m.def("SetCompileCacheDirectory", &SetCompileCacheDirectory, py::arg("directory"),
+        "Directory where libraries of compiled CoefficientFunctions are cached and re-used\n"
+        "by later runs. Empty string disables the cache. Default is the environment\n"
+        "variable NGS_COMPILE_CACHE.");
+  m.def("GetCompileCacheDirectory", &GetCompileCacheDirectory);
+  m.def("SetShapeTableCache", &SetShapeTableCache,
+        py::arg("maxbytes") = size_t(256) << 20, py::arg("minorder") = 4,
+        "Shape functions of high order H1 and L2 elements are tabulated per element kind\n"
+        "and SIMD integration rule. maxbytes limits the memory of all tables, 0 disables\n"
+        "the tables. Elements of lower order than minorder are evaluated on the fly.");
 
   m.def("VoxelCoefficient",
         [](py::tuple pystart, py::tuple pyend, py::array values,
-           bool linear, py::object trafocf)
+           bool linear, py::object trafocf, bool blocked)
         -> shared_ptr<CoefficientFunction>
         {
           shared_ptr<CoefficientFunction> trafo;
@@ -2285,8 +2295,15 @@ alpha : double
             start.Append(py::cast<double>(val));
           for(auto val : pyend)
             end.Append(py::cast<double>(val));
-          for(auto dim : Range(values.ndim()))
+          // leading axes are voxels, trailing axes the components
+          int ndim = start.Size();
+          if(values.ndim() < ndim || values.ndim() > ndim+2)
+            throw Exception("values must have " + ToString(ndim) + " voxel axes and up to 2 component axes");
+          for(auto dim : Range(ndim))
             dim_vals.Insert(0,values.shape(dim));
+          Array<int> comp_dims;
+          for(auto dim : Range(ndim, int(values.ndim())))
+            comp_dims.Append(values.shape(dim));
 
           if(values.dtype().kind() == 'c')
             {
@@ -2295,22 +2312,44 @@ alpha : double
               for(auto i : Range(vals))
                 vals[i] = c_array.at(i);
               return make_shared<VoxelCoefficientFunction<Complex>>
-                (start, end, dim_vals, move(vals), linear, trafo);
+                (start, end, dim_vals, move(vals), linear, trafo, comp_dims, blocked);
+            }
+          // native float64 only, any other array would be converted to a temporary copy
+          if(!blocked && py::isinstance<py::array_t<double, py::array::c_style>>(values))
+            {
+              // use the (possibly memory-mapped) array in place
+              auto d_array = py::cast<py::array_t<double, py::array::c_style>>(values);
+              FlatArray<double> vals(d_array.size(), const_cast<double*>(d_array.data()));
+              shared_ptr<void> owner(new py::object(d_array), [](void * p)
+                                     {
+                                       py::gil_scoped_acquire ac;
+                                       delete static_cast<py::object*>(p);
+                                     });
+              return make_shared<VoxelCoefficientFunction<double>>
+                (start, end, dim_vals, vals, owner, linear, trafo, comp_dims);
             }
           auto d_array = py::cast<py::array_t<double>>(values.attr("ravel")());
           Array<double> vals(values.size());
+          auto d_data = d_array.data();
           for(auto i : Range(vals))
-            vals[i] = d_array.at(i);
+            vals[i] = d_data[i];
           return make_shared<VoxelCoefficientFunction<double>>
-              (start, end, dim_vals, move(vals), linear, trafo);
+            (start, end, dim_vals, move(vals), linear, trafo, comp_dims, blocked);
         }, py::arg("start"), py::arg("end"), py::arg("values"),
-        py::arg("linear")=true, py::arg("trafocf")=DummyArgument(), R"delimiter(CoefficientFunction defined on a grid.
+        py::arg("linear")=true, py::arg("trafocf")=DummyArgument(),
+        py::arg("blocked")=false, R"delimiter(CoefficientFunction defined on a grid.
 
 Start and end mark the cartesian boundary of domain. The function will be continued by a constant function outside of this box. Inside a cartesian grid will be created by the dimensions of the numpy input array 'values'. This array must have the dimensions of the mesh and the values stored as:
 x1y1z1, x2y1z1, ..., xNy1z1, x1y2z1, ...
 
+Additional trailing axes of 'values' give a vector or matrix valued function.
+
 If linear is True the function will be interpolated linearly between the values. Otherwise the nearest voxel value is taken.
 
+A C-contiguous float64 array (e.g. a numpy.memmap) is used in place without copying.
+If blocked is True the values are copied into blocks of 8^dim voxels, which keeps
+neighbouring lookups in cache for large grids.
+
 )delimiter");
 
 }
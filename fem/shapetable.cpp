@@ -0,0 +1,300 @@
+/*********************************************************************/
+/* File:   shapetable.cpp                                            */
+/* Date:   17. Oct. 2026                                             */
+/*********************************************************************/
+
+/*
+   Shape function tables for SIMD integration rules
+*/
+
+#include <fem.hpp>
+
+namespace ngfem
+{
+  int shape_table_min_order = 4;
+  static atomic<size_t> shape_table_max_bytes { size_t(256) << 20 };
+
+  void SetShapeTableCache (size_t max_bytes, int min_order)
+  {
+    shape_table_max_bytes = max_bytes;
+    shape_table_min_order = min_order;
+  }
+
+
+  /*
+    Lock-free open addressing table.  Entries are never removed, a
+    table computed twice by concurrent threads is dropped by the loser
+    of the insertion.
+  */
+  class ShapeTableCache
+  {
+    struct Entry
+    {
+      size_t hash;
+      Array<size_t> key;
+      SIMD_ShapeTable table;
+    };
+
+    static constexpr size_t NSLOTS = 1 << 14;
+    static constexpr size_t MAXPROBE = 64;
+    std::vector<atomic<Entry*>> slots;
+    atomic<size_t> nbytes { 0 };
+
+  public:
+    ShapeTableCache () : slots(NSLOTS)
+    {
+      for (auto & slot : slots) slot = nullptr;
+    }
+
+    ~ShapeTableCache ()
+    {
+      for (auto & slot : slots) delete slot.load();
+    }
+
+    static size_t Hash (FlatArray<size_t> key, const SIMD_IntegrationRule & ir, int dim)
+    {
+      auto mix = [] (size_t h, size_t x) { return (h ^ x) * 0x9E3779B97F4A7C15ull + (h >> 29); };
+      size_t h = ir.Size();
+      for (auto k : key)
+        h = mix (h, k);
+      for (size_t i = 0; i < ir.Size(); i++)
+        for (int k = 0; k < dim; k++)
+          for (size_t j = 0; j < SIMD<double>::Size(); j++)
+            {
+              uint64_t bits;
+              double x = ir[i](k)[j];
+              memcpy (&bits, &x, sizeof(bits));
+              h = mix (h, bits);
+            }
+      return h;
+    }
+
+    static bool Matches (const Entry & entry, size_t hash, FlatArray<size_t> key,
+                         const SIMD_IntegrationRule & ir, int dim)
+    {
+      if (entry.hash != hash || entry.table.nip != ir.Size() || entry.key.Size() != key.Size())
+        return false;
+      for (size_t i = 0; i < key.Size(); i++)
+        if (entry.key[i] != key[i]) return false;
+      for (size_t i = 0; i < ir.Size(); i++)
+        for (int k = 0; k < dim; k++)
+          {
+            SIMD<double> x = ir[i](k);
+            if (memcmp (&x, &entry.table.refpoints[i*dim+k], sizeof(x)) != 0)
+              return false;
+          }
+      return true;
+    }
+
+    const SIMD_ShapeTable * Get (FlatArray<size_t> key, const SIMD_IntegrationRule & ir,
+                                 int dim, size_t ndof,
+                                 const std::function<void(SIMD_ShapeTable&)> & compute)
+    {
+      size_t hash = Hash (key, ir, dim);
+      size_t first = hash % NSLOTS;
+
+      size_t probe = 0;
+      for ( ; probe < MAXPROBE; probe++)
+        {
+          Entry * entry = slots[(first+probe) % NSLOTS].load(std::memory_order_acquire);
+          if (!entry) break;
+          if (Matches (*entry, hash, key, ir, dim))
+            return &entry->table;
+        }
+      if (probe == MAXPROBE) return nullptr;
+
+      size_t nip = ir.Size();
+      size_t bytes = (1+dim) * ndof * nip * sizeof(SIMD<double>);
+      if (nbytes + bytes > shape_table_max_bytes) return nullptr;
+
+      static Timer t("ShapeTableCache::Compute"); RegionTimer reg(t);
+      auto entry = new Entry;
+      entry->hash = hash;
+      entry->key = key;
+      auto & tab = entry->table;
+      tab.dim = dim;
+      tab.ndof = ndof;
+      tab.nip = nip;
+      tab.refpoints.SetSize (nip*dim);
+      for (size_t i = 0; i < nip; i++)
+        for (int k = 0; k < dim; k++)
+          tab.refpoints[i*dim+k] = ir[i](k);
+      tab.shape.SetSize (ndof, nip);
+      tab.dshape.SetSize (dim*ndof, nip);
+      compute (tab);
+
+      for ( ; probe < MAXPROBE; probe++)
+        {
+          auto & slot = slots[(first+probe) % NSLOTS];
+          Entry * expected = nullptr;
+          if (slot.compare_exchange_strong (expected, entry, std::memory_order_acq_rel))
+            {
+              nbytes += bytes;
+              return &entry->table;
+            }
+          if (Matches (*expected, hash, key, ir, dim))
+            {
+              delete entry;
+              return &expected->table;
+            }
+        }
+      delete entry;
+      return nullptr;
+    }
+  };
+
+  const SIMD_ShapeTable *
+  GetSIMDShapeTable (FlatArray<size_t> key, const SIMD_IntegrationRule & ir,
+                     int dim, size_t ndof,
+                     const std::function<void(SIMD_ShapeTable&)> & compute)
+  {
+    if (shape_table_max_bytes == 0) return nullptr;
+    static ShapeTableCache cache;
+    return cache.Get (key, ir, dim, ndof, compute);
+  }
+
+
+
+  void SIMD_ShapeTable :: CalcShape (BareSliceMatrix<SIMD<double>> shapes) const
+  {
+    for (size_t i = 0; i < ndof; i++)
+      for (size_t k = 0; k < nip; k++)
+        shapes(i,k) = shape(i,k);
+  }
+
+  void SIMD_ShapeTable :: Evaluate (BareSliceVector<> coefs, BareVector<SIMD<double>> values) const
+  {
+    for (size_t k = 0; k < nip; k++)
+      values(k) = SIMD<double>(0.0);
+    for (size_t i = 0; i < ndof; i++)
+      {
+        SIMD<double> c = coefs(i);
+        const SIMD<double> * row = &shape(i,0);
+        for (size_t k = 0; k < nip; k++)
+          values(k) += c * row[k];
+      }
+  }
+
+  void SIMD_ShapeTable :: AddTrans (BareVector<SIMD<double>> values, BareSliceVector<> coefs) const
+  {
+    for (size_t i = 0; i < ndof; i++)
+      {
+        const SIMD<double> * row = &shape(i,0);
+        SIMD<double> sum(0.0);
+        for (size_t k = 0; k < nip; k++)
+          sum += row[k] * values(k);
+        coefs(i) += HSum(sum);
+      }
+  }
+
+
+  // inverse Jacobians of all points, column k holds Jinv(d,e) in row d*DIM+e
+  template <int DIM>
+  static void GetJacobianInverses (const SIMD_BaseMappedIntegrationRule & bmir,
+                                   FlatMatrix<SIMD<double>> jinv)
+  {
+    auto & mir = static_cast<const SIMD_MappedIntegrationRule<DIM,DIM>&> (bmir);
+    for (size_t k = 0; k < mir.Size(); k++)
+      {
+        Mat<DIM,DIM,SIMD<double>> inv = mir[k].GetJacobianInverse();
+        for (int d = 0; d < DIM; d++)
+          for (int e = 0; e < DIM; e++)
+            jinv(d*DIM+e, k) = inv(d,e);
+      }
+  }
+
+  void SIMD_ShapeTable ::
+  EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceVector<> coefs, BareSliceMatrix<SIMD<double>> values) const
+  {
+    Switch<3> (dim-1, [&] (auto IC)
+      {
+        constexpr int DIM = IC.value+1;
+        STACK_ARRAY(SIMD<double>, mem, DIM*DIM*nip + DIM*nip);
+        FlatMatrix<SIMD<double>> jinv(DIM*DIM, nip, mem);
+        FlatMatrix<SIMD<double>> gref(DIM, nip, mem+DIM*DIM*nip);
+        GetJacobianInverses<DIM> (mir, jinv);
+
+        gref = SIMD<double>(0.0);
+        for (size_t i = 0; i < ndof; i++)
+          {
+            SIMD<double> c = coefs(i);
+            for (int d = 0; d < DIM; d++)
+              {
+                const SIMD<double> * row = &dshape(i*DIM+d,0);
+                for (size_t k = 0; k < nip; k++)
+                  gref(d,k) += c * row[k];
+              }
+          }
+
+        // grad = Jinv^T * grad_ref
+        for (size_t k = 0; k < nip; k++)
+          for (int e = 0; e < DIM; e++)
+            {
+              SIMD<double> sum(0.0);
+              for (int d = 0; d < DIM; d++)
+                sum += jinv(d*DIM+e, k) * gref(d,k);
+              values(e,k) = sum;
+            }
+      });
+  }
+
+  void SIMD_ShapeTable ::
+  AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceMatrix<SIMD<double>> values, BareSliceVector<> coefs) const
+  {
+    Switch<3> (dim-1, [&] (auto IC)
+      {
+        constexpr int DIM = IC.value+1;
+        STACK_ARRAY(SIMD<double>, mem, DIM*DIM*nip + DIM*nip);
+        FlatMatrix<SIMD<double>> jinv(DIM*DIM, nip, mem);
+        FlatMatrix<SIMD<double>> vref(DIM, nip, mem+DIM*DIM*nip);
+        GetJacobianInverses<DIM> (mir, jinv);
+
+        // vref = Jinv * values
+        for (size_t k = 0; k < nip; k++)
+          for (int d = 0; d < DIM; d++)
+            {
+              SIMD<double> sum(0.0);
+              for (int e = 0; e < DIM; e++)
+                sum += jinv(d*DIM+e, k) * values(e,k);
+              vref(d,k) = sum;
+            }
+
+        for (size_t i = 0; i < ndof; i++)
+          {
+            SIMD<double> sum(0.0);
+            for (int d = 0; d < DIM; d++)
+              {
+                const SIMD<double> * row = &dshape(i*DIM+d,0);
+                for (size_t k = 0; k < nip; k++)
+                  sum += row[k] * vref(d,k);
+              }
+            coefs(i) += HSum(sum);
+          }
+      });
+  }
+
+  void SIMD_ShapeTable ::
+  CalcMappedDShape (const SIMD_BaseMappedIntegrationRule & mir,
+                    BareSliceMatrix<SIMD<double>> dshapes) const
+  {
+    Switch<3> (dim-1, [&] (auto IC)
+      {
+        constexpr int DIM = IC.value+1;
+        STACK_ARRAY(SIMD<double>, mem, DIM*DIM*nip);
+        FlatMatrix<SIMD<double>> jinv(DIM*DIM, nip, mem);
+        GetJacobianInverses<DIM> (mir, jinv);
+
+        for (size_t i = 0; i < ndof; i++)
+          for (size_t k = 0; k < nip; k++)
+            for (int e = 0; e < DIM; e++)
+              {
+                SIMD<double> sum(0.0);
+                for (int d = 0; d < DIM; d++)
+                  sum += jinv(d*DIM+e, k) * dshape(i*DIM+d, k);
+                dshapes(i*DIM+e, k) = sum;
+              }
+      });
+  }
+}
@@ -0,0 +1,74 @@
+#ifndef FILE_SHAPETABLE
+#define FILE_SHAPETABLE
+
+/*********************************************************************/
+/* File:   shapetable.hpp                                            */
+/* Date:   17. Oct. 2026                                             */
+/*********************************************************************/
+
+namespace ngfem
+{
+
+  /**
+     Shape functions and reference gradients of one element kind
+     (type, orders, vertex orientation) tabulated in the points of one
+     SIMD integration rule.  Tables are shared by all elements of the
+     same kind, high order kernels replace the recursive shape
+     evaluation by dense loops over the table.
+  */
+  class SIMD_ShapeTable
+  {
+  public:
+    int dim;
+    size_t ndof, nip;
+    Array<SIMD<double>> refpoints;   // dim coordinates per point
+    Matrix<SIMD<double>> shape;      // ndof x nip
+    Matrix<SIMD<double>> dshape;     // dim*ndof x nip, row dim*i+k is d/dx_k of shape i
+
+    NGS_DLL_HEADER void CalcShape (BareSliceMatrix<SIMD<double>> shapes) const;
+    NGS_DLL_HEADER void Evaluate (BareSliceVector<> coefs, BareVector<SIMD<double>> values) const;
+    NGS_DLL_HEADER void AddTrans (BareVector<SIMD<double>> values, BareSliceVector<> coefs) const;
+
+    // mapped gradients, volume elements only (mir.DimSpace() == dim)
+    NGS_DLL_HEADER void EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                                      BareSliceVector<> coefs,
+                                      BareSliceMatrix<SIMD<double>> values) const;
+    NGS_DLL_HEADER void AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir,
+                                      BareSliceMatrix<SIMD<double>> values,
+                                      BareSliceVector<> coefs) const;
+    NGS_DLL_HEADER void CalcMappedDShape (const SIMD_BaseMappedIntegrationRule & mir,
+                                          BareSliceMatrix<SIMD<double>> dshapes) const;
+  };
+
+  /*
+    Returns the table for element kind 'key' and rule 'ir', calls
+    'compute' with an allocated table if it does not exist yet.
+    Returns nullptr if the cache is disabled or full.
+  */
+  NGS_DLL_HEADER const SIMD_ShapeTable *
+  GetSIMDShapeTable (FlatArray<size_t> key, const SIMD_IntegrationRule & ir,
+                     int dim, size_t ndof,
+                     const std::function<void(SIMD_ShapeTable&)> & compute);
+
+  // max_bytes = 0 disables the cache, elements of lower order than
+  // min_order always evaluate shapes on the fly
+  NGS_DLL_HEADER void SetShapeTableCache (size_t max_bytes, int min_order);
+  NGS_DLL_HEADER extern int shape_table_min_order;
+
+  // permutation class of the vertex numbers
+  template <int N, typename TV>
+  INLINE size_t VertexOrderClass (const TV & vnums)
+  {
+    size_t cls = 0;
+    for (int i = 0; i < N; i++)
+      {
+        int rank = 0;
+        for (int j = 0; j < N; j++)
+          if (vnums[j] < vnums[i]) rank++;
+        cls = cls * N + rank;
+      }
+    return cls;
+  }
+}
+
+#endif
@@ -218,6 +218,20 @@ namespace ngfem
       });
     body += "}\n";
 
+    // batched directions of SymbolicEnergy, see ProxyUserData::directions
+    if(!testfunction && code.is_simd && code.deriv>=1)
+      {
+        body += "if ({ud}->directions.Size()) {\n";
+        body += "auto & dir = {ud}->directions[i / {ud}->direction_blocksize];\n";
+        TraverseDimensions( dims, [&](int ind, int i, int j) {
+            string seeded = "(dir.trialfunction == {this} && dir.trial_comp == "+ToLiteral(ind)+")";
+            if(code.deriv==2)
+              seeded += " || (dir.testfunction == {this} && dir.test_comp == "+ToLiteral(ind)+")";
+            body += Var(index,i,j).S() + ".DValue(0) = (" + seeded + ") ? 1.0 : 0.0;\n";
+          });
+        body += "}\n";
+      }
+
     string func_string = testfunction ? "testfunction" : "trialfunction";
     string comp_string = testfunction ? "test_comp" : "trial_comp";
     std::map<string,string> variables;
@@ -521,6 +535,19 @@ namespace ngfem
             values(i,j).Value() = val(i,j);
       }
 
+    if (ud->directions.Size())
+      {
+        size_t bs = ud->direction_blocksize;
+        for (size_t b = 0; b < ud->directions.Size(); b++)
+          if (ud->directions[b].trialfunction == this)
+            {
+              auto row = values.Row(ud->directions[b].trial_comp);
+              for (size_t i = b*bs; i < (b+1)*bs; i++)
+                row(i).DValue(0) = 1;
+            }
+        return;
+      }
+
     if (ud->testfunction == this)
       {
         auto row = values.Row(ud->test_comp);        
@@ -588,6 +615,22 @@ namespace ngfem
             values(i,j).Value() = val(i,j);
       }
 
+    if (ud->directions.Size())
+      {
+        size_t bs = ud->direction_blocksize;
+        for (size_t b = 0; b < ud->directions.Size(); b++)
+          {
+            auto & dir = ud->directions[b];
+            if (dir.testfunction == this)
+              for (size_t i = b*bs; i < (b+1)*bs; i++)
+                values(dir.test_comp, i).DValue(0) = 1;
+            if (dir.trialfunction == this)
+              for (size_t i = b*bs; i < (b+1)*bs; i++)
+                values(dir.trial_comp, i).DValue(0) = 1;
+          }
+        return;
+      }
+
     if (ud->testfunction == this)
       for (size_t i = 0; i < np; i++)
         values(ud->test_comp, i).DValue(0) = 1;
@@ -1764,6 +1807,248 @@ namespace ngfem
   }
 
 
+  void 
+  SymbolicBilinearFormIntegrator ::
+  CalcElementMatricesAdd (FlatArray<const FiniteElement*> fels,
+                          FlatArray<const ElementTransformation*> trafos,
+                          FlatArray<FlatMatrix<double>> elmats,
+                          bool & symmetric_so_far,
+                          LocalHeap & lh) const
+  {
+    // the coefficient is evaluated for all elements at once, it may see
+    // the elements only through mapped points and the common material
+    bool batched = simd_evaluate && element_vb == VOL && !has_interpolate &&
+      !gridfunction_cfs.Size() && fels.Size() > 1;
+    if (batched)
+      {
+        const FiniteElement & fel0 = *fels[0];
+        const ElementTransformation & trafo0 = *trafos[0];
+        batched = typeid(fel0) != typeid(const MixedFiniteElement&) && !fel0.ComplexShapes() &&
+          !trafo0.IsComplex() && trafo0.SpaceDim() == fel0.Dim() && fel0.Dim() >= 1;
+        for (size_t i = 1; i < fels.Size() && batched; i++)
+          batched = typeid(*fels[i]) == typeid(fel0) &&
+            fels[i]->ElementType() == fel0.ElementType() &&
+            fels[i]->GetNDof() == fel0.GetNDof() &&
+            fels[i]->Order() == fel0.Order() &&
+            trafos[i]->GetElementIndex() == trafo0.GetElementIndex();
+      }
+    if (batched)
+      cf -> TraverseTree ([&] (CoefficientFunction & nodecf)
+                          {
+                            // trial and test functions are seeded with unit vectors
+                            auto proxy = dynamic_cast<ProxyFunction*> (&nodecf);
+                            if (proxy && (trial_proxies.Contains(proxy) || test_proxies.Contains(proxy)))
+                              return;
+                            if (nodecf.DependsOnElement()) batched = false;
+                          });
+    
+    if (batched)
+      {
+        HeapReset hr(lh);
+        FlatArray<FlatMatrix<double>> helmats(elmats.Size(), lh);
+        for (size_t i = 0; i < elmats.Size(); i++)
+          {
+            new (&helmats[i]) FlatMatrix<double> (elmats[i].Height(), elmats[i].Width(), lh);
+            helmats[i] = 0.0;
+          }
+        
+        bool symmetric_batch = true;
+        try
+          {
+            Switch<3> (fels[0]->Dim()-1, [&] (auto DM)
+                       {
+                         T_CalcElementMatricesBatched<DM.value+1> (fels, trafos, helmats, symmetric_batch, lh);
+                       });
+            for (size_t i = 0; i < elmats.Size(); i++)
+              elmats[i] += helmats[i];
+            symmetric_so_far &= symmetric_batch;
+            return;
+          }
+        catch (ExceptionNOSIMD e)
+          {
+            cout << IM(6) << e.What() << endl
+                 << "switching to element-wise evaluation" << endl;
+          }
+      }
+    
+    BilinearFormIntegrator::CalcElementMatricesAdd (fels, trafos, elmats, symmetric_so_far, lh);
+  }
+
+  template <int D>
+  void SymbolicBilinearFormIntegrator ::
+  T_CalcElementMatricesBatched (FlatArray<const FiniteElement*> fels,
+                                FlatArray<const ElementTransformation*> trafos,
+                                FlatArray<FlatMatrix<double>> elmats,
+                                bool & symmetric_so_far,
+                                LocalHeap & lh) const
+  {
+    static Timer t("SymbolicBFI::CalcElementMatricesBatched", 2);
+    ThreadRegionTimer reg(t, TaskManager::GetThreadId());
+    constexpr size_t W = SIMD<double>::Size();
+
+    size_t nel = fels.Size();
+    const SIMD_IntegrationRule & ir = Get_SIMD_IntegrationRule (*fels[0], lh);
+    size_t npack = ir.Size();
+    size_t nip = min(ir.GetNIP(), npack*W);
+
+    // element-wise mapped rules, needed for the shape functions
+    FlatArray<SIMD_MappedIntegrationRule<D,D>*> mirs(nel, lh);
+    for (size_t e = 0; e < nel; e++)
+      mirs[e] = &static_cast<SIMD_MappedIntegrationRule<D,D>&> ((*trafos[e])(ir, lh));
+
+    // all points of all elements, densely packed into SIMD lanes
+    size_t ntot = nel*nip;
+    auto source = [&] (size_t g, int & lane) -> const SIMD<MappedIntegrationPoint<D,D>> &
+      {
+        g = min(g, ntot-1);
+        size_t q = g % nip;
+        lane = q % W;
+        return (*mirs[g/nip])[q/W];
+      };
+
+    SIMD_IntegrationRule bir(ntot, lh);
+    for (size_t p = 0; p < bir.Size(); p++)
+      bir[p] = [&] (int i)
+        {
+          size_t g = min(p*W+i, ntot-1);
+          size_t q = g % nip;
+          IntegrationPoint ip = ir[q/W][q%W];
+          if (p*W+i >= ntot) ip.SetWeight(0);
+          return ip;
+        };
+
+    SIMD_MappedIntegrationRule<D,D> bmir(bir, *trafos[0], 0, lh);
+    for (size_t p = 0; p < bir.Size(); p++)
+      {
+        auto & mip = bmir[p];
+        for (int i = 0; i < D; i++)
+          mip.Point()(i) = SIMD<double> ([&] (int l)
+                                         {
+                                           int lane;
+                                           auto & smip = source(p*W+l, lane);
+                                           return smip.GetPoint()(i)[lane];
+                                         });
+        for (int i = 0; i < D; i++)
+          for (int j = 0; j < D; j++)
+            mip.Jacobian()(i,j) = SIMD<double> ([&] (int l)
+                                                {
+                                                  int lane;
+                                                  auto & smip = source(p*W+l, lane);
+                                                  return smip.GetJacobian()(i,j)[lane];
+                                                });
+        mip.Compute();
+      }
+
+    FlatVector<SIMD<double>> bweights(bir.Size(), lh);
+    for (size_t p = 0; p < bir.Size(); p++)
+      bweights(p) = bmir[p].GetWeight();
+    
+    auto save_userdata = trafos[0]->PushUserData();
+    ProxyUserData ud;
+    const_cast<ElementTransformation&>(*trafos[0]).userdata = &ud;
+
+    const FiniteElement & fel = *fels[0];
+    size_t nd = elmats[0].Width();
+    int k1 = 0;
+    int k1nr = 0;
+    for (auto proxy1 : trial_proxies)
+      {
+        int l1 = 0;
+        int l1nr = 0;
+        for (auto proxy2 : test_proxies)
+          {
+            size_t dim_proxy1 = proxy1->Dimension();
+            size_t dim_proxy2 = proxy2->Dimension();
+            size_t tt_pair = l1nr*trial_proxies.Size()+k1nr;
+            bool is_nonzero = nonzeros_proxies(tt_pair);
+            bool is_diagonal = diagonal_proxies(tt_pair);
+            
+            if (is_nonzero)
+              {
+                HeapReset hr(lh);
+                bool samediffop = same_diffops(tt_pair);
+                auto used = [&] (size_t l, size_t k)
+                  { return is_diagonal ? (k == l) : nonzeros(l1+l, k1+k); };
+                
+                // weighted D-matrix at all points of all elements
+                FlatMatrix<SIMD<double>> proxyvalues(dim_proxy1*dim_proxy2, bir.Size(), lh);
+                for (size_t k = 0, kk = 0; k < dim_proxy1; k++)
+                  for (size_t l = 0; l < dim_proxy2; l++, kk++)
+                    if (used(l, k))
+                      {
+                        ud.trialfunction = proxy1;
+                        ud.trial_comp = k;
+                        ud.testfunction = proxy2;
+                        ud.test_comp = l;
+                        cf -> Evaluate (bmir, proxyvalues.Rows(kk,kk+1));
+                        for (size_t p = 0; p < bir.Size(); p++)
+                          proxyvalues(kk,p) *= bweights(p);
+                      }
+
+                IntRange r1 = proxy1->Evaluator()->UsedDofs(fel);
+                IntRange r2 = proxy2->Evaluator()->UsedDofs(fel);
+                
+                FlatMatrix<SIMD<double>> dvals(dim_proxy1*dim_proxy2, npack, lh);
+                FlatMatrix<SIMD<double>> bbmat1(nd*dim_proxy1, npack, lh);
+                FlatMatrix<SIMD<double>> bdbmat1(nd*dim_proxy2, npack, lh);
+                FlatMatrix<SIMD<double>> bbmat2 = samediffop ?
+                  bbmat1 : FlatMatrix<SIMD<double>>(nd*dim_proxy2, npack, lh);
+                FlatMatrix<SIMD<double>> hbdbmat1(nd, dim_proxy2*npack, bdbmat1.Data());
+                FlatMatrix<SIMD<double>> hbbmat2(nd, dim_proxy2*npack, bbmat2.Data());
+
+                symmetric_so_far &= samediffop && is_diagonal;
+                
+                for (size_t e = 0; e < nel; e++)
+                  {
+                    // back to the lane layout of the element rule
+                    for (size_t k = 0, kk = 0; k < dim_proxy1; k++)
+                      for (size_t l = 0; l < dim_proxy2; l++, kk++)
+                        if (used(l, k))
+                          for (size_t i = 0; i < npack; i++)
+                            dvals(kk,i) = SIMD<double> ([&] (int lane)
+                                                        {
+                                                          size_t q = i*W+lane;
+                                                          if (q >= nip) return 0.0;
+                                                          size_t g = e*nip+q;
+                                                          return proxyvalues(kk, g/W)[g%W];
+                                                        });
+                    
+                    proxy1->Evaluator()->CalcMatrix(*fels[e], *mirs[e], bbmat1);
+                    if (!samediffop)
+                      proxy2->Evaluator()->CalcMatrix(*fels[e], *mirs[e], bbmat2);
+
+                    hbdbmat1.Rows(r1) = 0.0;
+                    for (size_t j = 0; j < dim_proxy2; j++)
+                      for (size_t k = 0; k < dim_proxy1; k++)
+                        if (used(j, k))
+                          {
+                            auto dvals_jk = dvals.Row(k*dim_proxy2+j);
+                            auto bbmat1_k = bbmat1.RowSlice(k, dim_proxy1).Rows(r1);
+                            auto bdbmat1_j = bdbmat1.RowSlice(j, dim_proxy2).Rows(r1);
+                            for (size_t i = 0; i < npack; i++)
+                              bdbmat1_j.Col(i).Range(0,r1.Size()) += dvals_jk(i) * bbmat1_k.Col(i);
+                          }
+
+                    SliceMatrix<double> part_elmat = elmats[e].Rows(r2).Cols(r1);
+                    if (symmetric_so_far)
+                      {
+                        AddABtSym (hbbmat2.Rows(r2), hbdbmat1.Rows(r1), part_elmat);
+                        ExtendSymmetric (part_elmat);
+                      }
+                    else
+                      AddABt (hbbmat2.Rows(r2), hbdbmat1.Rows(r1), part_elmat);
+                  }
+              }
+            
+            l1 += proxy2->Dimension();
+            l1nr++;
+          }
+        k1 += proxy1->Dimension();
+        k1nr++;
+      }
+  }
+
+  
   void 
   SymbolicBilinearFormIntegrator ::
   CalcElementMatrix (const FiniteElement & fel,
@@ -4469,6 +4754,60 @@ namespace ngfem
       }
   }
   
+  template <typename T>
+  void SymbolicEnergy ::
+  EvaluateDirections (const ElementTransformation & trafo,
+                      const SIMD_BaseMappedIntegrationRule & mir,
+                      ProxyUserData & ud,
+                      FlatArray<ProxyUserData::Direction> directions,
+                      FlatMatrix<T> values, LocalHeap & lh) const
+  {
+    // the rule is repeated once per direction, such that the tree is
+    // traversed once for a batch of directions. Batches are limited to
+    // MAXPOINTS SIMD points
+    constexpr size_t MAXPOINTS = 256;
+    size_t np = mir.Size();
+    size_t batch = min2(directions.Size(), max2(size_t(1), MAXPOINTS / np));
+    if (batch == 0) return;
+    const SIMD_IntegrationRule & ir = mir.IR();
+    HeapReset hr(lh);
+
+    // rule and proxy values are repeated and mapped once for all batches
+    SIMD_IntegrationRule & irrep = *new (lh) SIMD_IntegrationRule (batch*np*SIMD<double>::Size(), lh);
+    for (size_t b = 0; b < batch; b++)
+      for (size_t i = 0; i < np; i++)
+        irrep[b*np+i] = ir[i];
+    auto & mirrep = trafo(irrep, lh);
+
+    ProxyUserData udrep(trial_proxies.Size(), lh);
+    udrep.fel = ud.fel;
+    for (ProxyFunction * proxy : trial_proxies)
+      {
+        auto val = ud.GetAMemory(proxy);
+        FlatMatrix<SIMD<double>> valrep(proxy->Dimension(), batch*np, lh);
+        for (size_t b = 0; b < batch; b++)
+          valrep.Cols(b*np, (b+1)*np) = val;
+        udrep.AssignMemory (proxy, valrep);
+      }
+    udrep.direction_blocksize = np;
+
+    // the last batch is filled up by repeating its last direction
+    FlatArray<ProxyUserData::Direction> batchdirs(batch, lh);
+    FlatMatrix<T> batchvalues(batch, np, lh);
+    
+    const_cast<ElementTransformation&>(trafo).userdata = &udrep;
+    for (size_t first = 0; first < directions.Size(); first += batch)
+      {
+        size_t nd = min2(batch, directions.Size()-first);
+        for (size_t b = 0; b < batch; b++)
+          batchdirs[b] = directions[first+min2(b, nd-1)];
+        udrep.directions.Assign (batchdirs);
+        cf -> Evaluate (mirrep, FlatMatrix<T> (1, batch*np, batchvalues.Data()));
+        values.Rows(first, first+nd) = batchvalues.Rows(0, nd);
+      }
+    const_cast<ElementTransformation&>(trafo).userdata = &ud;
+  }
+  
   void SymbolicEnergy :: AddLinearizedElementMatrix (const FiniteElement & fel,
                                                      const ElementTransformation & trafo, 
                                                      // ProxyUserData & ud, 
@@ -4498,28 +4837,57 @@ namespace ngfem
 
 
     
-            FlatMatrix<AutoDiffDiff<1,SIMD<double>>> ddval(1, mir.Size(), lh);
-            FlatArray<FlatMatrix<SIMD<double>>> diags(trial_proxies.Size(), lh);
-            for (int k1 : Range(trial_proxies))
+            // all second derivatives needed for the Hessian are evaluated
+            // in one sweep over the expression tree: direction e_k gives
+            // the diagonal, e_k+e_l the mixed entries by polarization.
+            // Pairs which are structurally zero (NonZeroPattern) are skipped
+            size_t ncomp = trial_cum.Last();
+            FlatMatrix<int> dirnr(ncomp, ncomp, lh);
+            dirnr = -1;
+            ArrayMem<ProxyUserData::Direction, 100> directions;
+            auto add_direction = [&] (int k1, int k, int l1, int l)
               {
-                auto proxy = trial_proxies[k1];
-                new(&diags[k1]) FlatMatrix<SIMD<double>>(proxy->Dimension(), mir.Size(), lh);
-                if (nonzeros_proxies(k1,k1))
-                  for (int k = 0; k < proxy->Dimension(); k++)
-                    {
-                      ud.trialfunction = proxy;
-                      ud.trial_comp = k;
-                      ud.testfunction = proxy;
-                      ud.test_comp = k;
-                      // cf -> EvaluateDDeriv (mir, AFlatMatrix<>(val), AFlatMatrix<>(deriv), AFlatMatrix<> (diags[k1].Rows(k,k+1)));
-                      auto diagrow = diags[k1].Row(k);
-                      cf -> Evaluate (mir, ddval);
-                      for (auto i : Range(diagrow))
-                        diagrow(i) = ddval(i).DDValue(0);
-                    }
-                else
-                  diags[k1] = 0.0;
-              }
+                ProxyUserData::Direction dir;
+                dir.trialfunction = trial_proxies[k1];
+                dir.trial_comp = k;
+                dir.testfunction = trial_proxies[l1];
+                dir.test_comp = l;
+                int kk = trial_cum[k1]+k, ll = trial_cum[l1]+l;
+                dirnr(kk,ll) = dirnr(ll,kk) = directions.Size();
+                directions.Append (dir);
+              };
+
+            for (int k1 : Range(trial_proxies))
+              if (nonzeros_proxies(k1,k1))
+                for (int k = 0; k < trial_proxies[k1]->Dimension(); k++)
+                  if (nonzeros(trial_cum[k1]+k, trial_cum[k1]+k))
+                    add_direction (k1, k, k1, k);
+            
+            for (int k1 : Range(trial_proxies))
+              for (int l1 : Range(trial_proxies))
+                {
+                  if (!nonzeros_proxies(k1,l1) || k1 < l1) continue;
+                  for (int k = 0; k < trial_proxies[k1]->Dimension(); k++)
+                    for (int l = 0; l < trial_proxies[l1]->Dimension(); l++)
+                      if ( (k1 != l1 || k < l) && nonzeros(trial_cum[k1]+k, trial_cum[l1]+l))
+                        add_direction (k1, k, l1, l);
+                }
+
+            FlatMatrix<SIMD<double>> ddvalues(directions.Size(), mir.Size(), lh);
+            {
+              ThreadRegionTimer reg(tdmat, tid);
+              HeapReset hr(lh);
+              FlatMatrix<AutoDiffDiff<1,SIMD<double>>> ddval(directions.Size(), mir.Size(), lh);
+              EvaluateDirections (trafo, mir, ud, directions, ddval, lh);
+              for (size_t i = 0; i < ddval.Height(); i++)
+                for (size_t j = 0; j < ddval.Width(); j++)
+                  ddvalues(i,j) = ddval(i,j).DDValue(0);
+            }
+
+            FlatVector<SIMD<double>> zero(mir.Size(), lh);
+            zero = SIMD<double>(0.0);
+            auto ddrow = [&] (int kk, int ll) -> FlatVector<SIMD<double>>
+              { return dirnr(kk,ll) >= 0 ? ddvalues.Row(dirnr(kk,ll)) : zero; };
 
             for (int k1 : Range(trial_proxies))
               for (int l1 : Range(trial_proxies))
@@ -4536,39 +4904,17 @@ namespace ngfem
                   FlatMatrix<SIMD<double>> proxyvalues2(dim_proxy1*dim_proxy2, mir.Size(), lh);
 
                   {
-                  ThreadRegionTimer reg(tdmat, tid);
+                  ThreadRegionTimer reg(tdmat2, tid);
                   for (int k = 0; k < dim_proxy1; k++)
                     for (int l = 0; l < dim_proxy2; l++)
                       {
-                        ud.trialfunction = proxy1;
-                        ud.trial_comp = k;
-                        ud.testfunction = proxy2;
-                        ud.test_comp = l;
+                        int kk = trial_cum[k1]+k, ll = trial_cum[l1]+l;
                         auto proxyrow = proxyvalues2.Row(k*dim_proxy2+l);
-
-                        if (nonzeros(trial_cum[k1]+k, trial_cum[l1]+l))
-                          {
-                            // cf -> EvaluateDDeriv (mir, AFlatMatrix<>(val), AFlatMatrix<>(deriv), AFlatMatrix<> (dderiv));
-                            // proxyrow = dderiv.Row(0);
-
-                            if (k1 != l1 || k <= l)
-                              {
-                                cf -> Evaluate (mir, ddval);
-                                for (auto i : Range(proxyrow))
-                                  proxyrow(i) = ddval(i).DDValue(0);
-                              }
-                            if (k1 == l1 && k < l) // symmetric
-                              proxyvalues2.Row(l*dim_proxy2+k) = proxyrow;
-                          }
-                        else
-                          {
-                            // dderiv = 0.0;
-                            proxyrow = 0.0;
-                          }
+                        proxyrow = ddrow(kk,ll);
                         if (proxy1 != proxy2 || k != l)  // computed mixed second derivatives
                           {
-                            proxyrow -= diags[k1].Row(k);
-                            proxyrow -= diags[l1].Row(l);
+                            proxyrow -= ddrow(kk,kk);
+                            proxyrow -= ddrow(ll,ll);
                             proxyrow *= 0.5;
                           }
                       }
@@ -4757,19 +5103,26 @@ namespace ngfem
                   proxy->Evaluator()->Apply(fel, mir, elx, ud.GetAMemory(proxy));
                 
                 ely = 0;
+                ArrayMem<ProxyUserData::Direction, 100> directions;
                 for (auto proxy : trial_proxies)
+                  for (int k = 0; k < proxy->Dimension(); k++)
+                    {
+                      ProxyUserData::Direction dir;
+                      dir.trialfunction = proxy;
+                      dir.trial_comp = k;
+                      directions.Append (dir);
+                    }
+                FlatMatrix<AutoDiff<1,SIMD<double>>> vals(directions.Size(), ir.Size(), lh);
+                EvaluateDirections (trafo, mir, ud, directions, vals, lh);
+
+                for (int k1 : Range(trial_proxies))
                   {
                     HeapReset hr(lh);
+                    auto proxy = trial_proxies[k1];
                     FlatMatrix<SIMD<double>> proxyvalues(proxy->Dimension(), ir.Size(), lh);
-                    FlatMatrix<AutoDiff<1,SIMD<double>>> vals(1, ir.Size(), lh);
                     for (int k = 0; k < proxy->Dimension(); k++)
-                      {
-                        ud.trialfunction = proxy;
-                        ud.trial_comp = k;
-                        cf -> Evaluate(mir, vals);
-                        for (size_t j = 0; j < ir.Size(); j++)
-                          proxyvalues(k,j) = vals(0,j).DValue(0);
-                      }
+                      for (size_t j = 0; j < ir.Size(); j++)
+                        proxyvalues(k,j) = vals(trial_cum[k1]+k,j).DValue(0);
 
                     for (size_t j = 0; j < ir.Size(); j++)
                       proxyvalues.Col(j) *= mir[j].GetWeight();
@@ -4805,19 +5158,26 @@ namespace ngfem
                     for (ProxyFunction * proxy : trial_proxies)
                       proxy->Evaluator()->Apply(fel, mir, elx, ud.GetAMemory(proxy));
                 
+                    ArrayMem<ProxyUserData::Direction, 100> directions;
                     for (auto proxy : trial_proxies)
+                      for (int k = 0; k < proxy->Dimension(); k++)
+                        {
+                          ProxyUserData::Direction dir;
+                          dir.trialfunction = proxy;
+                          dir.trial_comp = k;
+                          directions.Append (dir);
+                        }
+                    FlatMatrix<AutoDiff<1,SIMD<double>>> vals(directions.Size(), mir.Size(), lh);
+                    EvaluateDirections (trafo, mir, ud, directions, vals, lh);
+                    
+                    for (int k1 : Range(trial_proxies))
                       {
                         HeapReset hr(lh);
+                        auto proxy = trial_proxies[k1];
                         FlatMatrix<SIMD<double>> proxyvalues(proxy->Dimension(), mir.Size(), lh);
-                        FlatMatrix<AutoDiff<1,SIMD<double>>> vals(1, mir.Size(), lh);
                         for (int k = 0; k < proxy->Dimension(); k++)
-                          {
-                            ud.trialfunction = proxy;
-                            ud.trial_comp = k;
-                            cf -> Evaluate(mir, vals);
-                            for (size_t j = 0; j < mir.Size(); j++)
-                              proxyvalues(k,j) = vals(0,j).DValue(0);
-                          }
+                          for (size_t j = 0; j < mir.Size(); j++)
+                            proxyvalues(k,j) = vals(trial_cum[k1]+k,j).DValue(0);
                         
                         for (size_t j = 0; j < mir.Size(); j++)
                           proxyvalues.Col(j) *= mir[j].GetWeight();
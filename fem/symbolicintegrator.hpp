@@ -264,6 +264,19 @@ public:
   FlatVector<double> *trial_elvec = nullptr, *test_elvec = nullptr; // for shape-wise evaluate
   LocalHeap * lh = nullptr;
 
+  // derivatives in several directions within one evaluation: points
+  // [b*direction_blocksize, (b+1)*direction_blocksize) use directions[b]
+  // instead of trialfunction/testfunction
+  struct Direction
+  {
+    class ProxyFunction * trialfunction = nullptr;
+    int trial_comp = 0;
+    class ProxyFunction * testfunction = nullptr;
+    int test_comp = 0;
+  };
+  FlatArray<Direction> directions { 0, nullptr };
+  size_t direction_blocksize = 0;
+
   
   ProxyUserData ()
     : remember_first(0,nullptr), remember_second(0,nullptr), remember_asecond(0,nullptr),
@@ -690,6 +703,21 @@ public:
                           LocalHeap & lh) const override;    
 
     
+    NGS_DLL_HEADER virtual void
+    CalcElementMatricesAdd (FlatArray<const FiniteElement*> fels,
+                            FlatArray<const ElementTransformation*> trafos,
+                            FlatArray<FlatMatrix<double>> elmats,
+                            bool & symmetric_so_far,
+                            LocalHeap & lh) const override;
+
+    // quadrature points of all elements packed into SIMD lanes for the coefficient
+    template <int D>
+    void T_CalcElementMatricesBatched (FlatArray<const FiniteElement*> fels,
+                                       FlatArray<const ElementTransformation*> trafos,
+                                       FlatArray<FlatMatrix<double>> elmats,
+                                       bool & symmetric_so_far,
+                                       LocalHeap & lh) const;
+    
     template <typename SCAL, typename SCAL_SHAPES, typename SCAL_RES>
     void T_CalcElementMatrixAdd (const FiniteElement & fel,
                                  const ElementTransformation & trafo, 
@@ -959,6 +987,15 @@ public:
 			FlatVector<double> ely,
 			void * precomputed,
 			LocalHeap & lh) const;
+
+  protected:
+    // row b of values is the directional derivative in directions[b]
+    template <typename T>
+    void EvaluateDirections (const ElementTransformation & trafo,
+                             const SIMD_BaseMappedIntegrationRule & mir,
+                             ProxyUserData & ud,
+                             FlatArray<ProxyUserData::Direction> directions,
+                             FlatMatrix<T> values, LocalHeap & lh) const;
   };
   
 
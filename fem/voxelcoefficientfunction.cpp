@@ -1,24 +1,107 @@
-
 #include "voxelcoefficientfunction.hpp"
 
 namespace ngfem
 {
   template<typename T>
-  T VoxelCoefficientFunction<T> :: T_Evaluate(const BaseMappedIntegrationPoint& ip) const
+  VoxelCoefficientFunction<T> ::
+  VoxelCoefficientFunction(const Array<double>& _start,
+                           const Array<double>& _end,
+                           const Array<size_t>& _dim_vals,
+                           Array<T>&& _values,
+                           bool _linear,
+                           shared_ptr<CoefficientFunction> trafo,
+                           FlatArray<int> comp_dims,
+                           bool _blocked)
+    : CoefficientFunctionNoDerivative(1, is_same_v<T, Complex>),
+      start(_start), end(_end), dim_vals(_dim_vals),
+      own_values(move(_values)), linear(_linear), blocked(false), trafocf(trafo)
+  {
+    values.Assign(own_values);
+    if (comp_dims.Size())
+      SetDimensions(comp_dims);
+    if (trafocf && trafocf->Dimension() < start.Size())
+      throw Exception("VoxelCoefficient: trafocf has dimension " + ToString(trafocf->Dimension())
+                      + ", need " + ToString(start.Size()));
+    if (_blocked)
+      SetBlocked();
+  }
+
+  template<typename T>
+  VoxelCoefficientFunction<T> ::
+  VoxelCoefficientFunction(const Array<double>& _start,
+                           const Array<double>& _end,
+                           const Array<size_t>& _dim_vals,
+                           FlatArray<T> _values,
+                           shared_ptr<void> owner,
+                           bool _linear,
+                           shared_ptr<CoefficientFunction> trafo,
+                           FlatArray<int> comp_dims)
+    : CoefficientFunctionNoDerivative(1, is_same_v<T, Complex>),
+      start(_start), end(_end), dim_vals(_dim_vals),
+      values(_values), values_owner(owner), linear(_linear), blocked(false), trafocf(trafo)
   {
-    // static Timer t("VoxelCF::Eval");
-    // RegionTracer reg(TaskManager::GetThreadId(), t);
+    if (comp_dims.Size())
+      SetDimensions(comp_dims);
+    if (trafocf && trafocf->Dimension() < start.Size())
+      throw Exception("VoxelCoefficient: trafocf has dimension " + ToString(trafocf->Dimension())
+                      + ", need " + ToString(start.Size()));
+  }
+
+  template<typename T>
+  void VoxelCoefficientFunction<T> :: SetBlocked()
+  {
+    static Timer t("VoxelCF::SetBlocked"); RegionTimer reg(t);
+    size_t ncomp = Dimension();
+    nblocks.SetSize(dim_vals.Size());
+    size_t blocksize = 1, nbtotal = 1;
+    for (auto i : Range(dim_vals))
+      {
+        nblocks[i] = (dim_vals[i] + BS - 1) / BS;
+        nbtotal *= nblocks[i];
+        blocksize *= BS;
+      }
 
-    T result = 0.;
+    Array<T> blocked_values(nbtotal * blocksize * ncomp);
+    blocked_values = T(0.0);
+    blocked = true;
+    Switch<3> (dim_vals.Size()-1, [&] (auto ICDIM) {
+        constexpr int DIM = ICDIM.value+1;
+        size_t nx = dim_vals[0];
+        size_t nrows = values.Size() / (nx*ncomp);
+        ParallelFor (nrows, [&] (size_t row)
+          {
+            size_t ind[DIM];
+            size_t r = row;
+            for (int i = 1; i < DIM; i++)
+              {
+                ind[i] = r % dim_vals[i];
+                r /= dim_vals[i];
+              }
+            for (size_t ix = 0; ix < nx; ix++)
+              {
+                ind[0] = ix;
+                size_t dst = this->template Index<DIM>(ind) * ncomp;
+                size_t src = (row * nx + ix) * ncomp;
+                for (size_t c = 0; c < ncomp; c++)
+                  blocked_values[dst+c] = values[src+c];
+              }
+          });
+      });
+    own_values = move(blocked_values);
+    values.Assign(own_values);
+    values_owner = nullptr;
+  }
+
+  template<typename T>
+  void VoxelCoefficientFunction<T> :: Lookup(const double * pnt, T * result) const
+  {
+    size_t ncomp = Dimension();
     Switch<3> (start.Size()-1, [&] (auto ICDIM) {
         constexpr int DIM = ICDIM.value+1;
-        auto pnt = ip.GetPoint();
-        if (trafocf)
-          trafocf->Evaluate(ip,pnt);
 
         size_t ind[DIM];
-        size_t weight[DIM];
-        
+        double weight[DIM];
+
         for(auto i : Range(DIM))
           {
             auto nvals = linear ? dim_vals[i] - 1 : dim_vals[i];
@@ -34,137 +117,170 @@ namespace ngfem
 
         if(!linear)
           {
-            size_t offset = dim_vals[0];
-            size_t index = ind[0];
-            for(auto i : IntRange(1,DIM))
-              {
-                index += offset * ind[i];
-                offset *= dim_vals[i];
-              }
-            result = values[index];
+            size_t index = this->template Index<DIM>(ind) * ncomp;
+            for (size_t c = 0; c < ncomp; c++)
+              result[c] = values[index+c];
             return;
           }
 
+        for (size_t c = 0; c < ncomp; c++)
+          result[c] = 0.;
         constexpr int numind = 1 << DIM;
-        size_t indices[numind];
-        double tot_weight[numind];
-
-        indices[0] = ind[0];
-        indices[1] = min2(ind[0]+1, dim_vals[0]-1);
-        tot_weight[0] = weight[0];
-        tot_weight[1] = 1.-weight[0];
-        size_t offset = dim_vals[0];
-        size_t indsize = 2;
-        
-        for(auto i : IntRange(1, DIM))
+        for (int corner = 0; corner < numind; corner++)
           {
-            for(auto j : Range(indsize))
-              {
-                auto indplus1 = min2(ind[i]+1, dim_vals[i]-1);
-                indices[indsize + j] = offset * indplus1 + indices[j];
-                indices[j] += offset * ind[i];
-                tot_weight[indsize + j] = (1.-weight[i]) * tot_weight[j];
-                tot_weight[j] *= weight[i];
-              }
-            indsize *= 2;
-            offset *= dim_vals[i];
+            size_t cind[DIM];
+            double w = 1.;
+            for (int i = 0; i < DIM; i++)
+              if (corner & (1 << i))
+                {
+                  cind[i] = min2(ind[i]+1, dim_vals[i]-1);
+                  w *= 1.-weight[i];
+                }
+              else
+                {
+                  cind[i] = ind[i];
+                  w *= weight[i];
+                }
+            size_t index = this->template Index<DIM>(cind) * ncomp;
+            for (size_t c = 0; c < ncomp; c++)
+              result[c] += w * values[index+c];
           }
-        
-        for(auto i : Range(numind))
-          result += tot_weight[i] * values[indices[i]];
       });
-    return result;
-
+  }
 
-    /*
-    auto pnt = ip.GetPoint();
-    if (trafocf)
-      trafocf->Evaluate(ip,pnt);
-    
-    ArrayMem<size_t, 3> ind;
-    ArrayMem<double, 3> weight;
-    for(auto i : Range(start))
+  template<typename T>
+  Complex VoxelCoefficientFunction<T> :: EvaluateComplex(const BaseMappedIntegrationPoint& ip) const
+  {
+    if constexpr(is_same_v<T, Complex>)
       {
-        auto nvals = linear ? dim_vals[i] - 1 : dim_vals[i];
-        double len = (end[i] - start[i])/nvals;
-        double coord = min2(end[i], max2(start[i], pnt[i]));
-        if(!linear && coord == end[i])
-          coord *= (1-1e-12);
-        double pos = (coord - start[i])/len;
-        ind.Append(pos);
-        if(linear)
-          weight.Append(1.-(pos-ind[i]));
+        Vector<Complex> res(Dimension());
+        Evaluate(ip, res);
+        return res(0);
       }
+    throw Exception("Complex evaluate for real VoxelCoefficient called!");
+  }
 
-    if(!linear)
+  template<typename T>
+  void VoxelCoefficientFunction<T> :: Evaluate(const BaseMappedIntegrationPoint& mip, FlatVector<Complex> hvalues) const
+  {
+    ArrayMem<double, 3> pnt(max2(mip.GetPoint().Size(), start.Size()));
+    pnt = 0.;
+    if (trafocf)
       {
-        size_t offset = dim_vals[0];
-        size_t index = ind[0];
-        for(auto i : IntRange(1,ind.Size()))
-          {
-            index += offset * ind[i];
-            offset *= dim_vals[i];
-          }
-        return values[index];
+        pnt.SetSize(trafocf->Dimension());
+        trafocf->Evaluate(mip, FlatVector<>(pnt.Size(), pnt.Data()));
       }
+    else
+      for (auto i : Range(mip.GetPoint()))
+        pnt[i] = mip.GetPoint()(i);
 
-    Array<size_t> indices(pow(2, ind.Size()));
-    Array<double> tot_weight(indices.Size());
-
-    indices[0] = ind[0];
-    indices[1] = min2(ind[0]+1, dim_vals[0]-1);
-    tot_weight[0] = weight[0];
-    tot_weight[1] = 1.-weight[0];
-    size_t offset = dim_vals[0];
-    size_t indsize = 2;
+    STACK_ARRAY(T, res, Dimension());
+    Lookup(pnt.Data(), res);
+    for (auto c : Range(Dimension()))
+      hvalues(c) = res[c];
+  }
 
-    for(auto i : IntRange(1, ind.Size()))
+  template<typename T>
+  void VoxelCoefficientFunction<T> :: Evaluate(const BaseMappedIntegrationPoint& mip, FlatVector<> hvalues) const
+  {
+    if constexpr(is_same_v<T, double>)
       {
-        for(auto j : Range(indsize))
+        ArrayMem<double, 3> pnt(max2(mip.GetPoint().Size(), start.Size()));
+        pnt = 0.;
+        if (trafocf)
           {
-            auto indplus1 = min2(ind[i]+1, dim_vals[i]-1);
-            indices[indsize + j] = offset * indplus1 + indices[j];
-            indices[j] += offset * ind[i];
-            tot_weight[indsize + j] = (1.-weight[i]) * tot_weight[j];
-            tot_weight[j] *= weight[i];
+            pnt.SetSize(trafocf->Dimension());
+            trafocf->Evaluate(mip, FlatVector<>(pnt.Size(), pnt.Data()));
           }
-        indsize *= 2;
-        offset *= dim_vals[i];
+        else
+          for (auto i : Range(mip.GetPoint()))
+            pnt[i] = mip.GetPoint()(i);
+        Lookup(pnt.Data(), hvalues.Data());
+        return;
       }
-
-    T result = 0.;
-    for(auto i : Range(indices))
-      result += tot_weight[i] * values[indices[i]];
-
-    return result;
-    */
+    throw Exception("Real evaluate for complex VoxelCoefficient called!");
   }
 
   template<typename T>
-  Complex VoxelCoefficientFunction<T> :: EvaluateComplex(const BaseMappedIntegrationPoint& ip) const
+  double VoxelCoefficientFunction<T> :: Evaluate(const BaseMappedIntegrationPoint& ip) const
   {
-    if constexpr(is_same_v<T, Complex>)
-      return T_Evaluate(ip);
-    throw Exception("Complex evaluate for real VoxelCoefficient called!");
+    if constexpr(is_same_v<T, double>)
+      {
+        Vector<> res(Dimension());
+        Evaluate(ip, res);
+        return res(0);
+      }
+    throw Exception("Real evaluate for complex VoxelCoefficient called!");
   }
 
   template<typename T>
-  void VoxelCoefficientFunction<T> :: Evaluate(const BaseMappedIntegrationPoint& mip, FlatVector<Complex> values) const
+  void VoxelCoefficientFunction<T> :: Evaluate(const BaseMappedIntegrationRule& ir, BareSliceMatrix<double> hvalues) const
   {
-    if constexpr(is_same_v<T, Complex>)
+    if constexpr(is_same_v<T, double>)
       {
-        values = T_Evaluate(mip);
+        if (ir.IsComplex() || (!trafocf && ir.DimSpace() < start.Size()))
+          {
+            CoefficientFunctionNoDerivative::Evaluate(ir, hvalues);
+            return;
+          }
+        size_t np = ir.Size();
+        STACK_ARRAY(double, hmem, trafocf ? np*trafocf->Dimension() : 1);
+        FlatMatrix<> tpoints(np, trafocf ? trafocf->Dimension() : 0, hmem);
+        if (trafocf)
+          trafocf->Evaluate(ir, tpoints);
+        SliceMatrix<> points = trafocf ? SliceMatrix<>(tpoints) : ir.GetPoints();
+        for (size_t i = 0; i < np; i++)
+          Lookup(&points(i,0), &hvalues(i,0));
         return;
       }
-    throw Exception("Complex evaluate for real VoxelCoefficient called!");
+    throw Exception("Real evaluate for complex VoxelCoefficient called!");
   }
 
   template<typename T>
-  double VoxelCoefficientFunction<T> :: Evaluate(const BaseMappedIntegrationPoint& ip) const
+  void VoxelCoefficientFunction<T> :: Evaluate(const BaseMappedIntegrationRule& ir, BareSliceMatrix<Complex> hvalues) const
+  {
+    for (size_t i = 0; i < ir.Size(); i++)
+      Evaluate(ir[i], hvalues.Row(i).AddSize(Dimension()));
+  }
+
+  template<typename T>
+  void VoxelCoefficientFunction<T> :: Evaluate(const SIMD_BaseMappedIntegrationRule& ir, BareSliceMatrix<SIMD<double>> hvalues) const
   {
     if constexpr(is_same_v<T, double>)
-      return T_Evaluate(ip);
-    throw Exception("Real evaluate for complex VoxelCoefficient called!");
+      {
+        // coordinates are transposed lane by lane, then the voxel lookups of
+        // all points of the rule run in one loop
+        constexpr size_t SW = SIMD<double>::Size();
+        size_t np = ir.Size();
+        size_t ncomp = Dimension();
+        size_t dim = start.Size();
+        if (ir.DimSpace() < dim && !trafocf)
+          throw ExceptionNOSIMD("VoxelCoefficient: space dimension smaller than voxel dimension");
+
+        STACK_ARRAY(SIMD<double>, hmem, trafocf ? np*trafocf->Dimension() : 1);
+        FlatMatrix<SIMD<double>> tpoints(trafocf ? trafocf->Dimension() : 0, np, hmem);
+        if (trafocf)
+          trafocf->Evaluate(ir, tpoints);
+        auto points = ir.GetPoints();
+
+        double pnt[SW][3];
+        STACK_ARRAY(double, res, SW*ncomp);
+        for (size_t i = 0; i < np; i++)
+          {
+            for (size_t k = 0; k < dim; k++)
+              {
+                SIMD<double> coord = trafocf ? tpoints(k,i) : points(i,k);
+                for (size_t j = 0; j < SW; j++)
+                  pnt[j][k] = coord[j];
+              }
+            for (size_t j = 0; j < SW; j++)
+              Lookup(pnt[j], &res[j*ncomp]);
+            for (size_t c = 0; c < ncomp; c++)
+              hvalues(c,i) = SIMD<double> ([&] (int j) { return res[j*ncomp+c]; });
+          }
+        return;
+      }
+    throw ExceptionNOSIMD("no SIMD evaluate for complex VoxelCoefficient");
   }
 
   template class VoxelCoefficientFunction<double>;
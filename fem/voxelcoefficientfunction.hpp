@@ -10,29 +10,71 @@ namespace ngfem
   {
     Array<double> start, end;
     Array<size_t> dim_vals;
-    Array<SCAL> values;
+    FlatArray<SCAL> values;         // ncomp values per voxel
+    Array<SCAL> own_values;
+    shared_ptr<void> values_owner;  // keeps external (e.g. memory-mapped) values alive
     bool linear;
+    // voxels stored in blocks of BS^dim, neighbouring voxels share cache lines
+    bool blocked;
+    Array<size_t> nblocks;
     shared_ptr<CoefficientFunction> trafocf;
+    static constexpr size_t BS = 8;
   public:
     VoxelCoefficientFunction(const Array<double>& _start,
                              const Array<double>& _end,
                              const Array<size_t>& _dim_vals,
                              Array<SCAL>&& _values,
                              bool _linear,
-                             shared_ptr<CoefficientFunction> trafo=nullptr)
-      : CoefficientFunctionNoDerivative(1, is_same_v<SCAL, Complex>),
-        start(_start), end(_end), dim_vals(_dim_vals),
-        values(move(_values)), linear(_linear), trafocf(trafo)
-    { ; }
+                             shared_ptr<CoefficientFunction> trafo=nullptr,
+                             FlatArray<int> comp_dims = Array<int>(),
+                             bool _blocked = false);
+
+    // values are used in place, owner keeps them alive
+    VoxelCoefficientFunction(const Array<double>& _start,
+                             const Array<double>& _end,
+                             const Array<size_t>& _dim_vals,
+                             FlatArray<SCAL> _values,
+                             shared_ptr<void> owner,
+                             bool _linear,
+                             shared_ptr<CoefficientFunction> trafo=nullptr,
+                             FlatArray<int> comp_dims = Array<int>());
 
     using CoefficientFunctionNoDerivative::Evaluate;
     double Evaluate(const BaseMappedIntegrationPoint& ip) const override;
     Complex EvaluateComplex(const BaseMappedIntegrationPoint& ip) const override;
 
+    void Evaluate(const BaseMappedIntegrationPoint& mip, FlatVector<> values) const override;
     void Evaluate(const BaseMappedIntegrationPoint& mip, FlatVector<Complex> values) const override;
+    void Evaluate(const BaseMappedIntegrationRule& ir, BareSliceMatrix<double> values) const override;
+    void Evaluate(const BaseMappedIntegrationRule& ir, BareSliceMatrix<Complex> values) const override;
+    void Evaluate(const SIMD_BaseMappedIntegrationRule& ir, BareSliceMatrix<SIMD<double>> values) const override;
 
   private:
-    SCAL T_Evaluate(const BaseMappedIntegrationPoint& ip) const;
+    void SetBlocked();
+
+    template <int DIM>
+    size_t Index (const size_t * ind) const
+    {
+      size_t index = 0;
+      if (!blocked)
+        {
+          for (int i = DIM-1; i >= 0; i--)
+            index = index * dim_vals[i] + ind[i];
+          return index;
+        }
+      size_t local = 0;
+      for (int i = DIM-1; i >= 0; i--)
+        {
+          index = index * nblocks[i] + ind[i] / BS;
+          local = local * BS + ind[i] % BS;
+        }
+      for (int i = 0; i < DIM; i++)
+        index *= BS;
+      return index + local;
+    }
+
+    // values at point pnt (of dimension start.Size())
+    void Lookup(const double * pnt, SCAL * result) const;
   };
 } // namespace ngfem
 
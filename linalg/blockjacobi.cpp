@@ -13,6 +13,8 @@ namespace ngla
   
   static mutex buildingblockupdate_mutex;
 
+  bool BaseBlockJacobiPrecond :: storefloat = false;
+
 
   BaseBlockJacobiPrecond :: 
   BaseBlockJacobiPrecond (shared_ptr<Table<int>> ablocktable)
@@ -496,6 +498,28 @@ namespace ngla
          NgProfiler::StopThreadTimer (tpar, TaskManager::GetThreadId());                  
        } );
 
+    if constexpr (is_same<TM,double>::value)
+      if (storefloat)
+        {
+          bigmem_float.SetSize (bigmem.Size());
+          ParallelForRange (bigmem.Size(), [&] (IntRange r)
+                            {
+                              for (auto i : r)
+                                bigmem_float[i] = bigmem[i];
+                            });
+          invdiag_float.SetSize (blocktable->Size());
+          size_t offset = 0;
+          for (auto i : Range (*blocktable))
+            {
+              size_t bs = (*blocktable)[i].Size();
+              new ( & invdiag_float[i] ) FlatMatrix<float> (bs, bs, bigmem_float.Addr(offset));
+              offset += sqr (bs);
+            }
+          // the double precision blocks point into bigmem
+          invdiag = Array<FlatMatrix<TM>> ();
+          bigmem = Array<TM> ();
+        }
+
     cout << IM(3) << "\rBuilding block " << blocktable->Size() << "/" << blocktable->Size() << flush;
     *testout << "block coloring";
 
@@ -620,7 +644,7 @@ namespace ngla
                  for (int j = 0; j < bs; j++)
                    hx(j) = fx((*blocktable)[i][j]);
                  
-                 hy = invdiag[i] * hx;
+                 MultInvDiag<false> (i, hx, hy);
                  
                  for (int j = 0; j < bs; j++)
                    fy((*blocktable)[i][j]) += s * hy(j);
@@ -665,7 +689,7 @@ namespace ngla
                  for (size_t j = 0; j < bs; j++)
                    hx(j) = fx(block[j]);
                  
-                 hy = Trans(invdiag[i]) * hx;
+                 MultInvDiag<true> (i, hx, hy);
                  
                  for (size_t j = 0; j < bs; j++)
                    fy(block[j]) += s * hy(j);
@@ -788,7 +812,7 @@ namespace ngla
                           hx(j) = fb(jj) - mat.RowTimesVector (jj, fx);
                         }
                       
-                      hy = (invdiag[i]) * hx;
+                      MultInvDiag<false> (i, hx, hy);
                       fx(block) += hy;
                     }
                 }
@@ -835,7 +859,7 @@ namespace ngla
                        hx(j) = fb(jj) - mat.RowTimesVector (jj, fx);
                      }
                    
-                   hy = (invdiag[i]) * hx;
+                   MultInvDiag<false> (i, hx, hy);
                    fx(block) += hy;
                  }
              });
@@ -859,6 +883,10 @@ namespace ngla
     static Timer t("BlockJacobiPrecondSymmetric ctor"); RegionTimer reg(t);    
     cout << IM(3) << "symmetric BlockJacobi Preconditioner 2, constructor called, #blocks = " << blocktable->Size() << endl;
 
+    if (storefloat)
+      throw Exception ("BlockSmoother.storefloat is not supported for symmetric storage, "
+                       "use a non-symmetric matrix");
+
     lowmem = false;
     // lowmem = true;
     
@@ -10,6 +10,61 @@
 namespace ngla
 {
 
+  /// y = m * x, or Trans(m) * x, for a matrix stored in single precision,
+  /// accumulated in double precision
+  template <bool TRANS, typename TV>
+  INLINE void MultFloatMatrix (FlatMatrix<float> m, FlatVector<TV> x, FlatVector<TV> y)
+  {
+    size_t n = m.Height();
+    if constexpr (!is_same<TV,double>::value)
+      {
+        for (size_t j = 0; j < n; j++)
+          {
+            TV sum(0.0);
+            for (size_t k = 0; k < n; k++)
+              sum += double(TRANS ? m(k,j) : m(j,k)) * x(k);
+            y(j) = sum;
+          }
+      }
+    else
+      {
+        constexpr size_t SW = SIMD<double>::Size();
+        if constexpr (TRANS)
+          {
+            // y = sum_j x(j) * row_j
+            y = 0.0;
+            for (size_t j = 0; j < n; j++)
+              {
+                const float * row = m.Data() + j*n;
+                SIMD<double> xj(x(j));
+                size_t k = 0;
+                for ( ; k+SW <= n; k += SW)
+                  {
+                    SIMD<double> mk([row,k] (int l) { return double(row[k+l]); });
+                    FMA (mk, xj, SIMD<double>(&y(k))).Store (&y(k));
+                  }
+                for ( ; k < n; k++)
+                  y(k) += double(row[k]) * x(j);
+              }
+          }
+        else
+          for (size_t j = 0; j < n; j++)
+            {
+              const float * row = m.Data() + j*n;
+              SIMD<double> sum(0.0);
+              size_t k = 0;
+              for ( ; k+SW <= n; k += SW)
+                sum = FMA (SIMD<double>([row,k] (int l) { return double(row[k+l]); }),
+                           SIMD<double>(&x(k)), sum);
+              double hsum = HSum(sum);
+              for ( ; k < n; k++)
+                hsum += double(row[k]) * x(k);
+              y(j) = hsum;
+            }
+      }
+  }
+
+
   /**
      Base class for Block - Jacobi and Block Gauss Seidel smoother.
   */
@@ -31,6 +86,9 @@ namespace ngla
 
     size_t nze;
   public:
+    /// new smoothers of real, non-symmetric matrices keep their block inverses in single precision
+    static bool storefloat;
+
     /// the blocktable define the blocks. ATTENTION: entries will be reordered !
     BaseBlockJacobiPrecond (shared_ptr<Table<int>> ablocktable);
 
@@ -119,6 +177,25 @@ namespace ngla
     Array<FlatMatrix<TM>> invdiag;
     /// the data for the inverses
     Array<TM> bigmem;
+    /// single precision inverses, used instead of invdiag if storefloat is set
+    Array<FlatMatrix<float>> invdiag_float;
+    Array<float> bigmem_float;
+
+    /// hy = invdiag[i] * hx, or with transposed block
+    template <bool TRANS>
+    INLINE void MultInvDiag (size_t i, FlatVector<TV_ROW> hx, FlatVector<TV_ROW> hy) const
+    {
+      if constexpr (is_same<TM,double>::value)
+        if (bigmem_float.Size())
+          {
+            MultFloatMatrix<TRANS> (invdiag_float[i], hx, hy);
+            return;
+          }
+      if constexpr (TRANS)
+        hy = Trans(invdiag[i]) * hx;
+      else
+        hy = invdiag[i] * hx;
+    }
 
   public:
     // typedef typename mat_traits<TM>::TV_ROW TVX;
@@ -176,6 +253,8 @@ namespace ngla
 	  int bs = (*blocktable)[i].Size();
 	  nels += bs*bs;
 	}
+      if (bigmem_float.Size())
+        return { MemoryUsage ("BlockJac", nels*sizeof(float), blocktable->Size()) };
       return { MemoryUsage ("BlockJac", nels*sizeof(TM), blocktable->Size()) };
     }
 
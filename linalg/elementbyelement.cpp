@@ -680,6 +680,10 @@ namespace ngla
     disjoint_cols = true;
     disjoint_rows = true;
 
+    // the x- and y-panels of one batch should stay in cache (~128KB)
+    batchsize = 16384 / max2(size_t(1), matrix.Height()+matrix.Width());
+    batchsize = min2(max2(batchsize, size_t(8)), size_t(256));
+
     BitArray used_col(h);
     used_col.Clear();
     for (auto col : col_dnums)
@@ -879,167 +883,159 @@ namespace ngla
   }
 
   
+  template <bool TRANS, typename TELNR>
+  void ConstantElementByElementMatrix ::
+  ApplyBatched (double s, FlatVector<> fx, FlatVector<> fy, size_t nel, TELNR elnr) const
+  {
+    static Timer tgemm("ConstantEBE gemm");
+    
+    auto & xdnums = TRANS ? col_dnums : row_dnums;
+    auto & ydnums = TRANS ? row_dnums : col_dnums;
+    size_t wx = TRANS ? matrix.Height() : matrix.Width();
+    size_t wy = TRANS ? matrix.Width() : matrix.Height();
+    size_t bs = min2(batchsize, nel);
+
+    Matrix<> hx(bs, wx);
+    Matrix<> hy(bs, wy);
+
+    for (size_t bi = 0; bi < nel; bi += bs)
+      {
+        size_t num = min2(bs, nel-bi);
+
+        // gather
+        for (size_t i = 0; i < num; i++)
+          hx.Row(i) = fx(xdnums[elnr(bi+i)]);
+
+        {
+          NgProfiler::AddThreadFlops(tgemm, TaskManager::GetThreadId(), num*wx*wy);
+          ThreadRegionTimer reg(tgemm, TaskManager::GetThreadId());
+          RegionTracer rt(TaskManager::GetThreadId(), tgemm);
+          if constexpr (TRANS)
+            hy.Rows(0, num) = hx.Rows(0, num) * matrix;
+          else
+            hy.Rows(0, num) = hx.Rows(0, num) * Trans(matrix);
+        }
+
+        // scatter-add
+        for (size_t i = 0; i < num; i++)
+          fy(ydnums[elnr(bi+i)]) += s * hy.Row(i);
+      }
+  }
+
+  template <bool TRANS>
+  void ConstantElementByElementMatrix ::
+  ApplyPrivatized (double s, FlatVector<> fx, FlatVector<> fy) const
+  {
+    size_t nel = row_dnums.Size();
+    size_t ny = fy.Size();
+    size_t ntasks = task_manager ? task_manager->GetNumThreads() : 1;
+    
+    // allocated per product, such that concurrent products do not share it
+    Matrix<> privy(ntasks, ny);
+    ParallelJob
+      ([&] (TaskInfo & ti)
+       {
+         auto myy = privy.Row(ti.task_nr);
+         myy = 0.0;
+         auto r = Range(nel).Split(ti.task_nr, ti.ntasks);
+         ApplyBatched<TRANS> (1, fx, myy, r.Size(),
+                              [r] (size_t i) { return r.First()+i; });
+       }, ntasks);
+
+    ParallelForRange
+      (ny, [&] (IntRange r)
+       {
+         for (size_t t = 0; t < ntasks; t++)
+           fy.Range(r) += s * privy.Row(t).Range(r);
+       });
+  }
+
+  bool ConstantElementByElementMatrix ::
+  PreferPrivatized (const Table<int> & coloring, size_t ny) const
+  {
+    // every color costs a synchronization of all threads, and small colors
+    // leave threads idle. Privatization costs zeroing and reducing one copy
+    // of y per thread, i.e. nthreads*ny entries through the shared memory bus.
+    constexpr size_t sync_cost = 16384;   // measured in vector entries
+    size_t nthreads = task_manager ? task_manager->GetNumThreads() : 1;
+    if (nthreads == 1) return false;
+    return nthreads * ny < coloring.Size() * sync_cost;
+  }
+  
   void ConstantElementByElementMatrix :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
   {
     static Timer t("ConstantEBE mult");
     static Timer tcol("ConstantEBE mult coloring");
-    static Timer tpmult("ConstantEBE mult parallel mult");
+    static Timer tpriv("ConstantEBE mult privatized");
 
     auto fx = x.FV<double>();
     auto fy = y.FV<double>();
 
-    if (!disjoint_cols)
+    if (disjoint_cols)
+      {
+        RegionTimer reg(t);
+        ParallelForRange
+          (row_dnums.Size(), [&] (IntRange r)
+           {
+             ApplyBatched<false> (s, fx, fy, r.Size(),
+                                  [r] (size_t i) { return r.First()+i; });
+           });
+      }
+    else if (PreferPrivatized (col_coloring, fy.Size()))
+      {
+        RegionTimer reg(tpriv);
+        ApplyPrivatized<false> (s, fx, fy);
+      }
+    else
       {
-        /*
-        RegionTimer reg(ts);
-        Vector<> hx(matrix.Width());
-        Vector<> hy(matrix.Height());
-        for (size_t i = 0; i < row_dnums.Size(); i++)
-          {
-            hx = fx(row_dnums[i]);
-            hy = matrix * hx;
-            fy(col_dnums[i]) += s * hy;
-          }
-        */
         RegionTimer reg(tcol);
-
         for (auto col : col_coloring)
           ParallelForRange
             (col.Size(), [&] (IntRange r)
              {
-               constexpr size_t BS = 128;
-               Matrix<> hx(BS, matrix.Width());
-               Matrix<> hy(BS, matrix.Height());
-               
-               for (size_t bi = r.First(); bi < r.Next(); bi+= BS)
-                 {
-                   size_t li = min2(bi+BS, r.Next());
-                   size_t num = li-bi;
-                   
-                   for (size_t i = 0; i < num; i++)
-                     hx.Row(i) = fx(row_dnums[col[bi+i]]);
-                   
-                   {
-                     RegionTracer rt(TaskManager::GetThreadId(), tpmult);
-                     hy.Rows(0, num) = hx.Rows(0, num) * Trans(matrix);
-                   }
-                   
-                   for (size_t i = 0; i < num; i++)
-                     fy(col_dnums[col[bi+i]]) += s * hy.Row(i);
-                 }
+               auto els = col.Range(r);
+               ApplyBatched<false> (s, fx, fy, els.Size(),
+                                    [els] (size_t i) { return els[i]; });
              });
       }
-    else
-      {
-        RegionTimer reg(t);
-        ParallelForRange
-          (row_dnums.Size(), [&] (IntRange r)
-           {
-             /*
-             Vector<> hx(matrix.Width());
-             Vector<> hy(matrix.Height());
-             for (auto i : r)
-               {
-                 hx = fx(row_dnums[i]);
-                 hy = matrix * hx;
-                 fy(col_dnums[i]) += s * hy;
-               }
-             */
-             constexpr size_t BS = 128;
-             Matrix<> hx(BS, matrix.Width());
-             Matrix<> hy(BS, matrix.Height());
-
-             for (size_t bi = r.First(); bi < r.Next(); bi+= BS)
-               {
-                 size_t li = min2(bi+BS, r.Next());
-                 size_t num = li-bi; 
-                 for (size_t i = 0; i < num; i++)
-                   hx.Row(i) = fx(row_dnums[bi+i]);
-                 {
-                   NgProfiler::AddThreadFlops(tpmult, TaskManager::GetThreadId(), num*matrix.Height()*matrix.Width());
-                   ThreadRegionTimer reg(tpmult, TaskManager::GetThreadId());
-                   RegionTracer rt(TaskManager::GetThreadId(), tpmult);
-                   hy.Rows(0, num) = hx.Rows(0, num) * Trans(matrix);
-                 }
-                 for (size_t i = 0; i < num; i++)
-                   fy(col_dnums[bi+i]) += s * hy.Row(i);
-               }
-           });
-      }
   }
   
   void ConstantElementByElementMatrix :: MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
   {
     static Timer t("ConstantEBE mult trans");
     static Timer tcol("ConstantEBE mult trans coloring");
-    static Timer tpmult("ConstantEBE mult trans mult");    
+    static Timer tpriv("ConstantEBE mult trans privatized");
 
     auto fx = x.FV<double>();
     auto fy = y.FV<double>();
     
-    if (!disjoint_rows)
-      { // use coloring
-        RegionTimer reg(tcol);
-
-        for (auto col : row_coloring)
-          ParallelForRange
-            (col.Size(), [&] (IntRange r)
-             {
-               constexpr size_t BS = 128;
-               Matrix<> hx(BS, matrix.Height());
-               Matrix<> hy(BS, matrix.Width());
-               
-               for (size_t bi = r.First(); bi < r.Next(); bi+= BS)
-                 {
-                   size_t li = min2(bi+BS, r.Next());
-                   size_t num = li-bi;
-                   
-                   for (size_t i = 0; i < num; i++)
-                     hx.Row(i) = fx(col_dnums[col[bi+i]]);
-                   
-                   {
-                     NgProfiler::AddThreadFlops(tpmult, TaskManager::GetThreadId(), num*matrix.Height()*matrix.Width());
-                     ThreadRegionTimer reg(tpmult, TaskManager::GetThreadId());
-                     RegionTracer rt(TaskManager::GetThreadId(), tpmult);
-                     hy.Rows(0, num) = hx.Rows(0, num) * matrix;
-                   }
-                   
-                   for (size_t i = 0; i < num; i++)
-                     fy(row_dnums[col[bi+i]]) += s * hy.Row(i);
-                 }
-             });
-      }
-    else
+    if (disjoint_rows)
       {
         RegionTimer reg(t);
         ParallelForRange
           (row_dnums.Size(), [&] (IntRange r)
            {
-             constexpr size_t BS = 128;
-             Matrix<> hx(BS, matrix.Height());
-             Matrix<> hy(BS, matrix.Width());
-
-             for (size_t bi = r.First(); bi < r.Next(); bi+= BS)
-               {
-                 size_t li = min2(bi+BS, r.Next());
-                 size_t num = li-bi;
-                 
-                 for (size_t i = 0; i < num; i++)
-                   hx.Row(i) = fx(col_dnums[bi+i]);
-                 
-                 {
-                   NgProfiler::AddThreadFlops(tpmult, TaskManager::GetThreadId(), num*matrix.Height()*matrix.Width());
-                   ThreadRegionTimer reg(tpmult, TaskManager::GetThreadId());
-                   RegionTracer rt(TaskManager::GetThreadId(), tpmult);
-                   
-                   hy.Rows(0, num) = hx.Rows(0, num) * matrix;
-                 }
-                 
-                 for (size_t i = 0; i < num; i++)
-                   fy(row_dnums[bi+i]) += s * hy.Row(i);
-               }
+             ApplyBatched<true> (s, fx, fy, r.Size(),
+                                 [r] (size_t i) { return r.First()+i; });
            });
       }
+    else if (PreferPrivatized (row_coloring, fy.Size()))
+      {
+        RegionTimer reg(tpriv);
+        ApplyPrivatized<true> (s, fx, fy);
+      }
+    else
+      {
+        RegionTimer reg(tcol);
+        for (auto col : row_coloring)
+          ParallelForRange
+            (col.Size(), [&] (IntRange r)
+             {
+               auto els = col.Range(r);
+               ApplyBatched<true> (s, fx, fy, els.Size(),
+                                   [els] (size_t i) { return els[i]; });
+             });
+      }
   }
 
 
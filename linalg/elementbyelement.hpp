@@ -127,6 +127,16 @@ namespace ngla
     Table<int> row_dnums;
     bool disjoint_rows, disjoint_cols;
     Table<int> row_coloring, col_coloring;
+    size_t batchsize;   // elements per gathered panel
+
+    // y(ydnums[el]) += s * M x(xdnums[el]) for a batch of elements, M = matrix or Trans(matrix)
+    template <bool TRANS, typename TELNR>
+    void ApplyBatched (double s, FlatVector<> fx, FlatVector<> fy,
+                       size_t nel, TELNR elnr) const;
+    // accumulate into thread-private copies of y instead of looping over colors
+    template <bool TRANS>
+    void ApplyPrivatized (double s, FlatVector<> fx, FlatVector<> fy) const;
+    bool PreferPrivatized (const Table<int> & coloring, size_t ny) const;
   public:
     ConstantElementByElementMatrix (size_t ah, size_t aw, Matrix<> amatrix,
                                     Table<int> acol_dnums, Table<int> arow_dnums);
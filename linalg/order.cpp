@@ -796,4 +796,354 @@ namespace ngla
     list[nr].degree = 0;
   }
 
+
+
+
+
+
+  /* 
+
+  Nested dissection ordering
+
+  Bisection by level structures from a pseudo-peripheral vertex,
+  the separator is the part of the median level adjacent to the next
+  level. See:
+
+  A. George and J.W.H. Liu
+  Computer Solution of Large Sparse Positive Definite Systems
+  Prentice-Hall, 1981
+
+  */
+
+  NestedDissectionOrdering :: NestedDissectionOrdering (Table<int> && agraph)
+    : n(agraph.Size()), nused(0), order(agraph.Size()), blocknr(agraph.Size()),
+      vertices(agraph.Size()), graph(move(agraph)), unused(n),
+      domain(n), level(n), domaincnt(0)
+  {
+    ParallelForRange (n, [&] (IntRange r)
+                      {
+                        unused.Range(r) = false;
+                        level.Range(r) = -1;
+                        blocknr.Range(r) = 0;
+                        order.Range(r) = -1;
+                        for (auto i : r)
+                          {
+                            domain[i].store (-1, memory_order_relaxed);
+                            vertices[i].Init(i);
+                            vertices[i].nconnected = 0;
+                            vertices[i].connected = nullptr;
+                          }
+                      });
+  }
+
+  NestedDissectionOrdering :: ~NestedDissectionOrdering ()
+  {
+    for (int i = 0; i < vertices.Size(); i++)
+      delete [] vertices[i].connected;
+  }
+
+  
+  void NestedDissectionOrdering :: Order()
+  {
+    static Timer t("NestedDissectionOrdering::Order");
+    static Timer tdis("NestedDissectionOrdering::Order - dissection");
+    RegionTimer reg(t);
+
+    Array<int> verts;
+    for (int i = 0; i < n; i++)
+      if (!unused[i])
+        verts.Append (i);
+    nused = verts.Size();
+
+    // all subgraphs of one level of the dissection are split in parallel
+    tdis.Start();
+    Array<Array<int>> parts;
+    Array<FlatArray<int>> results;
+    parts.Append (move(verts));
+    results.Append (order.Range(0, nused));
+    while (parts.Size())
+      {
+        Array<Array<int>> children(2*parts.Size());
+        ParallelFor (parts.Size(), [&] (size_t i)
+                     {
+                       Dissect (parts[i], results[i], children[2*i], children[2*i+1]);
+                     });
+
+        Array<Array<int>> nextparts;
+        Array<FlatArray<int>> nextresults;
+        for (size_t i = 0; i < parts.Size(); i++)
+          {
+            size_t na = children[2*i].Size(), nb = children[2*i+1].Size();
+            if (na)
+              {
+                nextparts.Append (move(children[2*i]));
+                nextresults.Append (results[i].Range(0, na));
+              }
+            if (nb)
+              {
+                nextparts.Append (move(children[2*i+1]));
+                nextresults.Append (results[i].Range(na, na+nb));
+              }
+          }
+        parts = move(nextparts);
+        results = move(nextresults);
+      }
+    tdis.Stop();
+
+    for (int i = 0, cnt = nused; i < n; i++)
+      if (unused[i])
+        order[cnt++] = i;
+
+    SymbolicFactorization();
+  }
+
+  
+
+  size_t NestedDissectionOrdering :: 
+  LevelStructure (int start, int id, FlatArray<int> verts,
+                  FlatArray<int> levelorder, Array<size_t> & firstinlevel)
+  {
+    for (int v : verts)
+      level[v] = -1;
+
+    levelorder[0] = start;
+    level[start] = 0;
+    
+    firstinlevel.SetSize0();
+    firstinlevel.Append (0);
+    firstinlevel.Append (1);
+
+    size_t cnt = 1;
+    for (int l = 0; firstinlevel[l] < firstinlevel[l+1]; l++)
+      {
+        for (size_t pos = firstinlevel[l]; pos < firstinlevel[l+1]; pos++)
+          for (int w : graph[levelorder[pos]])
+            if (domain[w].load(memory_order_relaxed) == id && level[w] == -1)
+              {
+                level[w] = l+1;
+                levelorder[cnt++] = w;
+              }
+        firstinlevel.Append (cnt);
+      }
+    // remove empty last level
+    firstinlevel.SetSize (firstinlevel.Size()-1);
+    return cnt;
+  }
+
+  
+  void NestedDissectionOrdering :: Dissect (FlatArray<int> verts, FlatArray<int> result,
+                                            Array<int> & parta, Array<int> & partb)
+  {
+    size_t nv = verts.Size();
+    if (nv == 0) return;
+    
+    int id = domaincnt++;
+    for (int v : verts)
+      domain[v].store (id, memory_order_relaxed);
+
+    Array<int> levelorder(nv);
+    Array<size_t> firstinlevel;
+
+    // find pseudo-peripheral vertex
+    int start = verts[0];
+    size_t nreached = LevelStructure (start, id, verts, levelorder, firstinlevel);
+    for (int iter = 0; iter < 5 && nreached == nv; iter++)
+      {
+        size_t numlevels = firstinlevel.Size()-1;
+        
+        // vertex of minimal degree in last level
+        int cand = levelorder[firstinlevel[numlevels-1]];
+        for (size_t pos : Range(firstinlevel[numlevels-1], firstinlevel[numlevels]))
+          if (graph[levelorder[pos]].Size() < graph[cand].Size())
+            cand = levelorder[pos];
+
+        LevelStructure (cand, id, verts, levelorder, firstinlevel);
+        if (firstinlevel.Size()-1 <= numlevels)
+          {
+            if (firstinlevel.Size()-1 < numlevels)
+              LevelStructure (start, id, verts, levelorder, firstinlevel);
+            break;
+          }
+        start = cand;
+      }
+
+    size_t numlevels = firstinlevel.Size()-1;
+    
+    if (nv <= leafsize || (nreached == nv && numlevels < 3))
+      {
+        // leaf: reverse Cuthill-McKee order of all components
+        size_t cnt = nreached;
+        while (cnt < nv)
+          {
+            int next = -1;
+            for (int v : verts)
+              if (level[v] == -1)
+                { next = v; break; }
+
+            // continue breadth first search in next component
+            size_t first = cnt;
+            levelorder[cnt++] = next;
+            level[next] = 0;
+            for (size_t pos = first; pos < cnt; pos++)
+              for (int w : graph[levelorder[pos]])
+                if (domain[w].load(memory_order_relaxed) == id && level[w] == -1)
+                  {
+                    level[w] = 0;
+                    levelorder[cnt++] = w;
+                  }
+          }
+        for (size_t i = 0; i < nv; i++)
+          result[nv-1-i] = levelorder[i];
+        return;
+      }
+
+    Array<int> separator;
+
+    if (nreached < nv)
+      {
+        // not connected: split off the component, no separator needed
+        for (size_t pos = 0; pos < nreached; pos++)
+          parta.Append (levelorder[pos]);
+        for (int v : verts)
+          if (level[v] == -1)
+            partb.Append (v);
+      }
+    else
+      {
+        // median level, both halfs must be non-empty
+        size_t median = 1;
+        while (median < numlevels-2 && firstinlevel[median+1] < nv/2)
+          median++;
+        
+        for (size_t pos : Range(firstinlevel[0], firstinlevel[median]))
+          parta.Append (levelorder[pos]);
+        for (size_t pos : Range(firstinlevel[median], firstinlevel[median+1]))
+          {
+            int v = levelorder[pos];
+            bool onseparator = false;
+            for (int w : graph[v])
+              if (domain[w].load(memory_order_relaxed) == id && level[w] == int(median)+1)
+                {
+                  onseparator = true;
+                  break;
+                }
+            if (onseparator)
+              separator.Append (v);
+            else
+              parta.Append (v);
+          }
+        for (size_t pos : Range(firstinlevel[median+1], nv))
+          partb.Append (levelorder[pos]);
+      }
+
+    // separator is eliminated last
+    size_t na = parta.Size(), nb = partb.Size();
+    for (size_t i = 0; i < separator.Size(); i++)
+      result[na+nb+i] = separator[i];
+  }
+
+  
+
+  void NestedDissectionOrdering :: SymbolicFactorization ()
+  {
+    static Timer t("NestedDissectionOrdering::SymbolicFactorization");
+    RegionTimer reg(t);
+
+    // position of vertex in elimination order
+    Array<int> inv(n);
+    ParallelFor (n, [&] (size_t i) { inv[i] = -1; });
+    ParallelFor (nused, [&] (size_t i) { inv[order[i]] = i; });
+
+    // elimination tree, Liu's algorithm with path compression
+    Array<int> parent(nused), ancestor(nused);
+    for (int k = 0; k < nused; k++)
+      {
+        parent[k] = -1;
+        ancestor[k] = -1;
+        for (int w : graph[order[k]])
+          {
+            int r = inv[w];
+            if (r < 0 || r >= k) continue;
+            while (ancestor[r] != -1 && ancestor[r] != k)
+              {
+                int next = ancestor[r];
+                ancestor[r] = k;
+                r = next;
+              }
+            if (ancestor[r] == -1)
+              {
+                ancestor[r] = k;
+                parent[r] = k;
+              }
+          }
+      }
+
+    // children in elimination tree, and nodes sorted by height 
+    Array<int> height(nused);
+    height = 0;
+    for (int k = 0; k < nused; k++)
+      if (parent[k] != -1)
+        height[parent[k]] = max2 (height[parent[k]], height[k]+1);
+    int maxheight = 0;
+    for (int h : height)
+      maxheight = max2 (maxheight, h);
+
+    TableCreator<int> creator_children(nused);
+    TableCreator<int> creator_levels(nused ? maxheight+1 : 0);
+    for ( ; !creator_children.Done(); creator_children++, creator_levels++)
+      for (int k = 0; k < nused; k++)
+        {
+          if (parent[k] != -1)
+            creator_children.Add (parent[k], k);
+          creator_levels.Add (height[k], k);
+        }
+    Table<int> children = creator_children.MoveTable();
+    Table<int> levels = creator_levels.MoveTable();
+
+    // column structure of the factor:
+    // struct(k) = adj(k) \cup_{children c} struct(c)  \ {0...k}
+    Array<Array<int>> colstruct(nused);
+    for (auto levelnodes : levels)
+      ParallelFor (levelnodes.Size(), [&] (size_t i)
+                   {
+                     int k = levelnodes[i];
+                     ArrayMem<int,100> hstruct;
+                     for (int w : graph[order[k]])
+                       if (inv[w] > k)
+                         hstruct.Append (inv[w]);
+                     for (int c : children[k])
+                       for (int j : colstruct[c])
+                         if (j > k)
+                           hstruct.Append (j);
+                     QuickSort (hstruct);
+
+                     size_t cnt = 0;
+                     for (size_t j = 0; j < hstruct.Size(); j++)
+                       if (j == 0 || hstruct[j] != hstruct[j-1])
+                         hstruct[cnt++] = hstruct[j];
+
+                     colstruct[k].SetSize (cnt);
+                     for (size_t j = 0; j < cnt; j++)
+                       colstruct[k][j] = hstruct[j];
+                   });
+
+    // supernodes: chains in the elimination tree with nested structure
+    for (int k = 0; k < nused; k++)
+      {
+        bool minion = k > 0 && parent[k-1] == k &&
+          colstruct[k-1].Size() == colstruct[k].Size()+1;
+        blocknr[k] = minion ? blocknr[k-1] : k;
+      }
+
+    ParallelFor (nused, [&] (size_t k)
+                 {
+                   if (blocknr[k] != int(k)) return;
+                   MDOVertex & v = vertices[order[k]];
+                   v.nconnected = colstruct[k].Size();
+                   v.connected = new int[v.nconnected];
+                   for (int j = 0; j < v.nconnected; j++)
+                     v.connected[j] = order[colstruct[k][j]];
+                 });
+  }
+
 }
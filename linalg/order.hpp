@@ -199,6 +199,65 @@ namespace ngla
   };
 
 
+
+  /*
+    Nested dissection ordering by recursive level-structure bisection.
+    Separators are eliminated last, all subgraphs of a level are split in parallel.
+    Provides order, blocknr and vertices as the MinimumDegreeOrdering, 
+    such that it can be used by the SparseCholesky.
+  */
+  class NestedDissectionOrdering
+  {
+  public:
+    ///
+    int n, nused;
+    ///
+    Array<int> order;
+    ///
+    Array<int> blocknr;
+    ///
+    Array<MDOVertex> vertices;
+  protected:
+    /// symmetric graph, without diagonal
+    Table<int> graph;
+    ///
+    Array<bool> unused;
+    /// subgraph id of every vertex during dissection,
+    /// shared by the tasks splitting the subgraphs in parallel
+    Array<atomic<int>> domain;
+    /// level in level-structure
+    Array<int> level;
+    ///
+    atomic<int> domaincnt;
+    
+  public:
+    /// subgraphs of that size are not dissected any further
+    static constexpr size_t leafsize = 64;
+
+    ///
+    NestedDissectionOrdering (Table<int> && agraph);
+    ///
+    ~NestedDissectionOrdering();
+    ///
+    void SetUnusedVertex (int v) { unused[v] = true; }
+    ///
+    void Order();
+    ///
+    int Size () const { return n; }
+
+  protected:
+    /// orders a small subgraph, or puts the separator at the end of result
+    /// and returns the two parts to be ordered in front of it
+    void Dissect (FlatArray<int> verts, FlatArray<int> result,
+                  Array<int> & parta, Array<int> & partb);
+    /// breadth first search within the domain, returns number of reached vertices
+    size_t LevelStructure (int start, int id, FlatArray<int> verts,
+                           FlatArray<int> levelorder, Array<size_t> & firstinlevel);
+    /// elimination tree, column structures and supernodes
+    void SymbolicFactorization ();
+  };
+
+
 }
 
 
@@ -1188,6 +1188,20 @@ inverse : string
                   }))
     ;
 
+  py::class_<SparseMatrixSELL<double>, shared_ptr<SparseMatrixSELL<double>>, BaseMatrix>
+    (m, "SparseMatrixSELL",
+     "sliced ELLPACK (SELL-C-sigma) copy of a real sparse matrix for SIMD matrix-vector products")
+    .def(py::init([] (const BaseMatrix & mat, size_t sigma)
+                  {
+                    if (auto ptr = dynamic_cast<const SparseMatrixTM<double>*> (&mat); ptr)
+                      return make_shared<SparseMatrixSELL<double>> (*ptr, sigma);
+                    throw Exception("cannot create SparseMatrixSELL");
+                  }), py::arg("mat"), py::arg("sigma")=256,
+         "sigma: rows are sorted by length within windows of sigma rows")
+    .def_property_readonly("nze", &SparseMatrixSELL<double>::NZE,
+                           "number of stored entries, including padding")
+    ;
+
   
   py::class_<BaseBlockJacobiPrecond, shared_ptr<BaseBlockJacobiPrecond>, BaseMatrix>
     (m, "BlockSmoother",
@@ -1198,6 +1212,8 @@ inverse : string
     .def("SmoothBack", &BaseBlockJacobiPrecond::GSSmoothBack,
          py::arg("x"), py::arg("b"), py::arg("steps")=1, py::call_guard<py::gil_scoped_release>(),
          "performs steps block-Gauss-Seidel iterations for the linear system A x = b in reverse order")
+    .def_readwrite_static("storefloat", &BaseBlockJacobiPrecond::storefloat,
+                          "keep block inverses of new smoothers for real, non-symmetric matrices in single precision")
     ;
 
   py::class_<BaseJacobiPrecond, shared_ptr<BaseJacobiPrecond>, BaseMatrix>
@@ -1221,6 +1237,16 @@ inverse : string
          "perform smoothing step (needs non-symmetric storage so symmetric sparse matrix)")
     ;
 
+  py::class_<SparseCholeskyOptions> (m, "SparseCholeskyOptions",
+                                     "default settings for new sparsecholesky factorizations")
+    .def_readwrite_static("supernodal", &SparseCholeskyOptions::supernodal,
+                          "use supernodal multifrontal factorization with dense panel updates")
+    .def_readwrite_static("ordering", &SparseCholeskyOptions::ordering,
+                          "fill-reducing ordering, 'minimumdegree' or 'nesteddissection'")
+    .def_readwrite_static("storefloat", &SparseCholeskyOptions::storefloat,
+                          "keep factors of real matrices in single precision (for preconditioning)")
+    ;
+  
   py::class_<SparseCholesky<double>, shared_ptr<SparseCholesky<double>>, SparseFactorization> (m, "SparseCholesky_d");
   py::class_<SparseCholesky<Complex>, shared_ptr<SparseCholesky<Complex>>, SparseFactorization> (m, "SparseCholesky_c");
   
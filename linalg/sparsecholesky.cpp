@@ -105,6 +105,12 @@ namespace ngla
 
 
 
+  bool SparseCholeskyOptions :: supernodal = false;
+  string SparseCholeskyOptions :: ordering = "minimumdegree";
+  bool SparseCholeskyOptions :: storefloat = false;
+
+
+
   template <class TM>
   void SetIdentity( TM &identity )
   {
@@ -125,15 +131,156 @@ namespace ngla
     : SparseFactorization (a, ainner, acluster), mat(a)
   { 
     static Timer t("SparseCholesky - total");
-    static Timer ta("SparseCholesky - allocate");
     RegionTimer reg(t);
     // (*testout) << "matrix = " << a << endl;
     // (*testout) << "diag a = ";
     // for ( int i=0; i<a.Height(); i++ ) (*testout) << i << ", " << a(i,i) << endl;
 
+    supernodal = SparseCholeskyOptions::supernodal;
+    ordering = SparseCholeskyOptions::ordering;
+    storefloat = SparseCholeskyOptions::storefloat;
+
+    Analyze (a);
+    FactorNew (a);
+    // only needed for refactorization, FactorNew sets them up again
+    fillpos = Array<size_t>();
+    pattern_firsti = Array<size_t>();
+    pattern_colnr = Array<int>();
+  }
+
+
+  
+  template <class TM>
+  void SparseCholeskyTM<TM> :: 
+  Analyze (const SparseMatrixTM<TM> & a)
+  {
+    static Timer t("SparseCholesky - analyze");
+    static Timer tet("SparseCholesky - elimination tree");
+    RegionTimer reg(t);
+
     int n = a.Height();
     height = n;
 
+    blocks.SetSize0();
+    microtasks.SetSize0();
+
+    if (ordering == "nesteddissection")
+      OrderNestedDissection (a);
+    else if (ordering == "minimumdegree")
+      OrderMinimumDegree (a);
+    else
+      throw Exception (string("SparseCholesky: unknown ordering '")+ordering
+                       +"', allowed are 'minimumdegree' and 'nesteddissection'");
+
+    int printstat = 0;
+    clock_t starttime, endtime;
+    starttime = clock();
+
+    size_t nblocks = blocks.Size()-1;
+    
+    // elimination tree of the supernodes:
+    // the parent is the block containing the first external dof
+    tet.Start();
+    Array<int> block_of_dof(nused);
+    ParallelFor (nblocks, [&] (size_t i)
+                 {
+                   block_of_dof[BlockDofs(i)] = i;
+                 });
+
+    Array<int> parent(nblocks);
+    ParallelFor (nblocks, [&] (size_t i)
+                 {
+                   parent[i] = -1;
+                   if (BlockDofs(i).Size() == 0) return;
+                   auto extdofs = BlockExtDofs(i);
+                   if (extdofs.Size())
+                     parent[i] = block_of_dof[extdofs[0]];
+                 });
+
+    TableCreator<int> creator_parent(nblocks);
+    TableCreator<int> creator_children(nblocks);
+    for ( ; !creator_parent.Done(); creator_parent++, creator_children++)
+      for (size_t i = 0; i < nblocks; i++)
+        if (parent[i] != -1)
+          {
+            creator_parent.Add (i, parent[i]);
+            creator_children.Add (parent[i], i);
+          }
+    block_etree = creator_parent.MoveTable();
+    block_children = creator_children.MoveTable();
+    tet.Stop();
+
+    diag.SetSize(nused);
+    // lfact.SetSize (nze);
+    lfact = NumaInterleavedArray<TM> (nze);
+
+    // lfact = TM(0.0);     // first touch
+    ParallelForRange (nze, [&] (IntRange r)
+                      {
+                        lfact.Range(r) = TM(0.0);
+                      });
+    lfact_float = Array<float>();
+    diag_float = Array<float>();
+    factor_is_float = false;
+    
+    endtime = clock();
+    if (printstat)
+      (cout) << "allocation time = "
+	     << double (endtime - starttime) / CLOCKS_PER_SEC << " secs" << endl;
+
+    fillpos = Array<size_t>();
+    pattern_firsti = Array<size_t>();
+    pattern_colnr = Array<int>();
+  }
+
+
+  // position of every used entry of the lower triangle of a in the factor,
+  // such that the numeric factorization does not search rows
+  template <class TM>
+  void SparseCholeskyTM<TM> :: 
+  SetupFillPositions (const SparseMatrixTM<TM> & a)
+  {
+    static Timer t("SparseCholesky - fill positions");
+    RegionTimer reg(t);
+
+    int n = a.Height();
+    auto use_entry = [&] (int i, int col)
+      {
+        if (col > i) return false;
+        if (inner) return inner->Test(i) && inner->Test(col);
+        if (cluster) return (*cluster)[i] == (*cluster)[col] && (*cluster)[i] != 0;
+        return true;
+      };
+    
+    fillpos.SetSize (a.NZE());
+    pattern_colnr.SetSize (a.NZE());
+    pattern_firsti.SetSize (n+1);
+    pattern_firsti[n] = a.NZE();
+    ParallelFor (n, [&] (int i)
+                 {
+                   auto rowind = a.GetRowIndices(i);
+                   size_t first = a.First(i);
+                   pattern_firsti[i] = first;
+                   for (auto j : Range(rowind))
+                     {
+                       int col = rowind[j];
+                       pattern_colnr[first+j] = col;
+                       fillpos[first+j] = (use_entry (i, col) && order[i] >= 0 && order[col] >= 0) ?
+                         FactorPosition (order[i], order[col]) : numeric_limits<size_t>::max();
+                     }
+                 }, TasksPerThread(5));
+  }
+  
+
+
+
+  template <class TM>
+  void SparseCholeskyTM<TM> :: 
+  OrderMinimumDegree (const SparseMatrixTM<TM> & a)
+  {
+    static Timer ta("SparseCholesky - allocate");
+    int n = a.Height();
+
     int printstat = 0;
     
     if (printstat)
@@ -230,62 +377,67 @@ namespace ngla
 
     delete mdo;
     mdo = 0;
+  }
 
-    diag.SetSize(nused);
-    // lfact.SetSize (nze);
-    lfact = NumaInterleavedArray<TM> (nze);
 
-    // lfact = TM(0.0);     // first touch
-    ParallelForRange (nze, [&] (IntRange r)
-                      {
-                        lfact.Range(r) = TM(0.0);
-                      });
+  template <class TM>
+  void SparseCholeskyTM<TM> :: 
+  OrderNestedDissection (const SparseMatrixTM<TM> & a)
+  {
+    static Timer ta("SparseCholesky - allocate");
+    int n = a.Height();
+
+    int printstat = 0;
     
-    endtime = clock();
     if (printstat)
-      (cout) << "allocation time = "
-	     << double (endtime - starttime) / CLOCKS_PER_SEC << " secs" << endl;
+      cout << IM(4) << "Nested dissection ordering: N = " << n << endl;
     
-    starttime = endtime;
-    FactorNew(a);
-    /*
-#ifdef LAPACK
-    if (a.IsSPD())
-      FactorSPD();
-    else
-#endif
-      Factor(); 
-    */
-
-    /*
-    for (int i = 0; i < n; i++)
-      if (a.GetPositionTest (i,i) == numeric_limits<size_t>::max())
-	diag[order[i]] = TM(0.0);
+    clock_t starttime, endtime;
+    starttime = clock();
 
-    if (inner)
+    auto use_edge = [&] (int i, int col)
       {
-	for (int i = 0; i < n; i++)
-	  if (!inner->Test(i))
-	    diag[order[i]] = TM(0.0);
-      }
+        if (inner) return inner->Test(i) && inner->Test(col);
+        if (cluster) return (*cluster)[i] == (*cluster)[col] && (*cluster)[i] != 0;
+        return true;
+      };
+
+    TableCreator<int> creator(n);
+    for ( ; !creator.Done(); creator++)
+      ParallelFor (n, [&] (int i)
+                   {
+                     for (auto col : a.GetRowIndices(i))
+                       if (col < i && use_edge(i, col))
+                         {
+                           creator.Add (i, col);
+                           creator.Add (col, i);
+                         }
+                   });
 
+    NestedDissectionOrdering nd(creator.MoveTable());
+    if (inner)
+      ParallelFor (n, [&] (int i)
+                   {
+                     if (!inner->Test(i))
+                       nd.SetUnusedVertex(i);
+                   });
     if (cluster)
-      {
-	for (int i = 0; i < n; i++)
-	  if (!(*cluster)[i])
-	    diag[order[i]] = TM(0.0);
-      }
-    */
+      for (int i = 0; i < n; i++)
+        if (!(*cluster)[i])
+          nd.SetUnusedVertex(i);
 
-    if (printstat)
-      cout << IM(4) << "done" << endl;
-    
+    nd.Order();
+    nused = nd.nused;
     endtime = clock();
-
     if (printstat)
-      (cout) << " factoring time = " << double(endtime - starttime) / CLOCKS_PER_SEC << " sec" << endl;
+      cout << IM(4) << "ordering time = "
+	   << double (endtime - starttime) / CLOCKS_PER_SEC 
+	   << " secs" << endl;
+
+    ta.Start();
+    Allocate (nd.order, nd.vertices, &nd.blocknr[0]);
+    ta.Stop();
   }
-  
 
   
   template <class TM>
@@ -514,59 +666,141 @@ namespace ngla
 
 
 
+  template <class TM>
+  size_t SparseCholeskyTM<TM> :: FactorPosition (int i, int j) const
+  {
+    if (i == j) return nze + i;
+    if (i > j) swap (i, j);
+
+    auto cols = rowindex2.Range(firstinrow_ri[i], firstinrow_ri[i]+firstinrow[i+1]-firstinrow[i]);
+    for (auto k : Range(cols))
+      if (cols[k] == j)
+        return firstinrow[i] + k;
+    throw Exception ("SparseCholesky: position "+ToString(i)+", "+ToString(j)+" not in factor");
+  }
+
+
+
+  template <class TM>
+  bool SparseCholeskyTM<TM> :: 
+  SamePattern (const SparseMatrixTM<TM> & a) const
+  {
+    size_t n = a.Height();
+    if (pattern_firsti.Size() != n+1 || pattern_colnr.Size() != a.NZE())
+      return false;
+
+    atomic<bool> same(true);
+    ParallelFor (n, [&] (size_t i)
+                 {
+                   if (a.First(i) != pattern_firsti[i])
+                     {
+                       same = false;
+                       return;
+                     }
+                   auto rowind = a.GetRowIndices(i);
+                   auto prowind = pattern_colnr.Range(pattern_firsti[i], pattern_firsti[i+1]);
+                   if (rowind.Size() != prowind.Size())
+                     {
+                       same = false;
+                       return;
+                     }
+                   for (auto j : Range(rowind))
+                     if (rowind[j] != prowind[j])
+                       {
+                         same = false;
+                         return;
+                       }
+                 }, TasksPerThread(5));
+    return same;
+  }
+
   template <class TM>
   void SparseCholeskyTM<TM> :: 
-  FactorNew (const SparseMatrix<TM> & a)
+  FactorNew (const SparseMatrixTM<TM> & a)
   {
     static Timer tf("SparseCholesky - fill factor");
-    tf.Start();
     if ( height != a.Height() )
       {
 	cout << IM(4) << "SparseCholesky::FactorNew called with matrix of different size." << endl;
 	return;
       }
-    lfact = TM(0.0);
+    // without fill positions, the analysis belongs to the matrix of the constructor
+    if (fillpos.Size() ? !SamePattern (a) : &a != &mat)
+      {
+        cout << IM(4) << "SparseCholesky::FactorNew: sparsity pattern changed, analyze again" << endl;
+        Analyze (a);
+      }
+    if (!fillpos.Size())
+      SetupFillPositions (a);
 
-    if (!inner && !cluster)
-      ParallelFor 
-        (Range(height), [&](auto i)
-         {
-           auto rowind = a.GetRowIndices(i);
-           auto rowvals = a.GetRowValues(i);
-           
-           for (auto j : Range(rowind.Size()))
-             if (rowind[j] <= i)
-               SetOrig (i, rowind[j], rowvals[j]);
-         });
-        else if (inner)
-      ParallelFor 
-        (Range(height), [&](auto i)
-         {
-           if (inner->Test(i))
-             for (auto j : Range(a.GetRowIndices(i)))
-               {
-                 auto col = a.GetRowIndices(i)[j];
-                 if (col <= i)
-                   {
-                     if (inner->Test(col))
-                       SetOrig (i, col, a.GetRowValues(i)[j]);
-                   }
-               }
-         }, TasksPerThread(5));
-    else
-      for (auto i : Range(height))
-	{
-	  auto row = a.GetRowIndices(i);
-	  for (auto j : Range(row.Size()))
-	    {
-	      auto col = row[j];
-	      if (col <= i)
-		if (((*cluster)[i] == (*cluster)[col] && (*cluster)[i]))
-                  SetOrig (i, col, a.GetRowValues(i)[j]);
-	    }
-	}
+    tf.Start();
+    if (factor_is_float)
+      {
+        // refactor: need the double precision factors again
+        lfact = NumaInterleavedArray<TM> (nze);
+        diag.SetSize (nused);
+        lfact_float = Array<float>();
+        diag_float = Array<float>();
+        factor_is_float = false;
+      }
+    ParallelForRange (nze, [&] (IntRange r)
+                      {
+                        lfact.Range(r) = TM(0.0);
+                      });
+    ParallelForRange (nused, [&] (IntRange r)
+                      {
+                        diag.Range(r) = TM(0.0);
+                      });
+
+    ParallelFor 
+      (Range(height), [&](auto i)
+       {
+         auto rowind = a.GetRowIndices(i);
+         auto rowvals = a.GetRowValues(i);
+         FlatArray<size_t> pos = fillpos.Range(a.First(i), a.First(i)+rowind.Size());
+         
+         for (auto j : Range(rowind))
+           {
+             size_t p = pos[j];
+             if (p == numeric_limits<size_t>::max()) continue;
+             if (p >= nze)
+               diag[p-nze] = rowvals[j];
+             else if (order[i] > order[rowind[j]])
+               lfact[p] = Trans (rowvals[j]);
+             else
+               lfact[p] = rowvals[j];
+           }
+       }, TasksPerThread(5));
     tf.Stop();
     FactorSPD(); 
+    StoreFloat();
+  }
+
+
+  template <class TM>
+  void SparseCholeskyTM<TM> :: StoreFloat ()
+  {
+    if constexpr (is_same<TM,double>::value)
+      {
+        if (!storefloat) return;
+        static Timer t("SparseCholesky - store float"); RegionTimer reg(t);
+
+        lfact_float.SetSize (nze);
+        diag_float.SetSize (nused);
+        ParallelForRange (nze, [&] (IntRange r)
+                          {
+                            for (auto i : r)
+                              lfact_float[i] = lfact[i];
+                          });
+        ParallelForRange (nused, [&] (IntRange r)
+                          {
+                            for (auto i : r)
+                              diag_float[i] = diag[i];
+                          });
+        lfact = NumaInterleavedArray<TM> ();
+        diag = Array<TM> ();
+        factor_is_float = true;
+      }
   }
  
 
@@ -929,6 +1163,12 @@ namespace ngla
         return;
       }
 
+    if (supernodal)
+      {
+        FactorMultiFrontal (dummy);
+        return;
+      }
+
     static Timer factor_timer("SparseCholesky::Factor SPD");
     static Timer factor_dense1("SparseCholesky::Factor SPD - setup dense cholesky");
     static Timer factor_dense("SparseCholesky::Factor SPD - dense cholesky");
@@ -1496,6 +1736,150 @@ namespace ngla
 
 
 
+  
+  /*
+    Supernodal multifrontal factorization.
+    
+    Every block (supernode) assembles its frontal matrix from its own
+    columns and the update matrices of its children in the elimination
+    tree. The fully summed columns form a dense panel which is factored in
+    place, the Schur complement is computed by one dense rank-mi update
+    (ngblas SubADBt), and handed to the parent. Only the extend-add of
+    update matrices uses indirect addressing, and the elimination tree
+    exposes much more parallelism than the full block_dependency graph.
+  */
+  template <class TM> template<typename T>
+  void SparseCholeskyTM<TM> :: FactorMultiFrontal (T dummy) 
+  {
+    static Timer factor_timer("SparseCholesky::Factor multifrontal");
+    RegionTimer reg (factor_timer);
+    
+    size_t n = nused;
+    if (n > 2000){
+      cout << IM(4) << " factor multifrontal " << flush;
+    }
+
+    size_t * hfirstinrow = firstinrow.Addr(0);
+    TM * hlfact = lfact.Addr(0);
+
+    size_t nblocks = blocks.Size()-1;
+
+    // update matrices, alive from factorization of a block until its parent
+    // is assembled
+    Array<Array<TM>> updates(nblocks);
+    
+    RunParallelDependency
+      (block_etree, block_children, [&] (int blocknr)
+       {
+         IntRange block = BlockDofs(blocknr);
+         size_t mi = block.Size();
+         if (mi == 0) return;
+         
+         size_t i1 = block.First();
+         auto extdofs = BlockExtDofs(blocknr);
+         size_t next = extdofs.Size();
+         size_t nk = mi + next;
+
+         // fully summed columns of the front, column-major panel
+         ArrayMem<TM,1000> panelmem(nk*mi);
+         FlatMatrix<TM,ColMajor> panel(nk, mi, panelmem.Data());
+
+         for (size_t j = 0; j < mi; j++)
+           {
+             panel.Col(j).Range(0,j) = TM(0.0);
+             panel(j,j) = diag[i1+j];
+             panel.Col(j).Range(j+1,nk) = FlatVector<TM>(nk-j-1, hlfact+hfirstinrow[i1+j]);
+           }
+
+         // contribution block of the front
+         updates[blocknr].SetSize (next*next);
+         FlatMatrix<TM,ColMajor> update(next, next, updates[blocknr].Data());
+         if (next > 1000)
+           ParallelForRange (next, [&](IntRange r)
+                             {
+                               update.Cols(r) = TM(0.0);
+                             });
+         else
+           update = TM(0.0);
+
+         // extend-add the update matrices of the children
+         for (int child : block_children[blocknr])
+           {
+             auto cextdofs = BlockExtDofs(child);
+             size_t nc = cextdofs.Size();
+             FlatMatrix<TM,ColMajor> cupdate(nc, nc, updates[child].Data());
+
+             // position of child's external dofs within the front
+             ArrayMem<int,100> relpos(nc);
+             for (size_t k = 0, pos = 0; k < nc; k++)
+               {
+                 int dof = cextdofs[k];
+                 if (dof < block.Next())
+                   relpos[k] = dof-i1;
+                 else
+                   {
+                     while (extdofs[pos] != dof) pos++;
+                     relpos[k] = mi+pos;
+                   }
+               }
+
+             auto extend_add = [&] (size_t l)
+               {
+                 size_t col = relpos[l];
+                 if (col < mi)
+                   for (size_t k = l; k < nc; k++)
+                     panel(relpos[k], col) += cupdate(k,l);
+                 else
+                   for (size_t k = l; k < nc; k++)
+                     update(relpos[k]-mi, col-mi) += cupdate(k,l);
+               };
+
+             if (nc < 100)
+               for (size_t l = 0; l < nc; l++)
+                 extend_add(l);
+             else
+               ParallelFor (nc, extend_add);
+             
+             updates[child] = Array<TM>();
+           }
+
+         // dense factorization of the panel, and Schur complement
+         auto A11 = panel.Rows(0,mi);
+         auto B = panel.Rows(mi,nk);
+         CalcLDL (A11);
+         if (next > 0)
+           {
+             CalcLDL_SolveL (A11, B);
+             CalcLDL_A2 (A11.Diag(), B, SliceMatrix<TM,ColMajor>(update));
+           }
+
+         auto write_back_row = [&](size_t j)
+           {
+             diag[i1+j] = panel(j,j);
+             FlatVector<TM>(nk-j-1, hlfact+hfirstinrow[i1+j]) = panel.Col(j).Range(j+1,nk);
+           };
+
+         if (mi < 10)
+           for (size_t j = 0; j < mi; j++)
+             write_back_row(j);
+         else
+           ParallelFor (mi, write_back_row);
+       });
+
+    ParallelFor (n, [&] (size_t i)
+      {
+        TM ai = diag[i];
+        for (auto j : Range(hfirstinrow[i], hfirstinrow[i+1]))
+          lfact[j] = lfact[j] * ai;
+      }, TasksPerThread(5));
+
+    if (n > 2000){
+      cout << IM(4) << endl;
+    }
+  }
+
+
+
 
 
   
@@ -1640,6 +2024,21 @@ namespace ngla
   template <class TM, class TV_ROW, class TV_COL>
   void SparseCholesky<TM, TV_ROW, TV_COL> :: 
   SolveReordered (FlatVector<TVX> hy) const
+  {
+    if constexpr (is_same<TM,double>::value)
+      if (factor_is_float)
+        {
+          SolveReordered (hy, lfact_float.Data(), diag_float.Data());
+          return;
+        }
+    SolveReordered (hy, lfact.Data(), diag.Data());
+  }
+
+  
+  // factors are stored as TF, arithmetic is done in TM
+  template <class TM, class TV_ROW, class TV_COL> template <typename TF>
+  void SparseCholesky<TM, TV_ROW, TV_COL> :: 
+  SolveReordered (FlatVector<TVX> hy, TF * hlfact, TF * hdiag) const
   {
     static Timer timer1("SparseCholesky<d,d,d>::MultAdd fac1");
     static Timer timer2("SparseCholesky<d,d,d>::MultAdd fac2");
@@ -1738,11 +2137,11 @@ namespace ngla
                                      size_t size = range.end()-i-1;
                                      if (size > 0)
                                        {
-                                         FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                         FlatVector<TF> vlfact(size, hlfact+firstinrow[i]);
                                          
                                          auto hyr = hy.Range(i+1, range.end());
                                          for (size_t j = 0; j < size; j++)
-                                           hyr(j) -= Trans(vlfact(j)) * hyi;
+                                           hyr(j) -= Trans(TM(vlfact(j))) * hyi;
                                        }
                                      if (extdofs.Size() == 0)
                                        {
@@ -1750,9 +2149,9 @@ namespace ngla
                                          continue;
                                        }
                                      size_t first = firstinrow[i] + range.end()-i-1;
-                                     FlatVector<TM> ext_lfact (extdofs.Size(), &lfact[first]);
+                                     FlatVector<TF> ext_lfact (extdofs.Size(), hlfact+first);
                                      for (size_t j = 0; j < temp.Size(); j++)
-                                       temp(j) += Trans(ext_lfact(j)) * hyi;
+                                       temp(j) += Trans(TM(ext_lfact(j))) * hyi;
                                    }
                                  
                                  for (size_t j : Range(extdofs))
@@ -1766,12 +2165,12 @@ namespace ngla
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     FlatVector<TF> vlfact(size, hlfact+firstinrow[i]);
 
                                      TVX hyi = hy(i);
                                      auto hyr = hy.Range(i+1, range.end());
                                      for (size_t j = 0; j < hyr.Size(); j++)
-                                       hyr(j) -= Trans(vlfact(j)) * hyi;
+                                       hyr(j) -= Trans(TM(vlfact(j))) * hyi;
                                    }
 
                                }
@@ -1792,11 +2191,11 @@ namespace ngla
                                        {
                                          size_t first = firstinrow[i] + range.end()-i-1;
                                          
-                                         FlatVector<TM> ext_lfact (all_extdofs.Size(), &lfact[first]);
+                                         FlatVector<TF> ext_lfact (all_extdofs.Size(), hlfact+first);
  
                                          TVX hyi = hy(i);
                                          for (size_t j = 0; j < temp.Size(); j++)
-                                           temp(j) += Trans(ext_lfact(myr.begin()+j)) * hyi;
+                                           temp(j) += Trans(TM(ext_lfact(myr.begin()+j))) * hyi;
                                        }
                                      
                                      for (size_t j : Range(extdofs))
@@ -1810,10 +2209,9 @@ namespace ngla
 
 
     // solve with the diagonal
-    const TM * hdiag = diag.Data();
     ParallelFor (hy.Size(), [&] (int i)
                  {
-                   TVX tmp = hdiag[i] * hy[i];
+                   TVX tmp = TM(hdiag[i]) * hy[i];
                    hy[i] = tmp;
                  });
 
@@ -1848,23 +2246,23 @@ namespace ngla
                                    for (auto i : range)
                                      {
                                        size_t first = firstinrow[i] + range.end()-i-1;
-                                       FlatVector<TM> ext_lfact (extdofs.Size(), &lfact[first]);
+                                       FlatVector<TF> ext_lfact (extdofs.Size(), hlfact+first);
                                        
                                        TVX val(0.0);
                                        for (auto j : Range(extdofs))
-                                         val += ext_lfact(j) * temp(j);
+                                         val += TM(ext_lfact(j)) * temp(j);
                                        hy(i) -= val;
                                      }
                                  for (size_t i = range.end()-1; i-- > range.begin(); )
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     FlatVector<TF> vlfact(size, hlfact+firstinrow[i]);
                                      auto hyr = hy.Range(i+1, range.end());
 
                                      TVX hyi = hy(i);
                                      for (size_t j = 0; j < vlfact.Size(); j++)
-                                       hyi -= vlfact(j) * hyr(j);
+                                       hyi -= TM(vlfact(j)) * hyr(j);
                                      hy(i) = hyi;
                                    }
                                  
@@ -1877,12 +2275,12 @@ namespace ngla
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     FlatVector<TF> vlfact(size, hlfact+firstinrow[i]);
                                      auto hyr = hy.Range(i+1, range.end());
 
                                      TVX hyi = hy(i);
                                      for (size_t j = 0; j < vlfact.Size(); j++)
-                                       hyi -= vlfact(j) * hyr(j);
+                                       hyi -= TM(vlfact(j)) * hyr(j);
                                      hy(i) = hyi;
                                    }
 
@@ -1904,11 +2302,11 @@ namespace ngla
                                      for (auto i : range)
                                        {
                                          size_t first = firstinrow[i] + range.end()-i-1;
-                                         FlatVector<TM> ext_lfact (all_extdofs.Size(), &lfact[first]);
+                                         FlatVector<TF> ext_lfact (all_extdofs.Size(), hlfact+first);
     
                                          TVX val(0.0);
                                          for (auto j : Range(extdofs))
-                                           val += ext_lfact(myr.begin()+j) * temp(j);
+                                           val += TM(ext_lfact(myr.begin()+j)) * temp(j);
                                          AtomicAdd (hy(i), -val);
                                        }
                                    }
@@ -1926,7 +2324,7 @@ namespace ngla
   {
     static Timer timer("SparseCholesky<d,d,d>::MultAdd");
     RegionTimer reg (timer);
-    timer.AddFlops (2.0*lfact.Size());
+    timer.AddFlops (2.0*this->nze);
 
     // int n = Height();
     
@@ -1981,6 +2379,171 @@ namespace ngla
   
 
 
+  // the micro-task solver of SolveReordered, but hy has a row of right hand sides per dof
+  template <class TM, class TV_ROW, class TV_COL> template <typename TF>
+  void SparseCholesky<TM, TV_ROW, TV_COL> :: 
+  SolveReorderedMulti (FlatMatrix<TVX> hy, TF * hlfact, TF * hdiag) const
+  {
+    static Timer timer1("SparseCholesky::MultAdd MultiVector fac1");
+    static Timer timer2("SparseCholesky::MultAdd MultiVector fac2");
+
+    size_t k = hy.Width();
+    
+    timer1.Start();
+    RunParallelDependency (micro_dependency, micro_dependency_trans,
+                           [&] (int nr) 
+                           {
+                             auto task = microtasks[nr];
+                             size_t blocknr = task.blocknr;
+                             auto range = BlockDofs (blocknr);
+                             if (range.Size()==0) return;
+
+                             if (task.type == MicroTask::LB_BLOCK || task.type == MicroTask::L_BLOCK)
+                               for (auto i : range)
+                                 {
+                                   size_t size = range.end()-i-1;
+                                   FlatVector<TF> vlfact(size, hlfact+firstinrow[i]);
+                                   auto hyi = hy.Row(i);
+                                   for (size_t j = 0; j < size; j++)
+                                     hy.Row(i+1+j) -= TM(vlfact(j)) * hyi;
+                                 }
+
+                             if (task.type == MicroTask::L_BLOCK) return;
+                             
+                             auto all_extdofs = BlockExtDofs (blocknr);
+                             if (all_extdofs.Size() == 0) return;
+                             auto myr = Range(all_extdofs);
+                             if (task.type == MicroTask::B_BLOCK)
+                               myr = myr.Split (task.bblock, task.nbblocks);
+                             auto extdofs = all_extdofs.Range(myr);
+
+                             Matrix<TVX> temp(extdofs.Size(), k);
+                             temp = 0;
+                             for (auto i : range)
+                               {
+                                 size_t first = firstinrow[i] + range.end()-i-1;
+                                 FlatVector<TF> ext_lfact (all_extdofs.Size(), hlfact+first);
+                                 auto hyi = hy.Row(i);
+                                 for (size_t j = 0; j < extdofs.Size(); j++)
+                                   temp.Row(j) += TM(ext_lfact(myr.begin()+j)) * hyi;
+                               }
+                             
+                             for (size_t j : Range(extdofs))
+                               for (size_t l = 0; l < k; l++)
+                                 AtomicAdd (hy(extdofs[j], l), -temp(j,l));
+                           });
+    timer1.Stop();
+
+    ParallelFor (hy.Height(), [&] (int i)
+                 {
+                   hy.Row(i) *= TM(hdiag[i]);
+                 });
+
+    timer2.Start();
+    RunParallelDependency (micro_dependency_trans, micro_dependency,
+                           [&] (int nr) 
+                           {
+                             auto task = microtasks[nr];
+                             size_t blocknr = task.blocknr;
+                             auto range = BlockDofs (blocknr);
+                             if (range.Size()==0) return;
+
+                             if (task.type != MicroTask::L_BLOCK)
+                               {
+                                 auto all_extdofs = BlockExtDofs (blocknr);
+                                 if (all_extdofs.Size() != 0)
+                                   {
+                                     auto myr = Range(all_extdofs);
+                                     if (task.type == MicroTask::B_BLOCK)
+                                       myr = myr.Split (task.bblock, task.nbblocks);
+                                     auto extdofs = all_extdofs.Range(myr);
+                                     
+                                     Matrix<TVX> temp(extdofs.Size(), k);
+                                     for (auto j : Range(extdofs))
+                                       temp.Row(j) = hy.Row(extdofs[j]);
+
+                                     VectorMem<100,TVX> val(k);
+                                     for (auto i : range)
+                                       {
+                                         size_t first = firstinrow[i] + range.end()-i-1;
+                                         FlatVector<TF> ext_lfact (all_extdofs.Size(), hlfact+first);
+                                         val = 0.0;
+                                         for (auto j : Range(extdofs))
+                                           val += TM(ext_lfact(myr.begin()+j)) * temp.Row(j);
+                                         if (task.type == MicroTask::LB_BLOCK)
+                                           hy.Row(i) -= val;
+                                         else
+                                           for (size_t l = 0; l < k; l++)
+                                             AtomicAdd (hy(i,l), -val(l));
+                                       }
+                                   }
+                               }
+
+                             if (task.type == MicroTask::B_BLOCK) return;
+                             
+                             for (size_t i = range.end()-1; i-- > range.begin(); )
+                               {
+                                 size_t size = range.end()-i-1;
+                                 FlatVector<TF> vlfact(size, hlfact+firstinrow[i]);
+                                 auto hyi = hy.Row(i);
+                                 for (size_t j = 0; j < size; j++)
+                                   hyi -= TM(vlfact(j)) * hy.Row(i+1+j);
+                               }
+                           });
+    timer2.Stop();
+  }
+
+  
+  template <class TM, class TV_ROW, class TV_COL>
+  void SparseCholesky<TM, TV_ROW, TV_COL> :: 
+  MultAdd (FlatVector<double> alpha, const MultiVector & x, MultiVector & y) const
+  {
+    if constexpr (is_same<TM,double>::value && is_same<TVX,double>::value)
+      {
+        static Timer timer("SparseCholesky::MultAdd MultiVector");
+        RegionTimer reg (timer);
+        size_t k = x.Size();
+        timer.AddFlops (2.0*this->nze*k);
+
+        Array<double*> px(k), py(k);
+        for (size_t l = 0; l < k; l++)
+          {
+            px[l] = x[l]->FVDouble().Addr(0);
+            py[l] = y[l]->FVDouble().Addr(0);
+          }
+        
+        Matrix<double> hy(this->nused, k);
+        ParallelFor (Range(height), [&] (int i)
+                     {
+                       if (order[i] != -1)
+                         for (size_t l = 0; l < k; l++)
+                           hy(order[i], l) = px[l][i];
+                     });
+
+        if (factor_is_float)
+          SolveReorderedMulti (hy, lfact_float.Data(), diag_float.Data());
+        else
+          SolveReorderedMulti (hy, lfact.Data(), diag.Data());
+
+        auto use_dof = [&] (int i)
+          {
+            if (order[i] == -1) return false;
+            if (inner) return inner->Test(i);
+            if (cluster) return (*cluster)[i] != 0;
+            return true;
+          };
+        ParallelFor (Range(height), [&] (int i)
+                     {
+                       if (use_dof(i))
+                         for (size_t l = 0; l < k; l++)
+                           py[l][i] += alpha(l) * hy(order[i], l);
+                     });
+      }
+    else
+      BaseMatrix::MultAdd (alpha, x, y);
+  }
+
+
   template <class TM, class TV_ROW, class TV_COL>
   void SparseCholesky<TM, TV_ROW, TV_COL> :: 
   Smooth (BaseVector & u, const BaseVector & f, BaseVector & y) const
@@ -2127,6 +2690,8 @@ namespace ngla
   template <class TM>
   const TM & SparseCholeskyTM<TM> :: Get (int i, int j) const
   {
+    if (factor_is_float)
+      throw Exception ("SparseCholesky::Get: factor is stored in single precision");
     if (i == j)
       {
 	return diag[i];
@@ -2159,6 +2724,8 @@ namespace ngla
   ostream & SparseCholeskyTM<TM> :: Print (ostream & ost) const
   {
     int n = Height();
+    if (factor_is_float)
+      return ost << "SparseCholesky, n = " << n << ", factor stored in single precision" << endl;
 
     for (int i = 0; i < n; i++)
       {
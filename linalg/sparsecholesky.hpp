@@ -42,6 +42,20 @@ namespace ngla
 
 
 
+  /// default settings for new SparseCholesky factorizations
+  class NGS_DLL_HEADER SparseCholeskyOptions
+  {
+  public:
+    /// multifrontal factorization on dense supernode panels (double/Complex only)
+    static bool supernodal;
+    /// fill-reducing ordering, 'minimumdegree' or 'nesteddissection'
+    static string ordering;
+    /// keep the factors of real scalar matrices in single precision
+    static bool storefloat;
+  };
+
+
+
 
 
 
@@ -50,7 +64,7 @@ namespace ngla
   /**
      A sparse cholesky factorization.
      The unknowns are reordered by the minimum degree
-     ordering algorithm
+     ordering algorithm, or by nested dissection
 
      computs A = L D L^t
      L is stored column-wise
@@ -99,6 +113,18 @@ namespace ngla
     // dependency graph for elimination
     Table<int> block_dependency; 
 
+    // elimination tree of the blocks (parent), and its transpose
+    Table<int> block_etree;
+    Table<int> block_children;
+
+    // position of the entries of the matrix in the factor: index into lfact,
+    // nze + index into diag, or size_t max if the entry is not used.
+    // Set up by FactorNew, kept only once the matrix is factored again
+    Array<size_t> fillpos;
+    // pattern of the analyzed matrix (row starts and column numbers)
+    Array<size_t> pattern_firsti;
+    Array<int> pattern_colnr;
+
   public:      // needed for gcc 4.9, why  ??? 
     class MicroTask
     {
@@ -117,11 +143,24 @@ namespace ngla
 
 
     //
-    MinimumDegreeOrdering * mdo;
+    MinimumDegreeOrdering * mdo = nullptr;
 
     // maximal non-zero entries in a column
     int maxrow;
 
+    // factor by the supernodal multifrontal method
+    bool supernodal;
+
+    // fill-reducing ordering, see SparseCholeskyOptions
+    string ordering;
+
+    // store factors in single precision after factorization (TM=double only)
+    bool storefloat;
+    // lfact and diag are released, the factors live in lfact_float/diag_float
+    bool factor_is_float = false;
+    Array<float> lfact_float;
+    Array<float> diag_float;
+
     // the original matrix
     const SparseMatrixTM<TM> & mat;
 
@@ -139,6 +178,13 @@ namespace ngla
     int VHeight() const { return height; }
     ///
     int VWidth() const { return height; }
+    /// symbolic factorization: ordering, blocks and task graphs
+    void Analyze (const SparseMatrixTM<TM> & a);
+    /// positions of the entries of a in the factor, see fillpos
+    void SetupFillPositions (const SparseMatrixTM<TM> & a);
+    /// fill-reducing orderings, call Allocate
+    void OrderMinimumDegree (const SparseMatrixTM<TM> & a);
+    void OrderNestedDissection (const SparseMatrixTM<TM> & a);
     ///
     void Allocate (const Array<int> & aorder, 
 		   const Array<MDOVertex> & vertices,
@@ -149,17 +195,25 @@ namespace ngla
     void FactorSPD (); 
     template <typename T>
     void FactorSPD1 (T dummy); 
+    template <typename T>
+    void FactorMultiFrontal (T dummy); 
 #endif
 
     virtual bool SupportsUpdate() const { return true; }     
     virtual void Update()
     {
       // FactorNew (dynamic_cast<const SparseMatrix<TM>&> (*matrix.lock().get()));
-      auto castmatrix = dynamic_pointer_cast<SparseMatrix<TM>>(matrix.lock());
+      auto castmatrix = dynamic_pointer_cast<SparseMatrixTM<TM>>(matrix.lock());
       FactorNew (*castmatrix);
     }
-    ///
-    void FactorNew (const SparseMatrix<TM> & a);
+    /// numeric factorization, re-uses the symbolic data if the pattern of a did not change
+    void FactorNew (const SparseMatrixTM<TM> & a);
+    /// a has the sparsity pattern of the analyzed matrix
+    bool SamePattern (const SparseMatrixTM<TM> & a) const;
+    /// position of the (reordered) entry i,j in the factor, see fillpos
+    size_t FactorPosition (int i, int j) const;
+    /// converts the factors to single precision, if requested
+    void StoreFloat ();
 
     /**
        A = L+D+L^T
@@ -174,6 +228,8 @@ namespace ngla
 
     virtual Array<MemoryUsage> GetMemoryUsage () const
     {
+      if (factor_is_float)
+        return { MemoryUsage ("SparseChol", nze*sizeof(float), 1) };
       return { MemoryUsage ("SparseChol", nze*sizeof(TM), 1) };
     }
 
@@ -217,6 +273,9 @@ namespace ngla
 
     using BASE::lfact;
     using BASE::diag;
+    using BASE::lfact_float;
+    using BASE::diag_float;
+    using BASE::factor_is_float;
     using BASE::order;
     using BASE::inv_order;
     using BASE::firstinrow;
@@ -251,6 +310,8 @@ namespace ngla
     {
       MultAdd (s, x, y);
     }
+    /// solves for all vectors of x at once, the factor is traversed only once
+    void MultAdd (FlatVector<double> alpha, const MultiVector & x, MultiVector & y) const override;
 
     AutoVector CreateRowVector () const override { return make_unique<VVector<TV>> (height); }
     AutoVector CreateColVector () const override { return make_unique<VVector<TV>> (height); }
@@ -261,6 +322,11 @@ namespace ngla
     void SolveBlockT (int i, FlatVector<TV> hy) const;
   private:
     void SolveReordered(FlatVector<TVX> hy) const;
+    template <typename TF>
+    void SolveReordered(FlatVector<TVX> hy, TF * hlfact, TF * hdiag) const;
+    // multiple right hand sides, one row of hy per dof
+    template <typename TF>
+    void SolveReorderedMulti(FlatMatrix<TVX> hy, TF * hlfact, TF * hdiag) const;
   };
 
 
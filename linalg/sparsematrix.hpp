@@ -362,6 +362,21 @@ namespace ngla
     virtual void AddElementMatrixSymmetric(FlatArray<int> dnums,
                                            BareSliceMatrix<TSCAL> elmat,
                                            bool use_atomic = false);
+
+    /// positions of element matrix entries in the value array, row-major,
+    /// numeric_limits<size_t>::max() for entries not stored
+    virtual void GetElementMatrixPositions(FlatArray<int> dnums1,
+                                           FlatArray<int> dnums2,
+                                           FlatArray<size_t> pos) const;
+
+    /// positions for the lower triangle only
+    void GetElementMatrixPositionsSymmetric(FlatArray<int> dnums,
+                                            FlatArray<size_t> pos) const;
+
+    /// add element matrix at precomputed positions, no search in the graph
+    void AddElementMatrixAt(FlatArray<size_t> pos, size_t w,
+                            BareSliceMatrix<TSCAL> elmat,
+                            bool use_atomic = false);
     
     virtual BaseVector & AsVector() override
     {
@@ -607,6 +622,13 @@ namespace ngla
     {
       this->AddElementMatrixSymmetric (dnums1, elmat, use_atomic);
     }
+
+    virtual void GetElementMatrixPositions(FlatArray<int> dnums1,
+                                           FlatArray<int> dnums2,
+                                           FlatArray<size_t> pos) const override
+    {
+      this->GetElementMatrixPositionsSymmetric (dnums1, pos);
+    }
     
     virtual shared_ptr<BaseJacobiPrecond> CreateJacobiPrecond (shared_ptr<BitArray> inner) const override
     { 
@@ -634,6 +656,12 @@ namespace ngla
       MultAdd (s, x, y);
     }
 
+    // only the lower triangle is stored, no blocked kernel
+    virtual void MultAdd (FlatVector<double> alpha, const MultiVector & x, MultiVector & y) const override
+    {
+      BaseMatrix::MultAdd (alpha, x, y);
+    }
+
 
     /*
       y += s L * x
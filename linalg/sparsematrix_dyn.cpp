@@ -185,4 +185,192 @@ namespace ngla
 
   template class SparseMatrixVariableBlocks<double>;  
 
+
+
+
+  // load px[pcol[0]], ..., px[pcol[C-1]]
+  INLINE SIMD<double> GatherSELL (const double * px, const int * pcol)
+  {
+#if defined __AVX512F__
+    return _mm512_i32gather_pd (_mm256_loadu_si256((const __m256i*)pcol), px, 8);
+#elif defined __AVX2__
+    return _mm256_i32gather_pd (px, _mm_loadu_si128((const __m128i*)pcol), 8);
+#else
+    return SIMD<double> ([px,pcol] (int k) { return px[pcol[k]]; });
+#endif
+  }
+  
+  template <typename TSCAL>
+  SparseMatrixSELL<TSCAL> ::
+  SparseMatrixSELL (const SparseMatrixTM<TSCAL> & mat, size_t asigma)
+    : height(mat.Height()), width(mat.Width()), sigma(max(asigma, size_t(1)))
+  {
+    static Timer t("SparseMatrixSELL ctor"); RegionTimer reg(t);
+    nslices = (height+C-1) / C;
+
+    // symmetric storage holds the lower triangle only, expand to both triangles
+    bool symmetric = dynamic_cast<const SparseMatrixSymmetric<TSCAL>*> (&mat) != nullptr;
+    Table<int> sym_cols;
+    Table<TSCAL> sym_vals;
+    if (symmetric)
+      {
+        TableCreator<int> creator_cols(height);
+        TableCreator<TSCAL> creator_vals(height);
+        for ( ; !creator_cols.Done(); creator_cols++, creator_vals++)
+          for (int i = 0; i < height; i++)
+            {
+              auto ind = mat.GetRowIndices(i);
+              auto vals = mat.GetRowValues(i);
+              for (size_t j = 0; j < ind.Size(); j++)
+                {
+                  creator_cols.Add (i, ind[j]);
+                  creator_vals.Add (i, vals[j]);
+                  if (ind[j] != i)
+                    {
+                      creator_cols.Add (ind[j], i);
+                      creator_vals.Add (ind[j], vals[j]);
+                    }
+                }
+            }
+        sym_cols = creator_cols.MoveTable();
+        sym_vals = creator_vals.MoveTable();
+      }
+
+    auto row_indices = [&] (int row) -> FlatArray<int>
+      { return symmetric ? sym_cols[row] : mat.GetRowIndices(row); };
+    auto row_values = [&] (int row) -> FlatArray<TSCAL>
+      {
+        if (symmetric) return sym_vals[row];
+        auto vals = mat.GetRowValues(row);
+        return FlatArray<TSCAL> (vals.Size(), vals.Data());
+      };
+
+    perm.SetSize (nslices*C);
+    for (size_t i = 0; i < perm.Size(); i++)
+      perm[i] = (i < height) ? i : -1;
+
+    // sort rows by length within every window of sigma rows
+    ParallelFor ((height+sigma-1)/sigma, [&] (size_t w)
+      {
+        size_t first = w*sigma;
+        size_t next = min(first+sigma, height);
+        std::stable_sort (perm.Data()+first, perm.Data()+next,
+                          [&] (int a, int b)
+                          { return row_indices(a).Size() > row_indices(b).Size(); });
+      });
+
+    firsti_slice.SetSize (nslices+1);
+    firsti_slice[0] = 0;
+    for (size_t i = 0; i < nslices; i++)
+      {
+        size_t len = 0;
+        for (size_t k = 0; k < C; k++)
+          if (int row = perm[i*C+k]; row >= 0)
+            len = max(len, row_indices(row).Size());
+        firsti_slice[i+1] = firsti_slice[i] + len;
+      }
+
+    colnr.SetSize (C*firsti_slice[nslices]);
+    data.SetSize (C*firsti_slice[nslices]);
+    
+    ParallelFor (nslices, [&] (size_t i)
+      {
+        size_t first = firsti_slice[i];
+        size_t len = firsti_slice[i+1]-first;
+        for (size_t k = 0; k < C; k++)
+          {
+            int row = perm[i*C+k];
+            size_t rowlen = 0;
+            int pad = 0;
+            if (row >= 0)
+              {
+                auto ind = row_indices(row);
+                auto vals = row_values(row);
+                rowlen = ind.Size();
+                for (size_t j = 0; j < rowlen; j++)
+                  {
+                    colnr[C*(first+j)+k] = ind[j];
+                    data[C*(first+j)+k] = vals[j];
+                  }
+                // padding refers to a column we load anyway
+                if (rowlen) pad = ind[rowlen-1];
+              }
+            for (size_t j = rowlen; j < len; j++)
+              {
+                colnr[C*(first+j)+k] = pad;
+                data[C*(first+j)+k] = 0.0;
+              }
+          }
+      });
+  }
+
+  template <typename TSCAL>
+  void SparseMatrixSELL<TSCAL> ::
+  MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("SparseMatrixSELL::MultAdd"); RegionTimer reg(t);
+    t.AddFlops (colnr.Size());
+    
+    auto fx = x.FV<TSCAL>();
+    auto fy = y.FV<TSCAL>();
+
+    ParallelForRange
+      (nslices, [&] (IntRange myrange)
+       {
+         for (size_t i : myrange)
+           {
+             size_t first = firsti_slice[i];
+             size_t next = firsti_slice[i+1];
+             const TSCAL * pdata = data.Data() + C*first;
+             const int * pcol = colnr.Data() + C*first;
+             SIMD<double> sum(0.0);
+             for (size_t j = first; j < next; j++, pdata += C, pcol += C)
+               sum = FMA (SIMD<double>(pdata), GatherSELL(fx.Data(), pcol), sum);
+             for (size_t k = 0; k < C; k++)
+               if (int row = perm[i*C+k]; row >= 0)
+                 fy(row) += s * sum[k];
+           }
+       }, TasksPerThread(4));
+  }
+
+  template <typename TSCAL>
+  void SparseMatrixSELL<TSCAL> ::
+  MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("SparseMatrixSELL::MultTransAdd"); RegionTimer reg(t);
+    t.AddFlops (colnr.Size());
+
+    auto fx = x.FV<TSCAL>();
+    auto fy = y.FV<TSCAL>();
+    for (size_t i = 0; i < nslices; i++)
+      for (size_t k = 0; k < C; k++)
+        if (int row = perm[i*C+k]; row >= 0)
+          {
+            TSCAL hx = s * fx(row);
+            for (size_t j = firsti_slice[i]; j < firsti_slice[i+1]; j++)
+              fy(colnr[C*j+k]) += data[C*j+k] * hx;
+          }
+  }
+  
+  template <typename TSCAL>  
+  AutoVector SparseMatrixSELL<TSCAL> :: CreateRowVector () const
+  {
+    return CreateBaseVector(width, false, 1);    
+  }
+
+  template <typename TSCAL>  
+  AutoVector SparseMatrixSELL<TSCAL> :: CreateColVector () const
+  {
+    return CreateBaseVector(height, false, 1);        
+  }
+
+  template <typename TSCAL>  
+  Array<MemoryUsage> SparseMatrixSELL<TSCAL> :: GetMemoryUsage () const
+  {
+    return { { "SparseMatrixSELL", data.Size()*sizeof(TSCAL)+colnr.Size()*sizeof(int)
+               + perm.Size()*sizeof(int) + firsti_slice.Size()*sizeof(size_t), 1 } };
+  }
+
+  template class SparseMatrixSELL<double>;  
+
 }
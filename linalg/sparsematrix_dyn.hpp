@@ -79,6 +79,43 @@ namespace ngla
 
 
 
+  /*
+    Sliced ELLPACK (SELL-C-sigma) storage for SIMD matrix-vector products.
+    Rows are sorted by length within windows of sigma rows, and grouped
+    into slices of C = SIMD<double>::Size() rows. Every slice is padded to
+    its longest row and stored column-major, such that one SIMD lane
+    handles one row. Symmetric storage is expanded to both triangles.
+  */
+  template <class TSCAL>
+  class  NGS_DLL_HEADER SparseMatrixSELL : public S_BaseMatrix<TSCAL>
+  {
+  protected:
+    static constexpr size_t C = SIMD<double>::Size();
+    size_t height, width, nslices, sigma;
+    Array<int> perm;             // slice lane -> original row, -1 for padding
+    Array<size_t> firsti_slice;  // first entry of slice, in units of C values
+    Array<int> colnr;
+    Array<TSCAL> data;
+    
+  public:
+    SparseMatrixSELL (const SparseMatrixTM<TSCAL> & mat, size_t asigma = 256);
+
+    int VHeight() const override { return height; }
+    int VWidth() const override { return width; }
+
+    void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    void MultTransAdd (double s, const BaseVector & x, BaseVector & y) const override;
+
+    AutoVector CreateRowVector () const override;
+    AutoVector CreateColVector () const override;
+
+    Array<MemoryUsage> GetMemoryUsage () const override;
+
+    /// number of stored entries, including padding
+    size_t NZE() const { return colnr.Size(); }
+  };
+
+
 }
 #endif
   
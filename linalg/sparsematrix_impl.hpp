@@ -102,6 +102,62 @@ namespace ngla
 	    }
 	}
   }
+
+
+  template <class TM>
+  void SparseMatrixTM<TM> ::
+  GetElementMatrixPositions(FlatArray<int> dnums1, FlatArray<int> dnums2,
+                            FlatArray<size_t> pos) const
+  {
+    for (size_t i = 0, ii = 0; i < dnums1.Size(); i++)
+      for (size_t j = 0; j < dnums2.Size(); j++, ii++)
+        if (IsRegularIndex(dnums1[i]) && IsRegularIndex(dnums2[j]))
+          pos[ii] = this->GetPosition(dnums1[i], dnums2[j]);
+        else
+          pos[ii] = numeric_limits<size_t>::max();
+  }
+
+  template <class TM>
+  void SparseMatrixTM<TM> ::
+  GetElementMatrixPositionsSymmetric(FlatArray<int> dnums, FlatArray<size_t> pos) const
+  {
+    // same entries as AddElementMatrixSymmetric: lower triangle,
+    // duplicate dofs are added only once
+    size_t n = dnums.Size();
+    for (size_t i = 0; i < n; i++)
+      for (size_t j = 0; j < n; j++)
+        {
+          int di = dnums[i], dj = dnums[j];
+          if (IsRegularIndex(di) && IsRegularIndex(dj) &&
+              (dj < di || (dj == di && j <= i)))
+            pos[i*n+j] = this->GetPosition(di, dj);
+          else
+            pos[i*n+j] = numeric_limits<size_t>::max();
+        }
+  }
+
+  template <class TM>
+  void SparseMatrixTM<TM> ::
+  AddElementMatrixAt(FlatArray<size_t> pos, size_t w,
+                     BareSliceMatrix<TSCAL> elmat1, bool use_atomic)
+  {
+    static Timer timer_addelmat_at("SparseMatrix::AddElementMatrixAt");
+    ThreadRegionTimer reg (timer_addelmat_at, TaskManager::GetThreadId());
+    NgProfiler::AddThreadFlops (timer_addelmat_at, TaskManager::GetThreadId(), pos.Size());
+
+    Scalar2ElemMatrix<TM, TSCAL> elmat (elmat1);
+    size_t h = (w > 0) ? pos.Size() / w : 0;
+    for (size_t i = 0, ii = 0; i < h; i++)
+      for (size_t j = 0; j < w; j++, ii++)
+        {
+          size_t p = pos[ii];
+          if (p == numeric_limits<size_t>::max()) continue;
+          if (use_atomic)
+            AtomicAdd (data[p], elmat(i,j));
+          else
+            data[p] += elmat(i,j);
+        }
+  }
   
 
   template <class TM>
@@ -258,7 +314,51 @@ namespace ngla
   void SparseMatrix<TM,TV_ROW,TV_COL> ::
   MultAdd (FlatVector<double> alpha, const MultiVector & x, MultiVector & y) const
   {
-    BaseMatrix::MultAdd (alpha, x, y);
+    if constexpr (is_same<TM,double>::value && is_same<TVX,double>::value && is_same<TVY,double>::value)
+      {
+        if (x.Size() == 1 || x.IsComplex() || y.IsComplex())
+          {
+            BaseMatrix::MultAdd (alpha, x, y);
+            return;
+          }
+        
+        static Timer t("SparseMatrix::MultAdd MultiVector"); RegionTimer reg(t);
+        size_t k = x.Size();
+        t.AddFlops (this->NZE()*k);
+
+        Array<double*> px(k), py(k);
+        for (size_t l = 0; l < k; l++)
+          {
+            px[l] = x[l]->FVDouble().Addr(0);
+            py[l] = y[l]->FVDouble().Addr(0);
+          }
+
+        // every row is loaded once, and applied to blocks of right hand sides
+        constexpr size_t BS = 8;
+        ParallelFor (balance, [&] (int row)
+           {
+             double sum[BS];
+             auto cols = this->GetRowIndices(row);
+             auto vals = this->GetRowValues(row);
+             for (size_t l0 = 0; l0 < k; l0 += BS)
+               {
+                 size_t nl = min(BS, k-l0);
+                 for (size_t l = 0; l < nl; l++)
+                   sum[l] = 0;
+                 for (size_t j = 0; j < cols.Size(); j++)
+                   {
+                     double v = vals[j];
+                     int c = cols[j];
+                     for (size_t l = 0; l < nl; l++)
+                       sum[l] += v * px[l0+l][c];
+                   }
+                 for (size_t l = 0; l < nl; l++)
+                   py[l0+l][row] += alpha(l0+l) * sum[l];
+               }
+           });
+      }
+    else
+      BaseMatrix::MultAdd (alpha, x, y);
   }
   
 
@@ -34,6 +34,7 @@ namespace ngstd
   class SharedLibrary
   {
     string lib_name;
+    bool remove_file = false;
 
 #ifdef WIN32
     HINSTANCE lib;
@@ -56,6 +57,9 @@ namespace ngstd
       Unload();
     }
 
+    // delete the library file once it is unloaded (Windows locks loaded files)
+    void RemoveFileOnUnload() { remove_file = true; }
+
     template <typename TFunc>
     TFunc GetFunction( string func_name )
     {
@@ -84,6 +88,8 @@ namespace ngstd
         int rc = dlclose(lib);
         if(rc != 0) cerr << "Failed to close library " << lib_name << endl;
 #endif // WIN32
+        if(remove_file)
+          std::remove(lib_name.c_str());
       }
     }
 
@@ -93,8 +93,9 @@ if rank==0 and not os.path.exists(output_path):
 comm.Barrier() #wait until master has created the directory!!
 
 if do_vtk:
-    vtk = VTKOutput(ma=mesh,coefs=[velocity],names=["u"],filename=output_path+"/vtkout_p"+str(rank)+"_n0",subdivision=1)
-    vtk.Do()
+    # one output for all ranks and time steps, collected in vtkout.pvd
+    vtk = VTKOutput(ma=mesh,coefs=[velocity],names=["u"],filename=output_path+"/vtkout",vtu=True,subdivision=1)
+    vtk.Do(time=t)
 
 count = 1;
 # implicit Euler/explicit Euler splitting method:
@@ -108,10 +109,7 @@ with TaskManager():
         gfu.vec.data -= tau * inv * res
 
         if count%vtk_interval==0 and do_vtk:
-            file_name = output_path+"/vtkout_p"+str(rank)+"_n"+str(int(count/vtk_interval));
-            print("rank "+str(rank)+", output to "+file_name)
-            vtk = VTKOutput(ma=mesh,coefs=[velocity],names=["u"],filename=file_name,subdivision=1)
-            vtk.Do()
+            vtk.Do(time=t)
         count = count+1;
 
         t = t + tau
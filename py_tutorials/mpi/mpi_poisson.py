@@ -85,5 +85,6 @@ if do_vtk:
         os.mkdir(output_path)
     comm.Barrier() #wait until master has created the directory!!
 
-    vtk = VTKOutput(ma=mesh, coefs=[u], names=["sol"], filename=output_path+"/vtkout_p"+str(rank), subdivision=2)
+    # every rank writes its piece vtkout_p<rank>.vtu, rank 0 writes vtkout.pvtu
+    vtk = VTKOutput(ma=mesh, coefs=[u], names=["sol"], filename=output_path+"/vtkout", vtu=True, subdivision=2)
     vtk.Do()
@@ -38,7 +38,7 @@ from .comp import VOL, BND, BBND, BBBND, COUPLING_TYPE, ElementId, \
     NumberSpace, Periodic, Discontinuous, Compress, \
     CompressCompound, BoundaryFromVolumeCF, Interpolate, Variation, \
     NumProc, PDE, Integrate, Region, SymbolicLFI, SymbolicBFI, \
-    SymbolicEnergy, Mesh, NodeId, ORDER_POLICY, VTKOutput, SetHeapSize, \
+    SymbolicEnergy, Mesh, NodeId, ORDER_POLICY, VTKOutput, WaitForOutput, SetOutputQueueSize, SetHeapSize, \
     SetTestoutFile, ngsglobals, pml, MPI_Init, ContactBoundary, PatchwiseSolve
 from .solve import BVP, CalcFlux, Draw, DrawFlux, \
     SetVisualization
@@ -70,6 +70,10 @@ _add_flags_doc(comp)
 # MPIManager.InitMPI()
 mpi_world = MPI_Init()
 
+# finish asynchronous output while the interpreter is still alive
+import atexit
+atexit.register(WaitForOutput)
+
 # from . import __expr
 # BaseVector.expr = property(__expr.VecExpr)
 # BaseVector.data = property(__expr.Expr, __expr.expr_data)
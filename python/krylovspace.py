@@ -1,6 +1,6 @@
 
 from ngsolve import Projector, Norm, TimeFunction, BaseMatrix, Preconditioner, InnerProduct, \
-    Norm, sqrt, Vector, Matrix, BaseVector, BitArray
+    Norm, sqrt, Vector, Matrix, BaseVector, BitArray, MultiVector
 from typing import Optional, Callable
 import logging
 from netgen.libngpy._meshing import _PushStatus, _GetStatus, _SetThreadPercentage
@@ -158,6 +158,104 @@ def CG(mat, rhs, pre=None, sol=None, tol=1e-12, maxsteps = 100, printrates = Tru
 
 
 
+@TimeFunction
+def BlockCG(mat, rhs, pre=None, sol=None, tol=1e-12, maxsteps = 100, printrates = True, initialize = True):
+    """preconditioned block conjugate gradient method
+
+    Solves for several right hand sides at once. Matrix and preconditioner
+    are applied to all search directions together, for sparse matrices and
+    sparse Cholesky factors this traverses the matrix only once per step.
+
+
+    Parameters
+    ----------
+
+    mat : Matrix
+      The left hand side of the equation to solve. The matrix has to be spd.
+
+    rhs : MultiVector
+      The right hand sides of the equation.
+
+    pre : Preconditioner
+      If provided the preconditioner is used.
+
+    sol : MultiVector
+      Start vectors for the method, if initialize is set False. Gets overwritten by the solution. If sol = None then a new MultiVector is created.
+
+    tol : double
+      Relative tolerance of the residuum, for every right hand side.
+
+    maxsteps : int
+      Number of maximal steps.
+
+    printrates : bool
+      If set to True then the maximal error of the iterations is displayed.
+
+    initialize : bool
+      If set to True then the initial guess is set to zero. Otherwise the values of sol are used.
+
+
+    Returns
+    -------
+    (MultiVector)
+      Solution vectors of the block CG method.
+
+    """
+    k = len(rhs)
+    tmp = mat.CreateRowVector()
+    u = sol if sol is not None else MultiVector(tmp, k)
+    d = MultiVector(tmp, k)
+    w = MultiVector(tmp, k)
+    s = MultiVector(tmp, k)
+    q = MultiVector(tmp, k)
+
+    if initialize:
+        for i in range(k):
+            u[i] = 0
+        d[:] = rhs
+    else:
+        d[:] = rhs - mat * u
+    if pre:
+        w[:] = pre * d
+    else:
+        w[:] = d
+    s[:] = w
+
+    wdn = w.InnerProduct(d)
+    err0 = [sqrt(abs(wdn[i,i])) for i in range(k)]
+    active = [e > 0 for e in err0]
+    if not any(active):
+        return u
+
+    for it in range(maxsteps):
+        q[:] = mat * s
+        wd = wdn
+        alpha = s.InnerProduct(q).I * wd
+        u[:] = u + s * alpha
+        d[:] = d - q * alpha
+
+        if pre:
+            w[:] = pre * d
+        else:
+            w[:] = d
+        wdn = w.InnerProduct(d)
+        beta = wd.I * wdn
+
+        # s = w + s beta, q is free again
+        q[:] = s * beta
+        s[:] = w + q
+
+        err = max(sqrt(abs(wdn[i,i])) / err0[i] for i in range(k) if active[i])
+        if printrates:
+            print("it = ", it, " err = ", err)
+        if err < tol: break
+    else:
+        print("Warning: BlockCG did not converge to TOL")
+
+    return u
+
+
+
 @TimeFunction
 def QMR(mat, rhs, fdofs, pre1=None, pre2=None, sol=None, maxsteps = 100, printrates = True, initialize = True, ep = 1.0, tol = 1e-7):
     """Quasi Minimal Residuum method
@@ -1,5 +1,5 @@
 from ngsolve.eigenvalues import PINVIT
-from ngsolve.krylovspace import CG, QMR, MinRes, PreconditionedRichardson, GMRes
+from ngsolve.krylovspace import CG, BlockCG, QMR, MinRes, PreconditionedRichardson, GMRes
 from ngsolve.nonlinearsolvers import Newton, NewtonMinimization
 from ngsolve.bvp import BVP
 
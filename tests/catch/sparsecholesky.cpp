@@ -0,0 +1,56 @@
+#include "catch.hpp"
+#include <la.hpp>
+using namespace ngla;
+
+// symmetric, diagonally dominant matrix with the given off-diagonal entries
+static shared_ptr<SparseMatrixTM<double>>
+CreateSymmetric (size_t n, std::initializer_list<std::pair<int,int>> offdiag)
+{
+  Array<int> ii, jj;
+  Array<double> vals;
+  for (size_t i = 0; i < n; i++)
+    {
+      ii.Append (i); jj.Append (i); vals.Append (4+i);
+    }
+  for (auto e : offdiag)
+    {
+      ii.Append (e.first); jj.Append (e.second); vals.Append (-1);
+      ii.Append (e.second); jj.Append (e.first); vals.Append (-1);
+    }
+  return SparseMatrixTM<double>::CreateFromCOO (ii, jj, vals, n, n);
+}
+
+static double Residual (const SparseMatrixTM<double> & a, const BaseMatrix & inv)
+{
+  size_t n = a.Height();
+  VVector<double> f(n), x(n), r(n);
+  for (size_t i = 0; i < n; i++)
+    f(i) = sin(3+3*i);
+  inv.Mult (f, x);
+  a.Mult (x, r);
+  double err = 0;
+  for (size_t i = 0; i < n; i++)
+    err += sqr (r(i)-f(i));
+  return sqrt(err);
+}
+
+TEST_CASE ("SparseCholesky refactor", "[sparsecholesky]")
+{
+  size_t n = 4;
+  // same number of entries in every row, only the columns differ
+  auto a = CreateSymmetric (n, { {1,0}, {3,2} });
+  auto b = CreateSymmetric (n, { {2,0}, {3,1} });
+  REQUIRE (a->NZE() == b->NZE());
+
+  SparseCholesky<double> inv(*a);
+  SECTION ("same pattern")
+    {
+      inv.FactorNew (*a);
+      CHECK (Residual (*a, inv) < 1e-12);
+    }
+  SECTION ("changed pattern")
+    {
+      inv.FactorNew (*b);
+      CHECK (Residual (*b, inv) < 1e-12);
+    }
+}
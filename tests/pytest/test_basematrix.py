@@ -1,6 +1,7 @@
 
 import pytest
 from ngsolve import *
+from netgen.geom2d import unit_square
 
 class MyMatrix(BaseMatrix):
     def __init__ (self,n):
@@ -68,3 +69,164 @@ def test_derive_basematrix_lifetime():
 
 
 
+
+@pytest.mark.parametrize("symmetric", [False, True])
+def test_sparsematrix_sell(symmetric):
+    from netgen.geom2d import unit_square
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3)
+    u,v = fes.TnT()
+    a = BilinearForm(fes, symmetric=symmetric)
+    if symmetric:
+        # only the lower triangle is stored
+        a += (grad(u)*grad(v)+u*v)*dx
+    else:
+        a += (grad(u)*grad(v)+grad(u)[0]*v+u*v)*dx
+    a.Assemble()
+    sell = la.SparseMatrixSELL(a.mat, sigma=32)
+
+    x = a.mat.CreateRowVector()
+    x.SetRandom()
+    y1 = a.mat.CreateColVector()
+    y2 = a.mat.CreateColVector()
+    y1.data = a.mat * x
+    y2.data = sell * x
+    y2 -= y1
+    assert y2.Norm() < 1e-12 * y1.Norm()
+
+    y1.data = a.mat.T * x
+    y2.data = sell.T * x
+    y2 -= y1
+    assert y2.Norm() < 1e-12 * y1.Norm()
+
+
+def assert_same_matrix(a, b):
+    """ forms a and b, assembled with different flags, have the same matrix """
+    diff = a.mat.AsVector().CreateVector()
+    diff.data = a.mat.AsVector() - b.mat.AsVector()
+    assert diff.Norm() < 1e-12 * b.mat.AsVector().Norm()
+
+@pytest.mark.parametrize("sym", [False, True])
+@pytest.mark.parametrize("condense", [False, True])
+def test_assembly_plan(sym, condense):
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=3, dirichlet="left")
+    u,v = fes.TnT()
+    coef = Parameter(1)
+    a = BilinearForm(fes, symmetric=sym, condense=condense, assembly_plan=True)
+    a += (coef*grad(u)*grad(v)+u*v)*dx + u*v*ds
+    b = BilinearForm(fes, symmetric=sym, condense=condense)
+    b += (coef*grad(u)*grad(v)+u*v)*dx + u*v*ds
+
+    # the second assembly scatters by the plan
+    for val in [1, 3.5]:
+        coef.Set(val)
+        a.Assemble()
+        b.Assemble()
+        assert_same_matrix(a, b)
+
+    # an integrator added after the plan was built invalidates it
+    a += coef*u*v*dx(definedon=mesh.Materials(".*"))
+    b += coef*u*v*dx(definedon=mesh.Materials(".*"))
+    a.Assemble()
+    b.Assemble()
+    assert_same_matrix(a, b)
+
+    # so does a new mesh and space
+    mesh.Refine()
+    fes.Update()
+    a.Assemble()
+    b.Assemble()
+    assert_same_matrix(a, b)
+
+
+def test_atomic_assembly():
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.2))
+    h1 = H1(mesh, order=3)
+    hdg = L2(mesh, order=2) * FacetFESpace(mesh, order=2)
+    dg = L2(mesh, order=2, dgjumps=True)
+    n = specialcf.normal(2)
+
+    def h1form(fes, **flags):
+        u,v = fes.TnT()
+        a = BilinearForm(fes, **flags)
+        a += (grad(u)*grad(v)+u*v)*dx
+        return a
+
+    def hdgform(fes, **flags):
+        (u,uhat),(v,vhat) = fes.TnT()
+        a = BilinearForm(fes, condense=True, **flags)
+        a += grad(u)*grad(v)*dx + 10*(u-uhat)*(v-vhat)*dx(element_boundary=True)
+        return a
+
+    def dgform(fes, **flags):
+        u,v = fes.TnT()
+        jump_u = u-u.Other()
+        jump_v = v-v.Other()
+        a = BilinearForm(fes, **flags)
+        a += grad(u)*grad(v)*dx + 10*jump_u*jump_v*dx(skeleton=True) \
+            - 0.5*(grad(u)+grad(u.Other()))*n*jump_v*dx(skeleton=True)
+        return a
+
+    for fes, form in [(h1, h1form), (hdg, hdgform), (dg, dgform)]:
+        a = form(fes, atomic_assembly=True)
+        b = form(fes)
+        a.Assemble()
+        b.Assemble()
+        assert_same_matrix(a, b)
+
+# element dependent coefficients (mesh size, material wise) fall back to per element evaluation
+@pytest.mark.parametrize("coef", ["polynomial", "gridfunction", "meshsize", "ifpos", "domainwise"])
+def test_batch_assembly(coef):
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.2))
+    for order in [1,2]:
+        fes = H1(mesh, order=order)
+        gf = GridFunction(fes)
+        gf.Set(x*x+1)
+        h = specialcf.mesh_size
+        cf = { "polynomial" : x*y+1,
+               "gridfunction" : gf,
+               "meshsize" : h,
+               "ifpos" : IfPos(x-0.5, h, 1),
+               "domainwise" : CoefficientFunction([x+2]) }[coef]
+        u,v = fes.TnT()
+        a = BilinearForm(fes, batch_assembly=True)
+        a += cf*grad(u)*grad(v)*dx + u*v*dx
+        b = BilinearForm(fes)
+        b += cf*grad(u)*grad(v)*dx + u*v*dx
+        a.Assemble()
+        b.Assemble()
+        assert_same_matrix(a, b)
+
+def test_constant_ebe():
+    import numpy as np
+    # overlapping element dofs on a chain, element matrix shared by all elements
+    ne, k = 1000, 4
+    emat = Matrix(k,k)
+    emat.NumPy()[:] = np.random.rand(k,k)
+    dofs = [list(range((k-1)*i, (k-1)*i+k)) for i in range(ne)]
+    n = (k-1)*ne+1
+    mat = la.ConstEBEMatrix(h=n, w=n, matrix=emat, col_ind=dofs, row_ind=dofs)
+
+    dense = np.zeros((n,n))
+    for d in dofs:
+        dense[np.ix_(d,d)] += emat.NumPy()
+
+    x = mat.CreateRowVector()
+    x.FV().NumPy()[:] = np.random.rand(n)
+    y = mat.CreateColVector()
+    def check():
+        y.data = mat * x
+        assert np.allclose(y.FV().NumPy(), dense @ x.FV().NumPy())
+        y.data = mat.T * x
+        assert np.allclose(y.FV().NumPy(), dense.T @ x.FV().NumPy())
+
+    # sequential: coloring, threaded: privatized accumulation
+    check()
+    numthreads = ngsglobals.numthreads
+    SetNumThreads(4)
+    try:
+        with TaskManager():
+            check()
+    finally:
+        SetNumThreads(numthreads)
@@ -81,6 +81,52 @@ def test_code_generation_derivatives(unit_mesh_3d):
         vals -= vals_ref
         assert Norm(vals) == approx(0)
 
+@pytest.mark.slow
+def test_code_generation_cache(unit_mesh_3d, tmp_path):
+    import os
+    from ngsolve.fem import SetCompileCacheDirectory
+    SetCompileCacheDirectory(str(tmp_path))
+    try:
+        p1 = Parameter(2)
+        p2 = Parameter(3)
+        cf1 = p1*x*y + sin(x)
+        cf2 = p2*x*y + sin(x)
+        # identical code, the second library is taken from the cache
+        f1 = cf1.Compile(True, wait=True)
+        f2 = cf2.Compile(True, wait=True)
+        assert len([f for f in os.listdir(tmp_path) if f.endswith(".key")]) == 1
+        for cf, f in [(cf1, f1), (cf2, f2)]:
+            assert Integrate( (cf-f)*(cf-f), unit_mesh_3d) == approx(0)
+    finally:
+        SetCompileCacheDirectory("")
+
+def test_code_generation_bytecode(unit_mesh_3d):
+    # Compile() without a compiler evaluates in-process, mixing register
+    # code with steps evaluated as a whole (mesh_size, IfPos, Norm)
+    p = Parameter(2)
+    v = CoefficientFunction((x+y, sin(p*z), 3*x*x))
+    functions = [p*x*y + exp(-y)/(1+z), v[1]*v[2] - v[0],
+                 IfPos(x-0.5, x, y)*specialcf.mesh_size + cos(x),
+                 Norm(v)*v, atan2(1+x,1+y)]
+    for cf in functions:
+        f = cf.Compile()
+        assert Integrate( InnerProduct(cf-f,cf-f), unit_mesh_3d) == approx(0)
+    f = functions[0].Compile()
+    p.Set(5)
+    assert Integrate( f, unit_mesh_3d) == approx(Integrate(functions[0], unit_mesh_3d))
+
+def test_code_generation_optimize(unit_mesh_3d):
+    r1 = sqrt(x*x+y*y)
+    r2 = sqrt(x*x+y*y)
+    c = CoefficientFunction(2)*CoefficientFunction(3)
+    cf = r1*r2 + c*x + CoefficientFunction(0)*y
+    f = cf.Compile()
+    assert Integrate( (cf-f)*(cf-f), unit_mesh_3d) == approx(0)
+    # r1 and r2 merged, 2*3 folded, 0*y removed:
+    # x, y, x*x, y*y, +, sqrt, r*r, 6, 6*x, +
+    assert str(f).count("Step ") == 10
+
+
 if __name__ == "__main__":
     test_code_generation_derivatives()
     test_code_generation_volume_terms()
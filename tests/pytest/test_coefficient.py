@@ -57,6 +57,26 @@ def test_domainwise_cf(domain2_mesh_2d):
     error_true = Integrate((c-c_true)*(c-c_true), domain2_mesh_2d)
     assert error_true == approx(0)
 
+def test_diff_shared_subtrees(unit_mesh_2d):
+    a = Parameter(1.5)
+    f = a*x + y
+    # every level uses the previous one twice
+    for i in range(12):
+        f = sin(f) + 0.5*f
+    g = CoefficientFunction((f, x*y, a*a))
+    df = g.Diff(a)
+    mip = unit_mesh_2d(0.3, 0.4)
+    h = 1e-6
+    a.Set(1.5+h)
+    fp = f(mip)
+    a.Set(1.5-h)
+    fm = f(mip)
+    a.Set(1.5)
+    d = df(mip)
+    assert d[0] == approx((fp-fm)/(2*h), rel=1e-6)
+    assert d[1] == 0
+    assert d[2] == approx(3)
+
 def test_evaluate(unit_mesh_2d):
     import numpy as np
     pnts = np.linspace(0.1,0.9,9)
@@ -69,6 +89,20 @@ def test_evaluate(unit_mesh_2d):
     assert vals2 == approx(np.array(list(zip([0.5 + 0J] * 10, pnts*1J))))
     assert x(unit_mesh_2d(0.5,0.5)) == approx(0.5)
 
+def test_voxel_cf(unit_mesh_3d):
+    import numpy as np
+    s = np.linspace(0, 1, 11)
+    Z, Y, X = np.meshgrid(s, s, s, indexing="ij")
+    vals = np.stack([X+2*Y, 3*Z], axis=-1)
+    exact = CoefficientFunction((x+2*y, 3*z))
+    # trilinear interpolation of linear data is exact,
+    # non-native byte order is copied instead of used in place
+    for blocked, data in [(False, vals), (True, vals), (False, vals.astype(">f8"))]:
+        vcf = VoxelCoefficient((0,0,0), (1,1,1), data, linear=True, blocked=blocked)
+        assert vcf.dim == 2
+        assert Integrate(InnerProduct(vcf-exact, vcf-exact), unit_mesh_3d) == approx(0)
+        assert vcf(unit_mesh_3d(0.33,0.5,0.71)) == approx((1.33, 2.13))
+
 if __name__ == "__main__":
     test_pow()
     test_ParameterCF()
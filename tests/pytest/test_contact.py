@@ -118,3 +118,22 @@ def test_gapfunction():
 
     error = Norm(-cb.gap + center - (x,y,z)) - r
     assert Integrate(error, mesh, definedon=master, order=1) < 1e-8
+
+def test_gapfunction_refit(mesh):
+    fes = VectorH1(mesh, order=3)
+    u = GridFunction(fes)
+    master = mesh.Boundaries("master")
+    minion = mesh.Boundaries("minion")
+    cb = ContactBoundary(fes, master, minion)
+    SetY(u, -2.5)
+    cb.Update(u, maxdist=2)
+    # small change of the displacement refits the search tree
+    SetY(u, -2.9)
+    cb.Update(u, maxdist=2)
+    cb_new = ContactBoundary(fes, master, minion)
+    cb_new.Update(u, maxdist=2)
+    dist = lambda g: IfPos(2-Norm(g), Norm(g), 0)
+    gap = Integrate(dist(cb.gap), mesh, definedon=master, order=4)
+    gap_new = Integrate(dist(cb_new.gap), mesh, definedon=master, order=4)
+    assert gap > 0
+    assert gap == pytest.approx(gap_new)
@@ -99,6 +99,47 @@ def test_SurfaceGetFE(quads=False):
                         assert space.GetFE(el).ndof == len(space.GetDofNrs(el)), [spacename,vb,order]
     return
 
+def MatrixFreeSpace(case):
+    from ngsolve.meshes import MakeStructured2DMesh, MakeStructured3DMesh
+    if case == "quads":
+        mesh = MakeStructured2DMesh(quads=True, nx=3, ny=3, mapping=lambda x,y : (x+0.1*y*y, y))
+        return L2(mesh, order=5, tp=True)
+    if case == "hexes":
+        mesh = MakeStructured3DMesh(hexes=True, nx=2, mapping=lambda x,y,z : (x+0.1*y*z, y, z))
+        return L2(mesh, order=5, tp=True)
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.5))
+    return H1(mesh, order=5) if case == "tets_h1" else L2(mesh, order=5)
+
+# shape tables are disabled by cachebytes=0
+@pytest.mark.parametrize("case", ["quads", "hexes", "tets_h1", "tets_l2"])
+@pytest.mark.parametrize("cachebytes", [0, 1 << 28])
+def test_l2tp_matrixfree(case, cachebytes):
+    from ngsolve.fem import SetShapeTableCache
+    fes = MatrixFreeSpace(case)
+    u,v = fes.TnT()
+    form = (grad(u)*grad(v) + u*v)*dx
+
+    def Apply(vec, nonassemble):
+        a = BilinearForm(fes, nonassemble=nonassemble)
+        a += form
+        a.Assemble()
+        y = vec.CreateVector()
+        y.data = a.mat * vec
+        return y
+
+    vec = GridFunction(fes).vec
+    vec.SetRandom()
+    try:
+        SetShapeTableCache(0)
+        yref = Apply(vec, False)
+        SetShapeTableCache(cachebytes, 4)
+        for y in [Apply(vec, False), Apply(vec, True)]:
+            y -= yref
+            assert y.Norm() < 1e-10 * yref.Norm()
+    finally:
+        SetShapeTableCache()
+
+
 if __name__ == "__main__":
     test_2DGetFE(quads=False)
     test_2DGetFE(quads=True)
@@ -1,3 +1,4 @@
+import pytest
 from ngsolve import *
 from netgen.csg import *
 ngsglobals.msg_level = 0
@@ -18,3 +19,128 @@ def test_call_operator_with_vectorization():
     mesh = Mesh(unit_cube.GenerateMesh(maxh=1))
     p = mesh(0.5,0.5,0.5)
     p2 = mesh([0.5, 0.1],0.5,0.5)
+
+def test_find_elements_of_points():
+    import numpy as np
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.3))
+    t = np.linspace(0.05, 0.95, 20)
+    pnts = np.array([[x,y,z] for x in t for y in t for z in t])
+    pnts = np.vstack([pnts, [[2,2,2]]])
+    mips = mesh.FindElementsOfPoints(pnts)
+    assert mips["nr"][-1] == -1
+    mips = mips[:-1]
+    assert np.all(mips["nr"] >= 0)
+    vals = CF((x,y,z))(mips)
+    assert np.allclose(vals, pnts[:-1])
+    bnd = mesh.FindElementsOfPoints(np.array([[0,0.5,0.5],[1,0.3,0.2]]), BND)
+    assert np.all(bnd["nr"] >= 0)
+
+def test_geometry_cache():
+    geo = CSGeometry()
+    geo.Add(Sphere(Pnt(0,0,0), 1))
+    mesh = Mesh(geo.GenerateMesh(maxh=0.5))
+    mesh.Curve(3)
+    fes = H1(mesh, order=3)
+    u,v = fes.TnT()
+    a = BilinearForm(grad(u)*grad(v)*dx+u*v*ds).Assemble()
+    mat = a.mat.CreateMatrix()
+    mat.AsVector().data = a.mat.AsVector()
+    mesh.EnableGeometryCache()
+    assert mesh.__memory__ == [("geometry cache", 0, 0)]
+    for i in range(2):
+        a.Assemble()
+        diff = mat.AsVector().CreateVector()
+        diff.data = mat.AsVector() - a.mat.AsVector()
+        assert diff.Norm() < 1e-12 * mat.AsVector().Norm()
+    name, nbytes, nentries = mesh.__memory__[0]
+    assert nbytes > 0 and nentries > 0
+    mesh.EnableGeometryCache(False)
+    assert mesh.__memory__ == []
+
+def test_vtu_output(tmp_path):
+    import numpy as np
+    import re, base64
+    import xml.etree.ElementTree as ET
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.5))
+    cf = CoefficientFunction((x, y*z))
+    name = str(tmp_path / "out")
+
+    def read_arrays(filename):
+        data = open(filename, "rb").read()
+        start = data.index(b"_", data.index(b"<AppendedData")) + 1
+        header = ET.fromstring(data[:data.index(b"<AppendedData")].decode() + "</VTKFile>")
+        encoding = re.search(rb'<AppendedData encoding="(\w+)"', data).group(1)
+        arrays = {}
+        for da in header.iter("DataArray"):
+            offset = start + int(da.get("offset"))
+            dtype = { "Float32" : np.float32, "Float64" : np.float64, "Int32" : np.int32,
+                      "Int64" : np.int64, "UInt8" : np.uint8 }[da.get("type")]
+            if encoding == b"raw":
+                n = np.frombuffer(data, np.uint64, 1, offset)[0]
+                values = np.frombuffer(data, dtype, int(n)//np.dtype(dtype).itemsize, offset+8)
+            else:
+                n = np.frombuffer(base64.b64decode(data[offset:offset+12]), np.uint64)[0]
+                nenc = 4*((int(n)+2)//3)
+                values = np.frombuffer(base64.b64decode(data[offset+12:offset+12+nenc]), dtype)
+            arrays[da.get("Name")] = values.reshape(-1, int(da.get("NumberOfComponents")))
+        return header, arrays
+
+    for encoding in ["raw", "base64"]:
+        vtk = VTKOutput(mesh, coefs=[cf], names=["f"], filename=name, subdivision=1, vtu=True,
+                        encoding=encoding)
+        vtk.Do(time=0.5)
+        header, arrays = read_arrays(name+".vtu")
+        piece = header.find("UnstructuredGrid/Piece")
+        npoints = int(piece.get("NumberOfPoints"))
+        assert int(piece.get("NumberOfCells")) == 8*mesh.ne
+        assert len(arrays["types"]) == 8*mesh.ne and np.all(arrays["types"] == 10)
+        assert arrays["offsets"][-1,0] == len(arrays["connectivity"])
+        pts = arrays["Points"]
+        assert pts.shape == (npoints, 3)
+        assert np.allclose(arrays["f"], np.column_stack((pts[:,0], pts[:,1]*pts[:,2])))
+
+    pvd = ET.parse(name+".pvd").getroot()
+    assert [ds.get("file") for ds in pvd.iter("DataSet")] == ["out.vtu"]
+
+def test_asynchronous_output(tmp_path):
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.5))
+    gfu = GridFunction(H1(mesh, order=2))
+    sync = VTKOutput(mesh, coefs=[gfu], names=["u"], filename=str(tmp_path / "sync"), vtu=True)
+    asyn = VTKOutput(mesh, coefs=[gfu], names=["u"], filename=str(tmp_path / "async"), vtu=True,
+                     asynchronous=True)
+    for step in range(4):
+        gfu.Set(step*x*y)
+        sync.Do(time=0.1*step)
+        asyn.Do(time=0.1*step)
+        gfu.Save(str(tmp_path / "sync{}.sol".format(step)))
+        gfu.Save(str(tmp_path / "async{}.sol".format(step)), asynchronous=True)
+    WaitForOutput()
+
+    for step in range(4):
+        suffix = "_{}.vtu".format(step) if step else ".vtu"
+        assert (tmp_path / ("sync"+suffix)).read_bytes() == (tmp_path / ("async"+suffix)).read_bytes()
+        assert (tmp_path / "sync{}.sol".format(step)).read_bytes() == \
+            (tmp_path / "async{}.sol".format(step)).read_bytes()
+    assert (tmp_path / "async.pvd").read_text().count("DataSet") == 4
+
+def test_gridfunction_checkpoint(tmp_path):
+    import numpy as np
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.5))
+    fes = H1(mesh, order=3, complex=True)
+    gfu = GridFunction(fes, multidim=2)
+    for vec in gfu.vecs:
+        vec.FV().NumPy()[:] = np.random.rand(fes.ndof) + 1j*np.random.rand(fes.ndof)
+    name = str(tmp_path / "gfu.ckpt")
+    gfu.SaveCheckpoint(name)
+
+    gfv = GridFunction(fes, multidim=2)
+    gfv.LoadCheckpoint(name)
+    for v, w in zip(gfu.vecs, gfv.vecs):
+        assert np.all(v.FV().NumPy() == w.FV().NumPy())
+
+    # the payload is page aligned raw data
+    payload = np.memmap(name, dtype=np.complex128, mode="r", offset=4096)
+    assert np.all(payload[:fes.ndof] == gfu.vecs[0].FV().NumPy())
+
+    with pytest.raises(Exception):
+        GridFunction(H1(mesh, order=2, complex=True), multidim=2).LoadCheckpoint(name)
@@ -53,6 +53,231 @@ def test_newton_with_dirichlet():
     dirichlet.Set(0)
     newton = solvers.Newton(a, gfu, dirichletvalues=dirichlet.vec)
 
+# compiled energies seed the batched directions in the generated code,
+# in 3D the directions do not fit into one batch
+@pytest.mark.parametrize("compile", ["none", "compile", "realcompile"])
+@pytest.mark.parametrize("dim", [2, 3])
+def test_energy_linearization(compile, dim):
+    if dim == 2:
+        mesh = Mesh (unit_square.GenerateMesh(maxh=0.3))
+        u0 = CoefficientFunction((x*y, 1+x-y*y))
+    else:
+        from netgen.csg import unit_cube
+        mesh = Mesh (unit_cube.GenerateMesh(maxh=0.5))
+        u0 = CoefficientFunction((x*y, 1+x-y*y, x*z))
+    V = VectorH1(mesh, order=dim)
+    u,v = V.TnT()
+    gfu = GridFunction(V)
+    gfu.Set(u0)
+    u0 = gfu
+
+    energy = 0.5*InnerProduct(grad(u),grad(u)) + 0.25*(u*u)**2
+    if compile == "compile":
+        energy = energy.Compile()
+    elif compile == "realcompile":
+        energy = energy.Compile(True, wait=True)
+    a = BilinearForm(V, symmetric=False)
+    a += Variation(energy*dx)
+    a.AssembleLinearization(gfu.vec)
+
+    # hand-written Hessian and gradient of the energy
+    b = BilinearForm(V, symmetric=False)
+    b += (InnerProduct(grad(u),grad(v)) + (u0*u0)*(u*v) + 2*(u0*u)*(u0*v))*dx
+    b.Assemble()
+    f = LinearForm(V)
+    f += (InnerProduct(grad(u0),grad(v)) + (u0*u0)*(u0*v))*dx
+    f.Assemble()
+
+    w = gfu.vec.CreateVector()
+    w.SetRandom()
+    r1 = w.CreateVector()
+    r2 = w.CreateVector()
+    r1.data = a.mat * w
+    r2.data = b.mat * w
+    r1 -= r2
+    assert r1.Norm() < 1e-10 * r2.Norm()
+
+    res = gfu.vec.CreateVector()
+    a.Apply(gfu.vec, res)
+    res -= f.vec
+    assert res.Norm() < 1e-10 * f.vec.Norm()
+
+# factorization options compared with the default factorization. The coarse
+# mesh leaves only a few free dofs, the partial Dirichlet boundary a
+# non-trivial pattern of free dofs
+@pytest.mark.parametrize("option, value, tol", [("supernodal", True, 1e-10),
+                                               ("ordering", "nesteddissection", 1e-10),
+                                               ("storefloat", True, 1e-3)])
+@pytest.mark.parametrize("maxh, order, dirichlet", [(0.3, 1, ".*"), (0.1, 4, ".*"),
+                                                    (0.05, 2, "left|bottom")])
+def test_sparsecholesky_options(option, value, tol, maxh, order, dirichlet):
+    mesh = Mesh (unit_square.GenerateMesh(maxh=maxh))
+    fes = H1(mesh, order=order, dirichlet=dirichlet)
+    u,v = fes.TnT()
+    a = BilinearForm(fes, symmetric=True)
+    a += (grad(u)*grad(v)+u*v)*dx
+    a.Assemble()
+    f = a.mat.CreateColVector()
+    f.SetRandom()
+
+    ainv = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky")
+    default = getattr(la.SparseCholeskyOptions, option)
+    setattr(la.SparseCholeskyOptions, option, value)
+    try:
+        ainv_opt = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky")
+    finally:
+        setattr(la.SparseCholeskyOptions, option, default)
+
+    u1 = f.CreateVector()
+    u2 = f.CreateVector()
+    u1.data = ainv * f
+    u2.data = ainv_opt * f
+    u2 -= u1
+    assert u2.Norm() < tol * u1.Norm()
+
+    if option == "storefloat":
+        # single precision factors are a good preconditioner
+        u2 = solvers.CG(mat=a.mat, pre=ainv_opt, rhs=f, tol=1e-12, maxsteps=10, printrates=False)
+        u2 -= u1
+        assert u2.Norm() < 1e-8 * u1.Norm()
+
+def test_blocksmoother_storefloat():
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=4, dirichlet=".*")
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += (grad(u)*grad(v)+u*v)*dx
+    a.Assemble()
+    # element blocks of odd size run through the SIMD remainder loops
+    blocks = [[d for d in fes.GetDofNrs(el) if fes.FreeDofs()[d]] for el in fes.Elements()]
+
+    jac = a.mat.CreateBlockSmoother(blocks)
+    la.BlockSmoother.storefloat = True
+    try:
+        jacf = a.mat.CreateBlockSmoother(blocks)
+    finally:
+        la.BlockSmoother.storefloat = False
+
+    x = a.mat.CreateColVector()
+    x.SetRandom()
+    y1 = x.CreateVector()
+    y2 = x.CreateVector()
+    for trans in [False, True]:
+        y1.data = (jac.T if trans else jac) * x
+        y2.data = (jacf.T if trans else jacf) * x
+        y2 -= y1
+        assert y2.Norm() < 1e-5 * y1.Norm()
+
+    y1[:] = 0
+    y2[:] = 0
+    jac.Smooth(y1, x)
+    jacf.Smooth(y2, x)
+    y2 -= y1
+    assert y2.Norm() < 1e-5 * y1.Norm()
+
+    # band Cholesky blocks of symmetric storage have no single precision variant
+    asym = BilinearForm(fes, symmetric=True)
+    asym += (grad(u)*grad(v)+u*v)*dx
+    asym.Assemble()
+    la.BlockSmoother.storefloat = True
+    try:
+        with pytest.raises(Exception):
+            asym.mat.CreateBlockSmoother(blocks)
+    finally:
+        la.BlockSmoother.storefloat = False
+
+def test_sparsecholesky_update():
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3, dirichlet="left|bottom")
+    u,v = fes.TnT()
+    c = Parameter(1)
+    a = BilinearForm(fes, symmetric=True)
+    a += (grad(u)*grad(v)+c*u*v)*dx
+    a.Assemble()
+    ainv = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky")
+    f = a.mat.CreateColVector()
+    f.SetRandom()
+
+    # same sparsity pattern, numeric refactorization only
+    c.Set(10)
+    a.Assemble()
+    ainv.Update()
+    ainv_new = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky")
+
+    u1 = f.CreateVector()
+    u2 = f.CreateVector()
+    u1.data = ainv_new * f
+    u2.data = ainv * f
+    u2 -= u1
+    assert u2.Norm() < 1e-10 * u1.Norm()
+
+def test_blockcg_multivector():
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=2, dirichlet=".*")
+    u,v = fes.TnT()
+    a = BilinearForm(fes, symmetric=False)
+    a += (grad(u)*grad(v)+u*v)*dx
+    a.Assemble()
+    ainv = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky")
+
+    k = 5
+    f = MultiVector(a.mat.CreateColVector(), k)
+    for vec in f:
+        vec.SetRandom()
+        vec.data = Projector(fes.FreeDofs(), True) * vec
+
+    # blocked matrix and factor application agree with single vectors
+    af = MultiVector(a.mat.CreateColVector(), k)
+    af[:] = a.mat * f
+    uf = MultiVector(a.mat.CreateColVector(), k)
+    uf[:] = ainv * f
+    hv = a.mat.CreateColVector()
+    for i in range(k):
+        hv.data = a.mat * f[i] - af[i]
+        assert hv.Norm() < 1e-12 * af[i].Norm()
+        hv.data = ainv * f[i] - uf[i]
+        assert hv.Norm() < 1e-12 * uf[i].Norm()
+
+    pre = Preconditioner(a, "local")
+    a.Assemble()
+    sol = solvers.BlockCG(a.mat, f, pre=pre.mat, tol=1e-10, maxsteps=500, printrates=False)
+    for i in range(k):
+        hv.data = sol[i] - uf[i]
+        assert hv.Norm() < 1e-6 * uf[i].Norm()
+
+# non-symmetric storage makes Restrict return new coarse matrices on update,
+# the K-cycle is nonlinear and needs a flexible outer iteration
+@pytest.mark.parametrize("symmetric", [True, False])
+@pytest.mark.parametrize("opts", [dict(), dict(cycle="W", smoother="chebyshev"),
+                                  dict(cycle="K", aggressivelevels=1, smoothingsteps=2)])
+def test_h1amg_options(symmetric, opts):
+    mesh = Mesh (unit_square.GenerateMesh(maxh=0.05))
+    fes = H1(mesh, order=1, dirichlet="left|bottom")
+    u,v = fes.TnT()
+    c = Parameter(1)
+    f = LinearForm(fes)
+    f += v*dx
+    f.Assemble()
+
+    a = BilinearForm(fes, symmetric=symmetric)
+    a += (c*grad(u)*grad(v)+u*v)*dx
+    pre = Preconditioner(a, "h1amg", reusesetup=True, **opts)
+    a.Assemble()
+    inv = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky")
+    for cval in [1, 10]:
+        # second assembly keeps the coarsening and only updates the matrices
+        c.Set(cval)
+        a.Assemble()
+        inv.Update()
+        if opts.get("cycle") == "K":
+            gfu = solvers.GMRes(A=a.mat, b=f.vec, pre=pre.mat, tol=1e-10, maxsteps=100, printrates=False)
+        else:
+            gfu = solvers.CG(mat=a.mat, pre=pre.mat, rhs=f.vec, tol=1e-10, maxsteps=100, printrates=False)
+        ref = f.vec.CreateVector()
+        ref.data = inv * f.vec
+        gfu -= ref
+        assert gfu.Norm() < 1e-6 * ref.Norm()
+
 
 if __name__ == "__main__":
     test_arnoldi()